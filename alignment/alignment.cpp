@@ -17,6 +17,12 @@
 #include "model/rategamma.h"
 #include "gsl/mygsl.h"
 #include "utils/gzstream.h"
+#include <sys/stat.h>
+#if !defined(_WIN32) && !defined(WIN32)
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 
@@ -64,6 +70,9 @@ Alignment::Alignment()
     seq_type = SEQ_UNKNOWN;
     STATE_UNKNOWN = 126;
     pars_lower_bound = NULL;
+    seq_states_unobs_const = false;
+    seq_states_fixed = false;
+    pattern_index_lazy = false;
 }
 
 string &Alignment::getSeqName(int i) {
@@ -404,12 +413,21 @@ Alignment::Alignment(char *filename, char *sequence_type, InputType &intype, str
     seq_type = SEQ_UNKNOWN;
     STATE_UNKNOWN = 126;
     pars_lower_bound = NULL;
+    seq_states_unobs_const = false;
+    seq_states_fixed = false;
+    pattern_index_lazy = false;
     cout << "Reading alignment file " << filename << " ... ";
     intype = detectInputFile(filename);
+    // PoMo data keep extra state that is not part of the cache
+    bool aln_cache = Params::getInstance().aln_cache && intype != IN_COUNTS &&
+        !(sequence_type && (strncmp(sequence_type, "CF", 2) == 0 || strncmp(sequence_type, "CR", 2) == 0));
 
     try {
 
-        if (intype == IN_NEXUS) {
+        if (aln_cache && readBinaryCache(filename, sequence_type)) {
+            cout << "Alignment cache " << filename << ".alnbin loaded" << endl;
+            aln_cache = false;
+        } else if (intype == IN_NEXUS) {
             cout << "Nexus format detected" << endl;
             readNexus(filename);
         } else if (intype == IN_FASTA) {
@@ -446,6 +464,9 @@ Alignment::Alignment(char *filename, char *sequence_type, InputType &intype, str
 
     countConstSite();
 
+    if (aln_cache)
+        writeBinaryCache(filename, sequence_type);
+
     cout << "Alignment has " << getNSeq() << " sequences with " << getNSite()
          << " columns, " << getNPattern() << " distinct patterns" << endl
          << num_informative_sites << " parsimony-informative, "
@@ -485,6 +506,11 @@ bool Alignment::isStandardGeneticCode() {
 }
 
 void Alignment::buildSeqStates(bool add_unobs_const) {
+    if (seq_states_fixed) {
+        // built beforehand for all models sharing the alignment
+        ASSERT(seq_states_unobs_const || !add_unobs_const);
+        return;
+    }
 	string unobs_const;
 	if (add_unobs_const) unobs_const = getUnobservedConstPatterns();
 	seq_states.clear();
@@ -501,6 +527,7 @@ void Alignment::buildSeqStates(bool add_unobs_const) {
 			if (has_state[state])
 				seq_states[seq].push_back(state);
 	}
+    seq_states_unobs_const = add_unobs_const;
 }
 
 int Alignment::readNexus(char *filename) {
@@ -874,6 +901,38 @@ void Alignment::printSiteInfo(const char* filename) {
     }
 }
 
+string PatternIntMap::packPattern(const vector<StateType> &pat) {
+    StateType max_state = 0;
+    for (auto it = pat.begin(); it != pat.end(); it++)
+        max_state = max(max_state, *it);
+    int bits;
+    if (max_state < 4)
+        bits = 2;
+    else if (max_state < 16)
+        bits = 4;
+    else if (max_state < 256)
+        bits = 8;
+    else if (max_state < 65536)
+        bits = 16;
+    else
+        bits = 32;
+    int states_per_byte = 8/bits;
+    size_t nbytes = (states_per_byte > 0) ? (pat.size()+states_per_byte-1)/states_per_byte : pat.size()*(bits/8);
+    string key(nbytes+1, 0);
+    key[0] = bits;
+    unsigned char *data = (unsigned char*)&key[1];
+    if (states_per_byte > 0) {
+        for (size_t i = 0; i < pat.size(); i++)
+            data[i/states_per_byte] |= pat[i] << ((i%states_per_byte)*bits);
+    } else {
+        int bytes = bits/8;
+        for (size_t i = 0; i < pat.size(); i++)
+            for (int j = 0; j < bytes; j++)
+                data[i*bytes+j] = (pat[i] >> (8*j)) & 0xff;
+    }
+    return key;
+}
+
 bool Alignment::addPattern(Pattern &pat, int site, int freq) {
     // check if pattern contains only gaps
     bool gaps_only = true;
@@ -887,6 +946,8 @@ bool Alignment::addPattern(Pattern &pat, int site, int freq) {
             cout << "Site " << site << " contains only gaps or ambiguous characters" << endl;
         //return true;
     }
+    if (pattern_index_lazy)
+        restorePatternIndex();
     PatternIntMap::iterator pat_it = pattern_index.find(pat);
     if (pat_it == pattern_index.end()) { // not found
         pat.frequency = freq;
@@ -1041,22 +1102,36 @@ void Alignment::regroupSitePattern(int groups, IntVector& site_group)
 	@return the data type of the input sequences
 */
 SeqType Alignment::detectSequenceType(StrVector &sequences) {
-    int num_nuc = 0;
-    int num_ungap = 0;
-    int num_bin = 0;
-    int num_alpha = 0;
-    int num_digit = 0;
+    vector<size_t> char_count;
+    countChars(sequences, char_count);
+    return detectSequenceType(char_count);
+}
 
+void Alignment::countChars(StrVector &sequences, vector<size_t> &char_count) {
+    char_count.resize(NUM_CHAR, 0);
     for (StrVector::iterator it = sequences.begin(); it != sequences.end(); it++)
-        for (string::iterator i = it->begin(); i != it->end(); i++) {
-            if ((*i) != '?' && (*i) != '-' && (*i) != '.' && *i != 'N' && *i != 'X' &&  (*i) != '~') num_ungap++;
-            if ((*i) == 'A' || (*i) == 'C' || (*i) == 'G' || (*i) == 'T' || (*i) == 'U')
-                num_nuc++;
-            if ((*i) == '0' || (*i) == '1')
-                num_bin++;
-            if (isalpha(*i)) num_alpha++;
-            if (isdigit(*i)) num_digit++;
-        }
+        for (string::iterator i = it->begin(); i != it->end(); i++)
+            char_count[(unsigned char)(*i)]++;
+}
+
+SeqType Alignment::detectSequenceType(vector<size_t> &char_count) {
+    size_t num_nuc = 0;
+    size_t num_ungap = 0;
+    size_t num_bin = 0;
+    size_t num_alpha = 0;
+    size_t num_digit = 0;
+
+    for (int ch = 0; ch < NUM_CHAR; ch++) {
+        size_t count = char_count[ch];
+        if (count == 0) continue;
+        if (ch != '?' && ch != '-' && ch != '.' && ch != 'N' && ch != 'X' &&  ch != '~') num_ungap += count;
+        if (ch == 'A' || ch == 'C' || ch == 'G' || ch == 'T' || ch == 'U')
+            num_nuc += count;
+        if (ch == '0' || ch == '1')
+            num_bin += count;
+        if (ch < 128 && isalpha(ch)) num_alpha += count;
+        if (ch < 128 && isdigit(ch)) num_digit += count;
+    }
     if (((double)num_nuc) / num_ungap > 0.9)
         return SEQ_DNA;
     if (((double)num_bin) / num_ungap > 0.9)
@@ -1389,11 +1464,10 @@ void Alignment::initCodon(char *gene_code_id) {
 //	cout << "num_states = " << num_states << endl;
 }
 
-int getMorphStates(StrVector &sequences) {
+int getMorphStates(vector<size_t> &char_count) {
 	char maxstate = 0;
-	for (StrVector::iterator it = sequences.begin(); it != sequences.end(); it++)
-		for (string::iterator pos = it->begin(); pos != it->end(); pos++)
-			if ((*pos) > maxstate && isalnum(*pos)) maxstate = *pos;
+	for (int ch = 0; ch < 128; ch++)
+		if (char_count[ch] && ch > maxstate && isalnum(ch)) maxstate = ch;
 	if (maxstate >= '0' && maxstate <= '9') return (maxstate - '0' + 1);
 	if (maxstate >= 'A' && maxstate <= 'V') return (maxstate - 'A' + 11);
 	return 0;
@@ -1420,6 +1494,24 @@ SeqType Alignment::getSeqType(const char *sequence_type) {
 }
 
 int Alignment::buildPattern(StrVector &sequences, char *sequence_type, int nseq, int nsite) {
+    IntVector seq_lengths;
+    for (StrVector::iterator it = sequences.begin(); it != sequences.end(); it++)
+        seq_lengths.push_back(it->length());
+    vector<size_t> char_count;
+    countChars(sequences, char_count);
+    initPatternBuilding(char_count, seq_lengths, sequence_type, nseq, nsite);
+
+    ostringstream err_str;
+    int num_error = 0;
+    int num_gaps_only = addPatternBatch(sequences, nsite, 0, sequence_type, err_str, num_error);
+    if (num_gaps_only)
+        cout << "WARNING: " << num_gaps_only << " sites contain only gaps or ambiguous characters." << endl;
+    if (err_str.str() != "")
+        throw err_str.str();
+    return 1;
+}
+
+void Alignment::initPatternBuilding(vector<size_t> &char_count, IntVector &seq_lengths, char *sequence_type, int nseq, int nsite) {
     int seq_id;
     ostringstream err_str;
     codon_table = NULL;
@@ -1445,14 +1537,14 @@ int Alignment::buildPattern(StrVector &sequences, char *sequence_type, int nseq,
 
     /* now check that all sequences have the same length */
     for (seq_id = 0; seq_id < nseq; seq_id ++) {
-        if (sequences[seq_id].length() != nsite) {
+        if (seq_lengths[seq_id] != nsite) {
             err_str << "Sequence " << seq_names[seq_id] << " contains ";
-            if (sequences[seq_id].length() < nsite)
+            if (seq_lengths[seq_id] < nsite)
                 err_str << "not enough";
             else
                 err_str << "too many";
 
-            err_str << " characters (" << sequences[seq_id].length() << ")\n";
+            err_str << " characters (" << seq_lengths[seq_id] << ")\n";
         }
     }
 
@@ -1460,7 +1552,7 @@ int Alignment::buildPattern(StrVector &sequences, char *sequence_type, int nseq,
         throw err_str.str();
 
     /* now check data type */
-    seq_type = detectSequenceType(sequences);
+    seq_type = detectSequenceType(char_count);
     switch (seq_type) {
     case SEQ_BINARY:
         num_states = 2;
@@ -1475,7 +1567,7 @@ int Alignment::buildPattern(StrVector &sequences, char *sequence_type, int nseq,
         cout << "Alignment most likely contains protein sequences" << endl;
         break;
     case SEQ_MORPH:
-        num_states = getMorphStates(sequences);
+        num_states = getMorphStates(char_count);
         if (num_states < 2 || num_states > 32) throw "Invalid number of states.";
         cout << "Alignment most likely contains " << num_states << "-state morphological data" << endl;
         break;
@@ -1507,7 +1599,7 @@ int Alignment::buildPattern(StrVector &sequences, char *sequence_type, int nseq,
             nt2aa = true;
             cout << "Translating to amino-acid sequences with genetic code " << &sequence_type[5] << " ..." << endl;
         } else if (strcmp(sequence_type, "NUM") == 0 || strcmp(sequence_type, "MORPH") == 0) {
-            num_states = getMorphStates(sequences);
+            num_states = getMorphStates(char_count);
             if (num_states < 2 || num_states > 32) throw "Invalid number of states";
             user_seq_type = SEQ_MORPH;
         } else if (strcmp(sequence_type, "TINA") == 0 || strcmp(sequence_type, "MULTI") == 0) {
@@ -1526,12 +1618,23 @@ int Alignment::buildPattern(StrVector &sequences, char *sequence_type, int nseq,
         seq_type = user_seq_type;
     }
 
+    computeUnknownState();
+    int step = ((seq_type == SEQ_CODON || nt2aa) ? 3 : 1);
+    if (nsite % step != 0)
+    	outError("Number of sites is not multiple of 3");
+    site_pattern.resize(nsite/step, -1);
+    clear();
+    pattern_index.clear();
+}
+
+int Alignment::addPatternBatch(StrVector &sequences, int nsite, int first_site, char *sequence_type, ostringstream &err_str, int &num_error) {
     // now convert to patterns
     int site, seq, num_gaps_only = 0;
+    int nseq = sequences.size();
+    bool nt2aa = (sequence_type && strncmp(sequence_type, "NT2AA", 5) == 0);
 
     char char_to_state[NUM_CHAR];
     char AA_to_state[NUM_CHAR];
-    computeUnknownState();
     if (nt2aa) {
         buildStateMap(char_to_state, SEQ_DNA);
         buildStateMap(AA_to_state, SEQ_PROTEIN);
@@ -1541,12 +1644,6 @@ int Alignment::buildPattern(StrVector &sequences, char *sequence_type, int nseq,
     Pattern pat;
     pat.resize(nseq);
     int step = ((seq_type == SEQ_CODON || nt2aa) ? 3 : 1);
-    if (nsite % step != 0)
-    	outError("Number of sites is not multiple of 3");
-    site_pattern.resize(nsite/step, -1);
-    clear();
-    pattern_index.clear();
-    int num_error = 0;
     for (site = 0; site < nsite; site+=step) {
         for (seq = 0; seq < nseq; seq++) {
             //char state = convertState(sequences[seq][site], seq_type);
@@ -1561,7 +1658,7 @@ int Alignment::buildPattern(StrVector &sequences, char *sequence_type, int nseq,
             		if (genetic_code[(int)state] == '*') {
                         err_str << "Sequence " << seq_names[seq] << " has stop codon " <<
                         		sequences[seq][site] << sequences[seq][site+1] << sequences[seq][site+2] <<
-                        		" at site " << site+1 << endl;
+                        		" at site " << first_site+site+1 << endl;
                         num_error++;
                         state = STATE_UNKNOWN;
             		} else if (nt2aa) {
@@ -1576,7 +1673,7 @@ int Alignment::buildPattern(StrVector &sequences, char *sequence_type, int nseq,
             			ostringstream warn_str;
                         warn_str << "Sequence " << seq_names[seq] << " has ambiguous character " <<
                         		sequences[seq][site] << sequences[seq][site+1] << sequences[seq][site+2] <<
-                        		" at site " << site+1;
+                        		" at site " << first_site+site+1;
                         outWarning(warn_str.str());
             		}
             		state = STATE_UNKNOWN;
@@ -1587,7 +1684,7 @@ int Alignment::buildPattern(StrVector &sequences, char *sequence_type, int nseq,
                     err_str << "Sequence " << seq_names[seq] << " has invalid character " << sequences[seq][site];
                     if (seq_type == SEQ_CODON)
                         err_str << sequences[seq][site+1] << sequences[seq][site+2];
-                    err_str << " at site " << site+1 << endl;
+                    err_str << " at site " << first_site+site+1 << endl;
                 } else if (num_error == 100)
                     err_str << "...many more..." << endl;
                 num_error++;
@@ -1595,16 +1692,15 @@ int Alignment::buildPattern(StrVector &sequences, char *sequence_type, int nseq,
             pat[seq] = state;
         }
         if (!num_error)
-            num_gaps_only += addPattern(pat, site/step);
+            num_gaps_only += addPattern(pat, (first_site+site)/step);
     }
-    if (num_gaps_only)
-        cout << "WARNING: " << num_gaps_only << " sites contain only gaps or ambiguous characters." << endl;
-    if (err_str.str() != "")
-        throw err_str.str();
-    return 1;
+    // release the converted columns
+    for (seq = 0; seq < nseq; seq++)
+        sequences[seq].erase(0, nsite);
+    return num_gaps_only;
 }
 
-void processSeq(string &sequence, string &line, int line_num) {
+void processSeq(string &sequence, string &line, int line_num, bool verbose = true) {
     for (string::iterator it = line.begin(); it != line.end(); it++) {
         if ((*it) <= ' ') continue;
         if (isalnum(*it) || (*it) == '-' || (*it) == '?'|| (*it) == '.' || (*it) == '*' || (*it) == '~')
@@ -1616,7 +1712,8 @@ void processSeq(string &sequence, string &line, int line_num) {
             if (it == line.end())
                 throw "Line " + convertIntToString(line_num) + ": No matching close-bracket ) or } found";
             sequence.append(1, '?');
-            cout << "NOTE: Line " << line_num << ": " << line.substr(start_it-line.begin(), (it-start_it)+1) << " is treated as unknown character" << endl;
+            if (verbose)
+                cout << "NOTE: Line " << line_num << ": " << line.substr(start_it-line.begin(), (it-start_it)+1) << " is treated as unknown character" << endl;
         } else {
             throw "Line " + convertIntToString(line_num) + ": Unrecognized character "  + *it;
         }
@@ -1627,76 +1724,115 @@ int Alignment::readPhylip(char *filename, char *sequence_type) {
 
     StrVector sequences;
     ostringstream err_str;
-    igzstream in;
-    int line_num = 1;
-    // set the failbit and badbit
-    in.exceptions(ios::failbit | ios::badbit);
-    in.open(filename);
     int nseq = 0, nsite = 0;
-    int seq_id = 0;
-    string line;
-    // remove the failbit
-    in.exceptions(ios::badbit);
     bool tina_state = (sequence_type && (strcmp(sequence_type,"TINA") == 0 || strcmp(sequence_type,"MULTI") == 0));
     num_states = 0;
 
-    for (; !in.eof(); line_num++) {
-        safeGetline(in, line);
-        line = line.substr(0, line.find_first_of("\n\r"));
-        if (line == "") continue;
-
-        //cout << line << endl;
-        if (nseq == 0) { // read number of sequences and sites
-            istringstream line_in(line);
-            if (!(line_in >> nseq >> nsite))
-                throw "Invalid PHYLIP format. First line must contain number of sequences and sites";
-            //cout << "nseq: " << nseq << "  nsite: " << nsite << endl;
-            if (nseq < 3)
-                throw "There must be at least 3 sequences";
-            if (nsite < 1)
-                throw "No alignment columns";
-
-            seq_names.resize(nseq, "");
-            sequences.resize(nseq, "");
-
-        } else { // read sequence contents
-            if (seq_names[seq_id] == "") { // cut out the sequence name
-                string::size_type pos = line.find_first_of(" \t");
-                if (pos == string::npos) pos = 10; //  assume standard phylip
-                seq_names[seq_id] = line.substr(0, pos);
-                line.erase(0, pos);
-            }
-            int old_len = sequences[seq_id].length();
-            if (tina_state) {
-                stringstream linestr(line);
-                int state;
-                while (!linestr.eof() ) {
-                    state = -1;
-                    linestr >> state;
-                    if (state < 0) break;
-                    sequences[seq_id].append(1, state);
-                    if (num_states < state+1) num_states = state+1;
+    // the file is read twice: the first pass only collects names, lengths and character
+    // counts, the second pass converts every ALN_BATCH_SITES columns into patterns,
+    // so that the whole alignment is never held in memory as strings
+    vector<size_t> char_count(NUM_CHAR, 0);
+    IntVector seq_lengths;
+    int first_site = 0, step = 1, num_error = 0, num_gaps_only = 0;
+
+    for (int pass = 0; pass < 2; pass++) {
+        igzstream in;
+        int line_num = 1;
+        // set the failbit and badbit
+        in.exceptions(ios::failbit | ios::badbit);
+        in.open(filename);
+        bool header = false;
+        int seq_id = 0;
+        string line, seq_line;
+        StrVector names(nseq, "");
+        // remove the failbit
+        in.exceptions(ios::badbit);
+
+        for (; !in.eof(); line_num++) {
+            safeGetline(in, line);
+            line = line.substr(0, line.find_first_of("\n\r"));
+            if (line == "") continue;
+
+            //cout << line << endl;
+            if (!header) { // read number of sequences and sites
+                header = true;
+                if (pass > 0) continue;
+                istringstream line_in(line);
+                if (!(line_in >> nseq >> nsite))
+                    throw "Invalid PHYLIP format. First line must contain number of sequences and sites";
+                //cout << "nseq: " << nseq << "  nsite: " << nsite << endl;
+                if (nseq < 3)
+                    throw "There must be at least 3 sequences";
+                if (nsite < 1)
+                    throw "No alignment columns";
+
+                names.resize(nseq, "");
+                seq_lengths.resize(nseq, 0);
+
+            } else { // read sequence contents
+                if (names[seq_id] == "") { // cut out the sequence name
+                    string::size_type pos = line.find_first_of(" \t");
+                    if (pos == string::npos) pos = 10; //  assume standard phylip
+                    names[seq_id] = line.substr(0, pos);
+                    line.erase(0, pos);
+                }
+                seq_line.clear();
+                if (tina_state) {
+                    stringstream linestr(line);
+                    int state;
+                    while (!linestr.eof() ) {
+                        state = -1;
+                        linestr >> state;
+                        if (state < 0) break;
+                        seq_line.append(1, state);
+                        if (num_states < state+1) num_states = state+1;
+                    }
+                } else processSeq(seq_line, line, line_num, pass == 0);
+                if (pass == 0) {
+                    for (string::iterator it = seq_line.begin(); it != seq_line.end(); it++)
+                        char_count[(unsigned char)(*it)]++;
+                    seq_lengths[seq_id] += seq_line.length();
+                    if (seq_lengths[seq_id] != seq_lengths[0]) {
+                        err_str << "Line " << line_num << ": Sequence " << names[seq_id] << " has wrong sequence length " << seq_lengths[seq_id] << endl;
+                        throw err_str.str();
+                    }
+                } else
+                    sequences[seq_id] += seq_line;
+                if (!seq_line.empty())
+                    seq_id++;
+                if (seq_id == nseq) {
+                    seq_id = 0;
+                    // all sequences have the same length at this moment
+                    if (pass > 0 && sequences[0].length() >= ALN_BATCH_SITES) {
+                        int ncol = sequences[0].length() - sequences[0].length() % step;
+                        num_gaps_only += addPatternBatch(sequences, ncol, first_site, sequence_type, err_str, num_error);
+                        first_site += ncol;
+                    }
                 }
-            } else processSeq(sequences[seq_id], line, line_num);
-            if (sequences[seq_id].length() != sequences[0].length()) {
-                err_str << "Line " << line_num << ": Sequence " << seq_names[seq_id] << " has wrong sequence length " << sequences[seq_id].length() << endl;
-                throw err_str.str();
-            }
-            if (sequences[seq_id].length() > old_len)
-                seq_id++;
-            if (seq_id == nseq) {
-                seq_id = 0;
-                // make sure that all sequences have the same length at this moment
             }
+            //sequences.
+        }
+        in.clear();
+        // set the failbit again
+        in.exceptions(ios::failbit | ios::badbit);
+        in.close();
+
+        if (pass == 0) {
+            seq_names = names;
+            initPatternBuilding(char_count, seq_lengths, sequence_type, nseq, nsite);
+            if (seq_type == SEQ_CODON || (sequence_type && strncmp(sequence_type, "NT2AA", 5) == 0))
+                step = 3;
+            sequences.resize(nseq, "");
         }
-        //sequences.
     }
-    in.clear();
-    // set the failbit again
-    in.exceptions(ios::failbit | ios::badbit);
-    in.close();
 
-    return buildPattern(sequences, sequence_type, nseq, nsite);
+    if (!sequences.empty())
+        num_gaps_only += addPatternBatch(sequences, sequences[0].length(), first_site, sequence_type, err_str, num_error);
+    if (num_gaps_only)
+        cout << "WARNING: " << num_gaps_only << " sites contain only gaps or ambiguous characters." << endl;
+    if (err_str.str() != "")
+        throw err_str.str();
+    return 1;
 }
 
 int Alignment::readPhylipSequential(char *filename, char *sequence_type) {
@@ -1761,12 +1897,20 @@ int Alignment::readPhylipSequential(char *filename, char *sequence_type) {
     return buildPattern(sequences, sequence_type, nseq, nsite);
 }
 
+/**
+    @return TRUE if the file starts with the gzip magic bytes
+*/
+static bool isGzipFile(char *filename) {
+    ifstream in(filename, ios::in | ios::binary);
+    unsigned char magic[2] = {0, 0};
+    in.read((char*)magic, 2);
+    return in.gcount() == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+}
+
 int Alignment::readFasta(char *filename, char *sequence_type) {
 
     StrVector sequences;
     ostringstream err_str;
-    igzstream in;
-    // ifstream in;
     int line_num = 1;
     string line;
 
@@ -1777,9 +1921,25 @@ int Alignment::readFasta(char *filename, char *sequence_type) {
     //         throw "PoMo does not support reading fasta files yet, please use a Counts File.";
     // }
 
+    // plain files are read twice: the first pass records names, lengths, character counts
+    // and where each sequence starts, the second pass collects ALN_BATCH_SITES columns
+    // at a time from all sequences and converts them into patterns.
+    // gzip files cannot seek cheaply and are kept in memory as before
+    bool keep_seqs = isGzipFile(filename);
+    igzstream gz_in;
+    ifstream plain_in;
+    istream &in = keep_seqs ? (istream&)gz_in : (istream&)plain_in;
+    vector<size_t> char_count(NUM_CHAR, 0);
+    IntVector seq_lengths;
+    vector<streamoff> seq_offsets;
+    IntVector seq_line_nums;
+
     // set the failbit and badbit
     in.exceptions(ios::failbit | ios::badbit);
-    in.open(filename);
+    if (keep_seqs)
+        gz_in.open(filename);
+    else
+        plain_in.open(filename, ios::in | ios::binary);
     // remove the failbit
     in.exceptions(ios::badbit);
 
@@ -1793,17 +1953,79 @@ int Alignment::readFasta(char *filename, char *sequence_type) {
             seq_names.push_back(line.substr(1, pos-1));
             trimString(seq_names.back());
             sequences.push_back("");
+            seq_lengths.push_back(0);
+            seq_offsets.push_back(keep_seqs ? 0 : (streamoff)in.tellg());
+            seq_line_nums.push_back(line_num + 1);
             continue;
         }
         // read sequence contents
         if (sequences.empty()) throw "First line must begin with '>' to define sequence name";
         processSeq(sequences.back(), line, line_num);
+        if (keep_seqs) continue;
+        for (string::iterator it = sequences.back().begin(); it != sequences.back().end(); it++)
+            char_count[(unsigned char)(*it)]++;
+        seq_lengths.back() += sequences.back().length();
+        sequences.back().clear();
     }
     in.clear();
     // set the failbit again
     in.exceptions(ios::failbit | ios::badbit);
-    in.close();
+    if (keep_seqs)
+        gz_in.close();
+    else
+        plain_in.close();
+
+    cutSeqNames();
+
+    if (keep_seqs)
+        return buildPattern(sequences, sequence_type, seq_names.size(), sequences.front().length());
+
+    int nseq = seq_names.size();
+    int nsite = seq_lengths.front();
+    initPatternBuilding(char_count, seq_lengths, sequence_type, nseq, nsite);
+    int step = ((seq_type == SEQ_CODON || (sequence_type && strncmp(sequence_type, "NT2AA", 5) == 0)) ? 3 : 1);
+    int batch_sites = ALN_BATCH_SITES - ALN_BATCH_SITES % step;
+    int num_error = 0, num_gaps_only = 0;
+
+    // second pass, each sequence is read from where the previous batch stopped
+    plain_in.exceptions(ios::failbit | ios::badbit);
+    plain_in.open(filename, ios::in | ios::binary);
+    plain_in.exceptions(ios::badbit);
+    for (int first_site = 0; first_site < nsite; first_site += batch_sites) {
+        int ncol = min(batch_sites, nsite - first_site);
+        for (int seq = 0; seq < nseq; seq++) {
+            if (sequences[seq].length() >= ncol)
+                continue;
+            plain_in.clear();
+            plain_in.seekg(seq_offsets[seq]);
+            while (sequences[seq].length() < ncol) {
+                // the file was changed or truncated since the first pass
+                if (plain_in.eof() || plain_in.fail())
+                    outError("Unexpected end of file " + string(filename) + " at line " +
+                             convertIntToString(seq_line_nums[seq]) + " while reading sequence " + seq_names[seq]);
+                safeGetline(plain_in, line);
+                if (!line.empty() && line[0] == '>')
+                    outError("Line " + convertIntToString(seq_line_nums[seq]) + ": sequence " + seq_names[seq] +
+                             " ends before site " + convertIntToString(first_site + ncol));
+                processSeq(sequences[seq], line, seq_line_nums[seq], false);
+                seq_line_nums[seq]++;
+            }
+            seq_offsets[seq] = plain_in.tellg();
+        }
+        num_gaps_only += addPatternBatch(sequences, ncol, first_site, sequence_type, err_str, num_error);
+    }
+    plain_in.clear();
+    plain_in.exceptions(ios::failbit | ios::badbit);
+    plain_in.close();
+
+    if (num_gaps_only)
+        cout << "WARNING: " << num_gaps_only << " sites contain only gaps or ambiguous characters." << endl;
+    if (err_str.str() != "")
+        throw err_str.str();
+    return 1;
+}
 
+void Alignment::cutSeqNames() {
     // now try to cut down sequence name if possible
     int i, j, step = 0;
     StrVector new_seq_names, remain_seq_names;
@@ -1841,8 +2063,286 @@ int Alignment::readFasta(char *filename, char *sequence_type) {
     }
 
     seq_names = new_seq_names;
+}
 
-    return buildPattern(sequences, sequence_type, seq_names.size(), sequences.front().length());
+/** header of the binary alignment cache, followed by the sequence type string, the sequence names
+    (length + characters), 4 ints per pattern (frequency, flag, num_chars, const_char),
+    the pattern states (state_width bytes each, pattern-major) and site_pattern.
+    Numbers are stored in the byte order of the machine that wrote the cache */
+struct AlnBinHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t source_crc;
+    uint64_t source_size;
+    int64_t source_mtime;
+    int32_t seq_type;
+    int32_t num_states;
+    uint32_t state_unknown;
+    int32_t nseq;
+    int32_t nsite;
+    int32_t npattern;
+    int32_t state_width;
+    int32_t type_len;
+};
+
+const char ALNBIN_MAGIC[8] = {'I', 'Q', 'A', 'L', 'N', 'B', 'I', 'N'};
+const uint32_t ALNBIN_VERSION = 1;
+
+/** read-only view of a whole file, memory-mapped where available */
+class MappedFile {
+public:
+    MappedFile(const char *filename) {
+        data = NULL;
+        size = 0;
+#if defined(_WIN32) || defined(WIN32)
+        ifstream in(filename, ios::in | ios::binary);
+        if (!in.is_open()) return;
+        buffer.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        data = buffer.data();
+        size = buffer.size();
+#else
+        int fd = open(filename, O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED) {
+                data = (const char*)addr;
+                size = st.st_size;
+            }
+        }
+        close(fd);
+#endif
+    }
+
+    ~MappedFile() {
+#if !defined(_WIN32) && !defined(WIN32)
+        if (data) munmap((void*)data, size);
+#endif
+    }
+
+    /** copy n bytes at pos into dest and advance pos, @return false if the file is too short */
+    bool read(size_t &pos, void *dest, size_t n) {
+        if (pos + n > size) return false;
+        memcpy(dest, data + pos, n);
+        pos += n;
+        return true;
+    }
+
+    const char *data;
+    size_t size;
+
+private:
+#if defined(_WIN32) || defined(WIN32)
+    string buffer;
+#endif
+};
+
+/**
+    @return CRC32 checksum of the whole file
+*/
+static uint32_t computeFileChecksum(const char *filename) {
+    ifstream in(filename, ios::in | ios::binary);
+    vector<char> buf(1 << 20);
+    uLong crc = crc32(0L, Z_NULL, 0);
+    while (in) {
+        in.read(buf.data(), buf.size());
+        if (in.gcount() > 0)
+            crc = crc32(crc, (const Bytef*)buf.data(), in.gcount());
+    }
+    return crc;
+}
+
+/**
+    check that the patterns and site patterns of the cache, starting at pos, describe an alignment of the
+    header: nsite sites in total, every pattern used by as many sites as its frequency, and no state
+    beyond STATE_UNKNOWN
+*/
+static bool checkBinaryCache(const MappedFile &cache, size_t pos, const AlnBinHeader &header) {
+    const char *info = cache.data + pos;
+    const char *states = info + (size_t)header.npattern * 4 * sizeof(int32_t);
+    const char *sites = states + (size_t)header.npattern * header.nseq * header.state_width;
+    IntVector freq(header.npattern, 0);
+    for (int site = 0; site < header.nsite; site++) {
+        int32_t ptn;
+        memcpy(&ptn, sites + (size_t)site * sizeof(int32_t), sizeof(ptn));
+        if (ptn < 0 || ptn >= header.npattern)
+            return false;
+        freq[ptn]++;
+    }
+    for (int ptn = 0; ptn < header.npattern; ptn++) {
+        int32_t frequency;
+        memcpy(&frequency, info + (size_t)ptn * 4 * sizeof(int32_t), sizeof(frequency));
+        if (frequency != freq[ptn])
+            return false;
+    }
+    size_t nstate = (size_t)header.npattern * header.nseq;
+    for (size_t i = 0; i < nstate; i++) {
+        uint32_t state;
+        if (header.state_width == 1)
+            state = (unsigned char)states[i];
+        else
+            memcpy(&state, states + i * sizeof(uint32_t), sizeof(state));
+        if (state > header.state_unknown)
+            return false;
+    }
+    return true;
+}
+
+bool Alignment::readBinaryCache(char *filename, char *sequence_type) {
+    string cache_file = string(filename) + ".alnbin";
+    struct stat src_stat;
+    if (stat(filename, &src_stat) != 0)
+        return false;
+    MappedFile cache(cache_file.c_str());
+    if (!cache.data)
+        return false;
+
+    AlnBinHeader header;
+    size_t pos = 0;
+    if (!cache.read(pos, &header, sizeof(header)) || memcmp(header.magic, ALNBIN_MAGIC, 8) != 0 ||
+        header.version != ALNBIN_VERSION || header.source_size != (uint64_t)src_stat.st_size)
+        return false;
+    string type(sequence_type ? sequence_type : "");
+    if (header.type_len != type.length() || pos + header.type_len > cache.size ||
+        type.compare(0, string::npos, cache.data + pos, header.type_len) != 0)
+        return false;
+    pos += header.type_len;
+    // the checksum is only needed if the source was touched after writing the cache
+    if (header.source_mtime != (int64_t)src_stat.st_mtime && header.source_crc != computeFileChecksum(filename))
+        return false;
+
+    // from here on the cache belongs to the alignment file, so any inconsistency means a damaged cache;
+    // the sizes are checked against the file size before anything is allocated from them
+    if (header.nseq < 3 || header.npattern < 1 || header.nsite < header.npattern ||
+        (header.state_width != 1 && header.state_width != 4) || header.num_states < 1 ||
+        header.state_unknown < (uint32_t)header.num_states ||
+        (header.state_width == 1 && header.state_unknown > 255) ||
+        (size_t)header.nseq * sizeof(uint32_t) > cache.size - pos) {
+        outWarning("Ignoring invalid alignment cache " + cache_file);
+        return false;
+    }
+    StrVector names(header.nseq);
+    for (int seq = 0; seq < header.nseq; seq++) {
+        uint32_t len;
+        if (!cache.read(pos, &len, sizeof(len)) || len == 0 || len > cache.size - pos) {
+            outWarning("Ignoring truncated alignment cache " + cache_file);
+            return false;
+        }
+        names[seq].assign(cache.data + pos, len);
+        pos += len;
+    }
+    size_t pattern_bytes = (size_t)header.npattern * 4 * sizeof(int32_t);
+    size_t state_bytes = (size_t)header.npattern * header.nseq * header.state_width;
+    if (pos + pattern_bytes + state_bytes + (size_t)header.nsite * sizeof(int32_t) != cache.size) {
+        outWarning("Ignoring truncated alignment cache " + cache_file);
+        return false;
+    }
+    if (!checkBinaryCache(cache, pos, header)) {
+        outWarning("Ignoring invalid alignment cache " + cache_file);
+        return false;
+    }
+
+    // the cache is valid, restore the alignment
+    seq_names = names;
+    if (sequence_type && (strncmp(sequence_type, "CODON", 5) == 0 || strncmp(sequence_type, "NT2AA", 5) == 0))
+        initCodon(&sequence_type[5]);
+    seq_type = (SeqType)header.seq_type;
+    num_states = header.num_states;
+    STATE_UNKNOWN = header.state_unknown;
+
+    const char *states = cache.data + pos + pattern_bytes;
+    resize(header.npattern);
+    for (int ptn = 0; ptn < header.npattern; ptn++) {
+        Pattern &pat = at(ptn);
+        int32_t info[4];
+        cache.read(pos, info, sizeof(info));
+        pat.frequency = info[0];
+        pat.flag = info[1];
+        pat.num_chars = info[2];
+        pat.const_char = info[3];
+        pat.resize(header.nseq);
+        if (header.state_width == 1) {
+            for (int seq = 0; seq < header.nseq; seq++)
+                pat[seq] = (unsigned char)states[seq];
+        } else
+            memcpy(&pat[0], states, header.nseq * sizeof(StateType));
+        states += header.nseq * header.state_width;
+    }
+    pos += state_bytes;
+    site_pattern.resize(header.nsite);
+    cache.read(pos, &site_pattern[0], header.nsite * sizeof(int32_t));
+    // hashing all patterns is what the cache saves, most runs never look a pattern up
+    pattern_index.clear();
+    pattern_index_lazy = true;
+    return true;
+}
+
+void Alignment::restorePatternIndex() {
+    pattern_index.clear();
+    for (int ptn = 0; ptn < size(); ptn++)
+        pattern_index[at(ptn)] = ptn;
+    pattern_index_lazy = false;
+}
+
+void Alignment::writeBinaryCache(char *filename, char *sequence_type) {
+    string cache_file = string(filename) + ".alnbin";
+    string tmp_file = cache_file + ".tmp";
+    struct stat src_stat;
+    if (stat(filename, &src_stat) != 0)
+        return;
+
+    AlnBinHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ALNBIN_MAGIC, 8);
+    header.version = ALNBIN_VERSION;
+    header.source_crc = computeFileChecksum(filename);
+    header.source_size = src_stat.st_size;
+    header.source_mtime = src_stat.st_mtime;
+    header.seq_type = seq_type;
+    header.num_states = num_states;
+    header.state_unknown = STATE_UNKNOWN;
+    header.nseq = getNSeq();
+    header.nsite = getNSite();
+    header.npattern = getNPattern();
+    header.state_width = (STATE_UNKNOWN < 256) ? 1 : 4;
+    string type(sequence_type ? sequence_type : "");
+    header.type_len = type.length();
+
+    ofstream out(tmp_file.c_str(), ios::out | ios::binary);
+    if (!out.is_open()) {
+        outWarning("Cannot write alignment cache " + cache_file);
+        return;
+    }
+    out.write((char*)&header, sizeof(header));
+    out.write(type.c_str(), type.length());
+    for (StrVector::iterator it = seq_names.begin(); it != seq_names.end(); it++) {
+        uint32_t len = it->length();
+        out.write((char*)&len, sizeof(len));
+        out.write(it->c_str(), len);
+    }
+    for (iterator it = begin(); it != end(); it++) {
+        int32_t info[4] = {it->frequency, it->flag, it->num_chars, it->const_char};
+        out.write((char*)info, sizeof(info));
+    }
+    vector<unsigned char> states(header.nseq);
+    for (iterator it = begin(); it != end(); it++) {
+        if (header.state_width == 1) {
+            for (int seq = 0; seq < header.nseq; seq++)
+                states[seq] = (*it)[seq];
+            out.write((char*)&states[0], header.nseq);
+        } else
+            out.write((char*)&(*it)[0], header.nseq * sizeof(StateType));
+    }
+    out.write((char*)&site_pattern[0], site_pattern.size() * sizeof(int));
+    out.close();
+    // rename after writing so that a concurrent run never maps a partial cache
+    if (!out || rename(tmp_file.c_str(), cache_file.c_str()) != 0) {
+        remove(tmp_file.c_str());
+        outWarning("Cannot write alignment cache " + cache_file);
+        return;
+    }
+    cout << "Alignment cache written to " << cache_file << endl;
 }
 
 int Alignment::readClustal(char *filename, char *sequence_type) {
@@ -3464,6 +3964,8 @@ void Alignment::countConstSite() {
 
 string Alignment::getUnobservedConstPatterns() {
 	string ret = "";
+	if (pattern_index_lazy)
+		restorePatternIndex();
 	for (char state = 0; state < num_states; state++)
     if (!isStopCodon(state))
     {
@@ -4377,6 +4879,8 @@ void Alignment::multinomialProb(Alignment refAlign, double &prob)
     double sumProb = 0;
     double fac = logFac(nsite);
     int index;
+    if (refAlign.pattern_index_lazy)
+        refAlign.restorePatternIndex();
     for ( iterator it = begin(); it != end() ; it++)
     {
         PatternIntMap::iterator pat_it = refAlign.pattern_index.find((*it));
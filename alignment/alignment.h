@@ -32,6 +32,7 @@ const unsigned char STATE_INVALID = 127;
 const int NUM_CHAR = 256;
 const double MIN_FREQUENCY          = 0.0001;
 const double MIN_FREQUENCY_DIFF     = 0.00001;
+const int ALN_BATCH_SITES           = 1 << 16; // columns converted to patterns at once when streaming
 
 typedef bitset<NUM_CHAR> StateBitset;
 
@@ -41,25 +42,41 @@ enum SeqType {
 
 
 #ifdef USE_HASH_MAP
-struct hashPattern {
-	size_t operator()(const vector<StateType> &sp) const {
-		size_t sum = 0;
-		for (Pattern::const_iterator it = sp.begin(); it != sp.end(); it++)
-			sum = (*it) + (sum << 6) + (sum << 16) - sum;
-		return sum;
-	}
-};
 typedef unordered_map<string, int> StringIntMap;
 typedef unordered_map<string, double> StringDoubleHashMap;
-typedef unordered_map<vector<StateType>, int, hashPattern> PatternIntMap;
 typedef unordered_map<uint32_t, uint32_t> IntIntMap;
 #else
 typedef map<string, int> StringIntMap;
 typedef map<string, double> StringDoubleHashMap;
-typedef map<vector<StateType>, int> PatternIntMap;
 typedef map<uint32_t, uint32_t> IntIntMap;
 #endif
 
+/**
+    map from site-pattern to pattern index.
+    Patterns are stored as packed keys with 2, 4, 8, 16 or 32 bits per state, the width being
+    the smallest one that holds the largest state of the pattern (e.g. 2 bits for a gap-free
+    DNA pattern, 8 bits for protein). The key store thus costs a fraction of the 32-bit Pattern
+    and hashing runs over the packed bytes. All patterns in one map have the same length (#sequences).
+*/
+class PatternIntMap : public StringIntMap {
+public:
+
+    /**
+        pack a pattern into a key
+        @param pat site-pattern
+        @return packed key, first byte is the bit width per state
+    */
+    static string packPattern(const vector<StateType> &pat);
+
+    inline iterator find(const vector<StateType> &pat) {
+        return StringIntMap::find(packPattern(pat));
+    }
+
+    inline int &operator[](const vector<StateType> &pat) {
+        return StringIntMap::operator[](packPattern(pat));
+    }
+};
+
 /**
 Multiple Sequence Alignment. Stored by a vector of site-patterns
 
@@ -142,6 +159,30 @@ public:
 
     int buildPattern(StrVector &sequences, char *sequence_type, int nseq, int nsite);
 
+    /**
+        check sequence names and lengths, detect the sequence type and reset patterns,
+        first step of building patterns from sequences
+        @param char_count number of occurrences of each character over the whole alignment
+        @param seq_lengths length of each sequence
+        @param sequence_type type of the sequence, either "BIN", "DNA", "AA", or NULL
+        @param nseq number of sequences
+        @param nsite number of sites
+     */
+    void initPatternBuilding(vector<size_t> &char_count, IntVector &seq_lengths, char *sequence_type, int nseq, int nsite);
+
+    /**
+        convert the leading columns of the sequences into patterns and remove them
+        from the sequences, called after initPatternBuilding
+        @param sequences buffered columns, one string per sequence
+        @param nsite number of leading columns to convert, a multiple of 3 for codon data
+        @param first_site position of the first column of the batch in the alignment
+        @param sequence_type type of the sequence, either "BIN", "DNA", "AA", or NULL
+        @param[in,out] err_str error messages
+        @param[in,out] num_error number of errors
+        @return number of sites containing only gaps or ambiguous characters
+     */
+    int addPatternBatch(StrVector &sequences, int nsite, int first_site, char *sequence_type, ostringstream &err_str, int &num_error);
+
     /**
             read the alignment in PHYLIP format (interleaved)
             @param filename file name
@@ -166,6 +207,28 @@ public:
      */
     int readFasta(char *filename, char *sequence_type);
 
+    /**
+            shorten sequence names at the first blank, taking more words if names become duplicated
+     */
+    void cutSeqNames();
+
+    /**
+            load the built alignment from the binary cache filename.alnbin, which is memory-mapped
+            @param filename alignment file name
+            @param sequence_type user sequence type, must be the one the cache was written with
+            pattern_index is only restored when first needed (restorePatternIndex)
+            @return true if loaded, false if the cache is missing, truncated, inconsistent or older than
+            the alignment file; nothing is changed in that case and the alignment file is parsed instead
+     */
+    bool readBinaryCache(char *filename, char *sequence_type);
+
+    /**
+            save the built alignment into the binary cache filename.alnbin
+            @param filename alignment file name
+            @param sequence_type user sequence type
+     */
+    void writeBinaryCache(char *filename, char *sequence_type);
+
     /** 
      * Read the alignment in counts format (PoMo).
      *
@@ -229,6 +292,19 @@ public:
      ****************************************************************************/
     SeqType detectSequenceType(StrVector &sequences);
 
+    /**
+        detect the sequence type from character frequencies
+        @param char_count number of occurrences of each character, NUM_CHAR entries
+     */
+    SeqType detectSequenceType(vector<size_t> &char_count);
+
+    /**
+        count the occurrences of each character
+        @param sequences sequences
+        @param[out] char_count NUM_CHAR entries, counts are added to existing values
+     */
+    static void countChars(StrVector &sequences, vector<size_t> &char_count);
+
     void computeUnknownState();
 
     void buildStateMap(char *map, SeqType seq_type);
@@ -726,6 +802,8 @@ public:
   IntIntMap pomo_sampled_states_index; // indexing, to quickly find if a PoMo-2-state is already present
 
     vector<vector<int> > seq_states; // state set for each sequence in the alignment
+    bool seq_states_unobs_const; // TRUE if seq_states contain the states of unobserved constant patterns
+    bool seq_states_fixed; // TRUE to keep seq_states, while models tested concurrently share the alignment
 
     /* for site-specific state frequency model with Huaichun, Edward, Andrew */
     
@@ -747,7 +825,7 @@ public:
 	 */
 	int getNumNonstopCodons();
 
-    /* build seq_states containing set of states per sequence
+    /* build seq_states containing set of states per sequence, nothing if seq_states_fixed
      * @param add_unobs_const TRUE to add all unobserved constant states (for +ASC model)
      */
     void buildSeqStates(bool add_unobs_const = false);
@@ -823,6 +901,16 @@ protected:
      */
     PatternIntMap pattern_index;
 
+    /**
+            TRUE if pattern_index is not built yet for patterns loaded from the binary cache
+     */
+    bool pattern_index_lazy;
+
+    /**
+            build pattern_index of patterns loaded from the binary cache, when first needed
+     */
+    void restorePatternIndex();
+
 
     /**
 	 * special initialization for codon sequences, e.g., setting #states, genetic_code
@@ -134,16 +134,21 @@ double AlignmentPairwise::computeFunction(double value) {
 		return lh;
 	}
     
-    double *trans_mat = new double[trans_size];
+    // transition matrices of all categories at once
+    double *trans_mat = new double[trans_size*ncat];
+    double times[ncat];
+    for (cat = 0; cat < ncat; cat++)
+        times[cat] = value * site_rate->getRate(cat);
 
     // categorized rates
     if (site_rate->getPtnCat(0) >= 0) {
+        tree->getModelFactory()->computeTransMatrices(ncat, times, trans_mat);
         for (cat = 0; cat < ncat; cat++) {
-            tree->getModelFactory()->computeTransMatrix(value*site_rate->getRate(cat), trans_mat);
             double *pair_pos = pair_freq + cat*trans_size;
+            double *cat_trans_mat = trans_mat + cat*trans_size;
             for (i = 0; i < trans_size; i++) if (pair_pos[i] > Params::getInstance().min_branch_length) {
-                    if (trans_mat[i] <= 0) throw "Negative transition probability";
-                    lh -= pair_pos[i] * log(trans_mat[i]);
+                    if (cat_trans_mat[i] <= 0) throw "Negative transition probability";
+                    lh -= pair_pos[i] * log(cat_trans_mat[i]);
                 }
         }
         delete [] trans_mat;
@@ -155,11 +160,12 @@ double AlignmentPairwise::computeFunction(double value) {
     if (tree->getModelFactory()->site_rate->getGammaShape() == 0.0)
         tree->getModelFactory()->computeTransMatrix(value, sum_trans_mat);
     else {
-        tree->getModelFactory()->computeTransMatrix(value * site_rate->getRate(0), sum_trans_mat);
+        tree->getModelFactory()->computeTransMatrices(ncat, times, trans_mat);
+        memcpy(sum_trans_mat, trans_mat, trans_size*sizeof(double));
         for (cat = 1; cat < ncat; cat++) {
-            tree->getModelFactory()->computeTransMatrix(value * site_rate->getRate(cat), trans_mat);
+            double *cat_trans_mat = trans_mat + cat*trans_size;
             for (i = 0; i < trans_size; i++)
-                sum_trans_mat[i] += trans_mat[i];
+                sum_trans_mat[i] += cat_trans_mat[i];
         }
     }
     for (i = 0; i < trans_size; i++) {
@@ -221,16 +227,27 @@ void AlignmentPairwise::computeFuncDerv(double value, double &df, double &ddf) {
         return;
     }
 
-    double *trans_mat = new double[trans_size];
-	double *trans_derv1 = new double[trans_size];
-	double *trans_derv2 = new double[trans_size];
+    // transition matrices and derivatives of all categories at once
+    double *trans_mats = new double[trans_size*ncat];
+	double *trans_derv1s = new double[trans_size*ncat];
+	double *trans_derv2s = new double[trans_size*ncat];
+    double times[ncat];
+    for (cat = 0; cat < ncat; cat++) {
+        double rate_val = site_rate->getRate(cat);
+        if (site_rate->getPtnCat(0) < 0 && tree->getModelFactory()->site_rate->getGammaShape() == 0.0)
+            rate_val = 1.0;
+        times[cat] = value * rate_val;
+    }
+    tree->getModelFactory()->computeTransDervs(ncat, times, trans_mats, trans_derv1s, trans_derv2s);
 
     // categorized rates
     if (site_rate->getPtnCat(0) >= 0) {
         for (cat = 0; cat < ncat; cat++) {
             double rate_val = site_rate->getRate(cat);
             double derv1 = 0.0, derv2 = 0.0;
-            tree->getModelFactory()->computeTransDerv(value*rate_val, trans_mat, trans_derv1, trans_derv2);
+            double *trans_mat = trans_mats + cat*trans_size;
+            double *trans_derv1 = trans_derv1s + cat*trans_size;
+            double *trans_derv2 = trans_derv2s + cat*trans_size;
             double *pair_pos = pair_freq + cat*trans_size;
             for (i = 0; i < trans_size; i++) if (pair_pos[i] > 0) {
                     if (trans_mat[i] <= 0) throw "Negative transition probability";
@@ -242,9 +259,9 @@ void AlignmentPairwise::computeFuncDerv(double value, double &df, double &ddf) {
             df -= derv1 * rate_val;
             ddf -= derv2 * rate_val * rate_val;
         }
-        delete [] trans_derv2;
-		delete [] trans_derv1;
-		delete [] trans_mat;
+        delete [] trans_derv2s;
+		delete [] trans_derv1s;
+		delete [] trans_mats;
 //        return lh;
         return;
     }
@@ -265,7 +282,9 @@ void AlignmentPairwise::computeFuncDerv(double value, double &df, double &ddf) {
 
         double coeff1 = rate_val * prop_val;
         double coeff2 = rate_val * coeff1;
-        tree->getModelFactory()->computeTransDerv(value * rate_val, trans_mat, trans_derv1, trans_derv2);
+        double *trans_mat = trans_mats + cat*trans_size;
+        double *trans_derv1 = trans_derv1s + cat*trans_size;
+        double *trans_derv2 = trans_derv2s + cat*trans_size;
         for (i = 0; i < trans_size; i++) {
             sum_trans[i] += trans_mat[i] * prop_val;
             sum_derv1[i] += trans_derv1[i] * coeff1;
@@ -289,9 +308,9 @@ void AlignmentPairwise::computeFuncDerv(double value, double &df, double &ddf) {
     delete [] sum_derv2;
 	delete [] sum_derv1;
 	delete [] sum_trans;
-	delete [] trans_derv2;
-	delete [] trans_derv1;
-	delete [] trans_mat;
+	delete [] trans_derv2s;
+	delete [] trans_derv1s;
+	delete [] trans_mats;
     // negative log-likelihood (for minimization)
 //    return lh;
     return;
@@ -55,6 +55,8 @@
 #include "model/modelfactorymixlen.h"
 //#include "guidedbootstrap.h"
 #include "model/modelset.h"
+#include "model/eigencache.h"
+#include "tree/partiallhcache.h"
 #include "utils/timeutil.h"
 #include "tree/upperbounds.h"
 #include "utils/MPIHelper.h"
@@ -1890,11 +1892,17 @@ void printFinalSearchInfo(Params &params, IQTree &iqtree, double search_cpu_time
 	params.run_time = (getCPUTime() - params.startCPUTime);
 	cout << endl;
 	cout << "Total number of iterations: " << iqtree.stop_rule.getCurIt() << endl;
+    if (params.lh_mem_save == LM_MEM_SAVE && !iqtree.isSuperTree())
+        iqtree.printMemSlotStats(cout);
+    EigenCache::getInstance().report(cout);
+    PartialLhCache::getInstance().report(cout);
 //    cout << "Total number of partial likelihood vector computations: " << iqtree.num_partial_lh_computations << endl;
 	cout << "CPU time used for tree search: " << search_cpu_time
 			<< " sec (" << convert_time(search_cpu_time) << ")" << endl;
 	cout << "Wall-clock time used for tree search: " << search_real_time
 			<< " sec (" << convert_time(search_real_time) << ")" << endl;
+    if (verbose_mode >= VB_MED)
+        iqtree.getCheckpoint()->printDumpStats(cout);
 	cout << "Total CPU time used: " << (double) params.run_time << " sec ("
 			<< convert_time((double) params.run_time) << ")" << endl;
 	cout << "Total wall-clock time used: "
@@ -2145,6 +2153,7 @@ void runTreeReconstruction(Params &params, IQTree* &iqtree) {
 
 
     iqtree->initializeAllPartialLh();
+    iqtree->resetMemSlotStats();
 	double initEpsilon = params.min_iterations == 0 ? params.modelEps : (params.modelEps*10);
 
 
@@ -2320,6 +2329,12 @@ void runTreeReconstruction(Params &params, IQTree* &iqtree) {
 	// restore pruned taxa
 	restoreTaxa(*iqtree, saved_dist_mat, pruned_taxa, linked_name);
 
+	if (params.lh32 && !iqtree->isSuperTree()) {
+		// the final optimization, branch supports and site likelihoods use full precision
+		iqtree->freeLh32Slots();
+		iqtree->setCurScore(iqtree->computeLikelihood());
+	}
+
 	double search_cpu_time = getCPUTime() - cputime_search_start;
 	double search_real_time = getRealTime() - realtime_search_start;
 
@@ -2357,7 +2372,7 @@ void runTreeReconstruction(Params &params, IQTree* &iqtree) {
             // why doing NNI search here?
 //            iqtree->doNNISearch();
             tree = iqtree->optimizeModelParameters(true);
-            iqtree->addTreeToCandidateSet(tree, iqtree->getCurScore(), false, MPIHelper::getInstance().getProcessID());
+            iqtree->addTreeToCandidateSet(tree, iqtree->getCurScore(), false, MPIHelper::getInstance().getProcessID(), iqtree);
             iqtree->getCheckpoint()->putBool("finishedModelFinal", true);
             iqtree->saveCheckpoint();
         }
@@ -3218,6 +3233,8 @@ void runPhyloAnalysis(Params &params, Checkpoint *checkpoint) {
 
     checkpoint->putBool("finished", false);
     checkpoint->setDumpInterval(params.checkpoint_dump_interval);
+    EigenCache::getInstance().setMemoryLimit((size_t)params.eigen_cache_size << 20);
+    PartialLhCache::getInstance().setMemoryLimit((size_t)params.partial_lh_cache_size << 20);
 
 	/****************** read in alignment **********************/
 	if (params.partition_file) {
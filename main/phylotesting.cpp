@@ -160,6 +160,7 @@ string getSeqTypeName(SeqType seq_type) {
         case SEQ_POMO: return "PoMo";
         case SEQ_UNKNOWN: return "unknown";
         case SEQ_MULTISTATE: return "MultiState";
+        default: ASSERT(0 && "Unprocessed seq_type"); return "";
     }
 }
 
@@ -1387,6 +1388,136 @@ void printModelFile(ostream &fmodel, Params &params, PhyloTree *tree, ModelInfo
     }
 }
 
+/**
+    get the models that differ from a given model only by having a nested rate heterogeneity,
+    closest first, e.g. GTR+F+G4 and GTR+F+I for GTR+F+I+G4, or GTR+F+R3 for GTR+F+R4
+    @param model_name model name
+    @param[out] nested names of the nested models
+*/
+static void getNestedRateModels(string &model_name, StrVector &nested) {
+    nested.clear();
+    size_t pos = min(model_name.find("+I"), min(model_name.find("+G"), model_name.find("+R")));
+    if (pos == string::npos)
+        return;
+    string subst = model_name.substr(0, pos);
+    string rate = model_name.substr(pos);
+    if (rate == "+I" || (rate[1] == 'G' && rate.find('+', 1) == string::npos)) {
+        nested.push_back(subst);
+        return;
+    }
+    if (rate.substr(0, 4) == "+I+G" && rate.find('+', 3) == string::npos) {
+        nested.push_back(subst + rate.substr(2));
+        nested.push_back(subst + "+I");
+        return;
+    }
+    bool invar = (rate.substr(0, 4) == "+I+R");
+    if (!invar && rate[1] != 'R')
+        return;
+    string ncat_str = rate.substr(invar ? 4 : 2);
+    if (ncat_str.empty() || ncat_str.find_first_not_of("0123456789") != string::npos)
+        return;
+    int ncat = convert_int(ncat_str.c_str());
+    if (ncat < 2)
+        return;
+    // splitting a category of +R[k-1] tends to stay in the +R[k-1] optimum, thus the
+    // FreeRate parameters are only taken from models with the same number of categories
+    if (ncat > 2)
+        nested.push_back(subst + (invar ? "+I+R" : "+R") + convertIntToString(ncat-1));
+    if (invar) {
+        nested.push_back(subst + "+R" + convertIntToString(ncat));
+        nested.push_back(subst + "+I");
+    } else if (ncat == 2)
+        nested.push_back(subst);
+}
+
+/**
+    @return TRUE if two checkpoint keys of rate heterogeneity models hold the same kind of parameter,
+    e.g. RateGamma!gamma_shape and RateGammaInvar!gamma_shape, or RateFree4!rates and RateFreeInvar4!rates
+*/
+static bool isSameRateParameter(const string &key1, const string &key2) {
+    size_t pos1 = key1.rfind(CKP_SEP), pos2 = key2.rfind(CKP_SEP);
+    if (pos1 == string::npos || pos2 == string::npos)
+        return false;
+    if (key1.substr(0, 4) != "Rate" || key2.substr(0, 4) != "Rate")
+        return false;
+    string param = key1.substr(pos1+1);
+    if (param != key2.substr(pos2+1))
+        return false;
+    if (param == "gamma_shape" || param == "p_invar")
+        return true;
+    string struct1 = key1.substr(0, pos1), struct2 = key2.substr(0, pos2);
+    size_t pos;
+    if ((pos = struct1.find("Invar")) != string::npos)
+        struct1.erase(pos, 5);
+    if ((pos = struct2.find("Invar")) != string::npos)
+        struct2.erase(pos, 5);
+    return struct1 == struct2;
+}
+
+/**
+    initialize the parameters and branch lengths of a model from the already fitted nested models,
+    so that e.g. GTR+F+I+G4 starts from the estimates of GTR+F+G4 and GTR+F+I
+    @param iqtree tree with the model initialized
+    @param model_info checkpoint with the fitted models
+    @param model_name model name
+    @param stage_info if not NULL, read-only checkpoint with further fitted models
+    @return name of the closest fitted nested model, empty if none was found
+*/
+static string warmStartModel(IQTree *iqtree, ModelCheckpoint &model_info, string &model_name,
+    ModelCheckpoint *stage_info)
+{
+    if (iqtree->isSuperTree() ||
+        posRateHeterotachy(model_name) != string::npos)
+        return "";
+    StrVector nested, fitted;
+    vector<ModelCheckpoint*> fitted_info;
+    getNestedRateModels(model_name, nested);
+    for (auto it = nested.begin(); it != nested.end(); it++)
+        if (model_info.hasKeyPrefix(*it + CKP_SEP)) {
+            fitted.push_back(*it);
+            fitted_info.push_back(&model_info);
+        } else if (stage_info && stage_info->hasKeyPrefix(*it + CKP_SEP)) {
+            fitted.push_back(*it);
+            fitted_info.push_back(stage_info);
+        }
+    if (fitted.empty())
+        return "";
+
+    ModelFactory *model_fac = iqtree->getModelFactory();
+    Checkpoint *orig_checkpoint = iqtree->getCheckpoint();
+
+    // parameter names of this model
+    Checkpoint model_keys;
+    model_fac->setCheckpoint(&model_keys);
+    model_fac->saveCheckpoint();
+
+    // the closest nested model is applied last and overrides the others
+    Checkpoint seed;
+    for (int i = fitted.size() - 1; i >= 0; i--) {
+        string prefix = fitted[i] + CKP_SEP;
+        ModelCheckpoint *info = fitted_info[i];
+        for (auto key = info->lower_bound(prefix);
+             key != info->end() && key->first.compare(0, prefix.length(), prefix) == 0; key++) {
+            string name = key->first.substr(prefix.length());
+            seed[name] = key->second;
+            // a rate parameter fitted with the same rate model takes precedence
+            for (auto model_key = model_keys.begin(); model_key != model_keys.end(); model_key++)
+                if (model_info.find(model_key->first) == model_info.end() &&
+                    isSameRateParameter(model_key->first, name))
+                    seed[model_key->first] = key->second;
+        }
+    }
+
+    model_fac->setCheckpoint(&seed);
+    model_fac->restoreCheckpoint();
+    // branch lengths of the closest nested model, read from the chain or the stage snapshot
+    iqtree->setCheckpoint(&seed);
+    iqtree->PhyloTree::restoreCheckpoint();
+    iqtree->setCheckpoint(orig_checkpoint);
+    model_fac->setCheckpoint(orig_checkpoint);
+    return fitted[0];
+}
+
 /**
     test one single model
     @param model_name model to be tested
@@ -1396,14 +1527,25 @@ void printModelFile(ostream &fmodel, Params &params, PhyloTree *tree, ModelInfo
     @param[out] info output model information
     @param models_block models block
     @param num_thread number of threads
+    @param ssize sample size for the information criteria
+    @param best_scores AIC, AICc and BIC scores of the best models so far,
+        NULL to always optimize the model to convergence
+    @param stage_info read-only checkpoint shared by concurrently tested models, with the
+        parameters and branch lengths of the models fitted before them (see getChainCheckpoint)
+    @param log if not NULL, stream for the verbose messages of this model instead of cout
     @return tree string
 */
 string testOneModel(string &model_name, Params &params, Alignment *in_aln,
     ModelCheckpoint &model_info, ModelInfo &info, ModelsBlock *models_block,
-    int &num_threads, int brlen_type)
+    int &num_threads, int brlen_type, int ssize = 0, double *best_scores = NULL,
+    ModelCheckpoint *stage_info = NULL, ostream *log = NULL)
 {
     IQTree *iqtree = NULL;
     if (in_aln->isSuperAlignment()) {
+        // the partition model names are set on the shared alignment: never run concurrently
+#ifdef _OPENMP
+        ASSERT(!omp_in_parallel());
+#endif
         SuperAlignment *saln = (SuperAlignment*)in_aln;
         if (params.partition_type == BRLEN_OPTIMIZE)
             iqtree = new PhyloSuperTree(saln);
@@ -1430,10 +1572,15 @@ string testOneModel(string &model_name, Params &params, Alignment *in_aln,
         model_name = iqtree->getModelName();
 
     info.name = model_name;
+    info.pruned_rounds = 0;
 
     if (info.restoreCheckpoint(&model_info)) {
-        delete iqtree;
-        return "";
+        if (!info.pruned_rounds || params.model_test_prune) {
+            delete iqtree;
+            return "";
+        }
+        // a pruned model was not optimized to convergence: optimize it now
+        info.pruned_rounds = 0;
     }
 
     if (params.model_test_and_tree) {
@@ -1512,9 +1659,14 @@ string testOneModel(string &model_name, Params &params, Alignment *in_aln,
     } else {
         //--- FIX TREE TOPOLOGY AND ESTIMATE MODEL PARAMETERS ----//
 
-        if (verbose_mode >= VB_MED)
-            cout << "Optimizing model " << info.name << endl;
+        ostream &out = log ? *log : cout;
+        bool verbose = log || verbose_mode >= VB_MED;
+        if (verbose)
+            out << "Optimizing model " << info.name << endl;
         iqtree->getModelFactory()->restoreCheckpoint();
+        string nested_name = warmStartModel(iqtree, model_info, info.name, stage_info);
+        if (verbose && !nested_name.empty())
+            out << "Initializing " << info.name << " from " << nested_name << endl;
 
         #ifdef _OPENMP
         if (num_threads <= 0) {
@@ -1526,13 +1678,26 @@ string testOneModel(string &model_name, Params &params, Alignment *in_aln,
 
         iqtree->initializeAllPartialLh();
 
+        double stop_logl = -DBL_MAX;
+        if (best_scores && params.model_test_prune && !iqtree->isSuperTree()) {
+            // log-likelihood this model needs to beat the best model under any criterion
+            double AIC, AICc, BIC;
+            computeInformationScores(0.0, iqtree->getModelFactory()->getNParameters(brlen_type), ssize,
+                AIC, AICc, BIC);
+            stop_logl = min(min(AIC - best_scores[0], AICc - best_scores[1]), BIC - best_scores[2]) / 2.0;
+        }
+
         for (int step = 0; step < 2; step++) {
             info.logl = iqtree->getModelFactory()->optimizeParameters(brlen_type, false,
-                TOL_LIKELIHOOD_MODELTEST, TOL_GRADIENT_MODELTEST);
+                TOL_LIKELIHOOD_MODELTEST, TOL_GRADIENT_MODELTEST, stop_logl);
             info.tree_len = iqtree->treeLength();
             iqtree->getModelFactory()->saveCheckpoint();
             iqtree->saveCheckpoint();
 
+            info.pruned_rounds = iqtree->getModelFactory()->pruned_rounds;
+            if (info.pruned_rounds)
+                break;
+
             // check if logl(+R[k]) is worse than logl(+R[k-1])
             ModelInfo prev_info;
             if (!prev_info.restoreCheckpointRminus1(&model_info, info.name)) break;
@@ -1540,10 +1705,19 @@ string testOneModel(string &model_name, Params &params, Alignment *in_aln,
             if (step == 0) {
                 iqtree->getRate()->initFromCatMinusOne();
             } else if (info.logl < prev_info.logl - TOL_LIKELIHOOD_MODELTEST) {
-                outWarning("Log-likelihood of " + info.name + " worse than " + prev_info.name);
+                if (log)
+                    *log << "WARNING: Log-likelihood of " << info.name << " worse than " << prev_info.name << endl;
+                else
+                    outWarning("Log-likelihood of " + info.name + " worse than " + prev_info.name);
             }
         }
 
+        // keep the fitted parameters and branch lengths of this model for warm-starting the models it is nested in
+        model_info.startStruct(info.name);
+        iqtree->getModelFactory()->saveCheckpoint();
+        iqtree->PhyloTree::saveCheckpoint();
+        model_info.endStruct();
+
     }
 
     info.df = iqtree->getModelFactory()->getNParameters(brlen_type);
@@ -2134,6 +2308,75 @@ ModelMarkov* getPrototypeModel(SeqType seq_type, PhyloTree* tree, char *model_se
 */
 
 
+/**
+    work (#patterns x #states) per likelihood evaluation that keeps one thread busy;
+    used to choose how many threads each model gets when models are tested concurrently
+*/
+const double MODEL_COST_PER_THREAD = 20000.0;
+
+/**
+    position of the +R/+H (or *R/*H) rate component in a model name
+    @return position or string::npos if not found
+*/
+static size_t findRateSeries(string &model_name) {
+    const char *rates[] = {"+R", "*R", "+H", "*H"};
+    size_t posR = string::npos;
+    for (int i = 0; i < sizeof(rates)/sizeof(char*); i++)
+        if ((posR = model_name.find(rates[i])) != string::npos)
+            break;
+    return posR;
+}
+
+/**
+    @return TRUE if both models are of the same +R/+H series with different number of categories
+*/
+static bool isSameRateSeries(string &model1, string &model2) {
+    size_t posR = findRateSeries(model1);
+    if (posR == string::npos)
+        return false;
+    return model2.substr(0, posR+2) == model1.substr(0, posR+2);
+}
+
+/**
+    check stop criterion for +R: whether model is worse than the one with one category less
+    @return TRUE if remaining models of higher categories should be skipped
+*/
+static bool isWorseThanRminus1(Params &params, ModelCheckpoint &model_info, ModelInfo &info, int ssize) {
+    if (info.pruned_rounds)
+        return false;
+    ModelInfo prev_info;
+    if (!prev_info.restoreCheckpointRminus1(&model_info, info.name))
+        return false;
+    prev_info.computeICScores(ssize);
+    switch (params.model_test_criterion) {
+    case MTC_ALL:
+        return info.AIC_score > prev_info.AIC_score &&
+            info.AICc_score > prev_info.AICc_score &&
+            info.BIC_score > prev_info.BIC_score;
+    case MTC_AIC:
+        return info.AIC_score > prev_info.AIC_score;
+    case MTC_AICC:
+        return info.AICc_score > prev_info.AICc_score;
+    case MTC_BIC:
+        return info.BIC_score > prev_info.BIC_score;
+    }
+    return false;
+}
+
+/**
+    checkpoint of a chain of concurrently tested models: the snapshot taken at stage start without
+    the fitted parameters of the models (kept under their names), which testOneModel reads from
+    the shared snapshot instead
+*/
+static void getChainCheckpoint(ModelCheckpoint &stage_info, ModelCheckpoint &chain_info) {
+    for (auto it = stage_info.begin(); it != stage_info.end(); it++) {
+        size_t pos = it->first.find(CKP_SEP);
+        if (pos != string::npos && stage_info.find(it->first.substr(0, pos)) != stage_info.end())
+            continue;
+        chain_info.insert(chain_info.end(), *it);
+    }
+}
+
 string testModel(Params &params, PhyloTree* in_tree, ModelCheckpoint &model_info, ModelsBlock *models_block,
     int num_threads, int brlen_type, string set_name, bool print_mem_usage, string in_model_name)
 {
@@ -2214,6 +2457,7 @@ string testModel(Params &params, PhyloTree* in_tree, ModelCheckpoint &model_info
     string best_model_AIC, best_model_AICc, best_model_BIC;
     double best_score_AIC = DBL_MAX, best_score_AICc = DBL_MAX, best_score_BIC = DBL_MAX;
     string best_tree_AIC, best_tree_AICc, best_tree_BIC;
+    int num_pruned = 0;
 
     CKP_RESTORE(best_tree_AIC);
     CKP_RESTORE(best_tree_AICc);
@@ -2225,9 +2469,30 @@ string testModel(Params &params, PhyloTree* in_tree, ModelCheckpoint &model_info
 
     //------------- MAIN FOR LOOP GOING THROUGH ALL MODELS TO BE TESTED ---------//
 
-	for (model = 0; model < model_names.size(); model++) {
-		//cout << model_names[model] << endl;
-        if (model_names[model][0] == '+') {
+    // -mpar: every chain of models starts from the results at the start of its stage, whatever the
+    // number of models tested concurrently, so that the results do not depend on -nt
+    bool snapshot = params.model_test_parallel && !params.model_test_and_tree;
+
+    // number of models tested concurrently and number of threads per model
+    int model_jobs = 1, model_threads = num_threads;
+#ifdef _OPENMP
+    if (snapshot && num_threads > 1) {
+        // single-model likelihood scales poorly on small alignments: size the per-model
+        // thread count from the work per likelihood evaluation and use the rest for more models
+        double cost = (double)in_tree->aln->getNPattern() * in_tree->aln->num_states;
+        model_threads = max(1, min(num_threads, (int)(cost / MODEL_COST_PER_THREAD)));
+        model_jobs = num_threads / model_threads;
+        if (model_jobs > 1 && verbose_mode >= VB_MED)
+            cout << "Testing " << model_jobs << " models concurrently with "
+                << model_threads << " thread(s) each" << endl;
+    }
+    if (model_jobs == 1)
+        model_threads = num_threads;
+#endif
+
+	for (int stage_start = 0; stage_start < model_names.size(); ) {
+        int stage_end;
+        if (model_names[stage_start][0] == '+') {
             // now switching to test rate heterogeneity
             if (best_model == "")
                 switch (params.model_test_criterion) {
@@ -2242,124 +2507,201 @@ string testModel(Params &params, PhyloTree* in_tree, ModelCheckpoint &model_info
                     break;
                 default: ASSERT(0);
                 }
-            model_names[model] = best_model + model_names[model];
-        }
-
-		// optimize model parameters
-        string orig_model_name = model_names[model];
-		ModelInfo info;
-		info.set_name = set_name;
-        string tree_string;
-
-        /***** main call to estimate model parameters ******/
-        tree_string = testOneModel(model_names[model], params, in_tree->aln,
-            model_info, info, models_block, num_threads, brlen_type);
-
-        info.computeICScores(ssize);
-        info.saveCheckpoint(checkpoint);
-
-        ModelInfo prev_info;
-
-        bool skip_model = false;
-
-        if (prev_info.restoreCheckpointRminus1(checkpoint, info.name)) {
-            // check stop criterion for +R
-            prev_info.computeICScores(ssize);
-            switch (params.model_test_criterion) {
-            case MTC_ALL:
-                if (info.AIC_score > prev_info.AIC_score &&
-                    info.AICc_score > prev_info.AICc_score &&
-                    info.BIC_score > prev_info.BIC_score) {
-                    // skip remaining model
-                    skip_model = true;
-                }
-                break;
-            case MTC_AIC:
-                if (info.AIC_score > prev_info.AIC_score) {
-                    // skip remaining model
-                    skip_model = true;
-                }
-                break;
-            case MTC_AICC:
-                if (info.AICc_score > prev_info.AICc_score) {
-                    // skip remaining model
-                    skip_model = true;
-                }
-                break;
-            case MTC_BIC:
-                if (info.BIC_score > prev_info.BIC_score) {
-                    // skip remaining model
-                    skip_model = true;
-                }
-                break;
-            }
+            for (model = stage_start; model < model_names.size(); model++)
+                if (model_names[model][0] == '+')
+                    model_names[model] = best_model + model_names[model];
+            stage_end = model_names.size();
+        } else {
+            // models up to the first rate-only model do not depend on each other's results
+            for (stage_end = stage_start; stage_end < model_names.size() && model_names[stage_end][0] != '+'; stage_end++);
         }
 
-		if (info.AIC_score < best_score_AIC) {
-            best_model_AIC = info.name;
-            best_score_AIC = info.AIC_score;
-            if (!tree_string.empty())
-                best_tree_AIC = tree_string;
-        }
-		if (info.AICc_score < best_score_AICc) {
-            best_model_AICc = info.name;
-            best_score_AICc = info.AICc_score;
-            if (!tree_string.empty())
-                best_tree_AICc = tree_string;
+        // group models into chains of +R/+H models which must be tested in order
+        IntVector chain_start;
+        for (model = stage_start; model < stage_end; model++)
+            if (model == stage_start || !isSameRateSeries(model_names[model-1], model_names[model]))
+                chain_start.push_back(model);
+        chain_start.push_back(stage_end);
+
+        vector<ModelInfo> infos(stage_end - stage_start);
+        StrVector tree_strings(stage_end - stage_start);
+        IntVector tested(stage_end - stage_start, 0);
+
+        // chains start from the same snapshot so that results do not depend on scheduling
+        ModelCheckpoint stage_info;
+        if (snapshot)
+            stage_info.insert(model_info.begin(), model_info.end());
+
+        int num_chains = chain_start.size() - 1;
+
+        // -mprune: chain c is compared with the best models after merging chain c-model_jobs,
+        // which is always merged when chain c starts, so that pruning does not depend on timing
+        double stage_best_scores[3] = {best_score_AIC, best_score_AICc, best_score_BIC};
+        DoubleVector chain_best_scores(3 * num_chains);
+        IntVector chain_merged(num_chains, 0);
+
+        // concurrent chains share the alignment: build seq_states once for all models of the stage,
+        // with the states of unobserved constant patterns if a model uses +ASC
+        if (model_jobs > 1) {
+            bool asc = false;
+            for (model = stage_start; model < stage_end; model++)
+                if (model_names[model].find("+ASC") != string::npos)
+                    asc = true;
+            in_tree->aln->buildSeqStates(asc);
+            in_tree->aln->seq_states_fixed = true;
         }
 
-		if (info.BIC_score < best_score_BIC) {
-			best_model_BIC = info.name;
-            best_score_BIC = info.BIC_score;
-            if (!tree_string.empty())
-                best_tree_BIC = tree_string;
-        }
+        // verbose messages of concurrent chains are printed in model order, deeper ones are not printed
+        VerboseMode orig_verbose = verbose_mode;
+        if (model_jobs > 1)
+            verbose_mode = min(verbose_mode, VB_MIN);
 
-        switch (params.model_test_criterion) {
-            case MTC_AIC: model_scores.push_back(info.AIC_score); break;
-            case MTC_AICC: model_scores.push_back(info.AICc_score); break;
-            default: model_scores.push_back(info.BIC_score); break;
-        }
+#ifdef _OPENMP
+        int max_levels = omp_get_max_active_levels();
+        if (model_jobs > 1)
+            omp_set_max_active_levels((model_threads > 1) ? 2 : 1);
+#pragma omp parallel for ordered schedule(dynamic, 1) num_threads(model_jobs) if(model_jobs > 1)
+#endif
+        for (int chain = 0; chain < num_chains; chain++) {
+            ModelCheckpoint local_info;
+            if (snapshot)
+                getChainCheckpoint(stage_info, local_info);
+            ModelCheckpoint &chain_info = snapshot ? local_info : model_info;
+            int chain_threads = model_threads;
+            ostringstream chain_log;
+
+            double best_scores[3];
+#ifdef _OPENMP
+#pragma omp critical(model_best_scores)
+#endif
+            {
+                int prev = chain - model_jobs;
+                ASSERT(prev < 0 || chain_merged[prev]);
+                for (int i = 0; i < 3; i++)
+                    best_scores[i] = (prev < 0) ? stage_best_scores[i] : chain_best_scores[3*prev + i];
+            }
 
-        CKP_SAVE(best_tree_AIC);
-        CKP_SAVE(best_tree_AICc);
-        CKP_SAVE(best_tree_BIC);
-        checkpoint->dump();
+            for (int m = chain_start[chain]; m < chain_start[chain+1]; m++) {
+                ModelInfo &info = infos[m - stage_start];
+                info.set_name = set_name;
 
+                /***** main call to estimate model parameters ******/
+                tree_strings[m - stage_start] = testOneModel(model_names[m], params, in_tree->aln,
+                    chain_info, info, models_block, chain_threads, brlen_type, ssize, best_scores,
+                    snapshot ? &stage_info : NULL, (model_jobs > 1 && orig_verbose >= VB_MED) ? &chain_log : NULL);
 
-		if (set_name == "") {
-            cout.width(3);
-            cout << right << model+1 << "  ";
-            cout.width(13);
-            cout << left << info.name << " ";
-            
-            cout.precision(3);
-            cout << fixed;
-            cout.width(12);
-            cout << -info.logl << " ";
-            cout.width(3);
-            cout << info.df << " ";
-            cout.width(12);
-            cout << info.AIC_score << " ";
-            cout.width(12);
-            cout << info.AICc_score << " " << info.BIC_score;
-            cout << endl;
-        }
+                info.computeICScores(ssize);
+                info.saveCheckpoint(&chain_info);
+                best_scores[0] = min(best_scores[0], info.AIC_score);
+                best_scores[1] = min(best_scores[1], info.AICc_score);
+                best_scores[2] = min(best_scores[2], info.BIC_score);
+                tested[m - stage_start] = 1;
 
-        if (skip_model) {
-            // skip over all +R model of higher categories
-            const char *rates[] = {"+R", "*R", "+H", "*H"};
-            size_t posR;
-            for (int i = 0; i < sizeof(rates)/sizeof(char*); i++)
-                if ((posR = orig_model_name.find(rates[i])) != string::npos)
+                // skip over all +R model of higher categories
+                if (isWorseThanRminus1(params, chain_info, info, ssize))
                     break;
-            string first_part = orig_model_name.substr(0, posR+2);
-            while (model < model_names.size()-1 && model_names[model+1].substr(0, posR+2) == first_part) {
-                model++;
-                model_scores.push_back(DBL_MAX);
             }
-        }
 
+#ifdef _OPENMP
+#pragma omp ordered
+#endif
+            {
+                if (snapshot) {
+                    // merge entries changed by this chain, in model order
+                    for (auto it = local_info.begin(); it != local_info.end(); it++) {
+                        auto orig = stage_info.find(it->first);
+                        if (orig == stage_info.end() || orig->second != it->second)
+                            model_info.put(it->first, it->second);
+                    }
+                }
+                if (model_jobs == 1)
+                    model_threads = chain_threads;
+                cout << chain_log.str();
+
+                for (int m = chain_start[chain]; m < chain_start[chain+1]; m++) {
+                    if (!tested[m - stage_start]) {
+                        model_scores.push_back(DBL_MAX);
+                        continue;
+                    }
+                    ModelInfo &info = infos[m - stage_start];
+                    string &tree_string = tree_strings[m - stage_start];
+
+#ifdef _OPENMP
+#pragma omp critical(model_best_scores)
+#endif
+                    {
+                        if (info.AIC_score < best_score_AIC) {
+                            best_model_AIC = info.name;
+                            best_score_AIC = info.AIC_score;
+                            if (!tree_string.empty())
+                                best_tree_AIC = tree_string;
+                        }
+                        if (info.AICc_score < best_score_AICc) {
+                            best_model_AICc = info.name;
+                            best_score_AICc = info.AICc_score;
+                            if (!tree_string.empty())
+                                best_tree_AICc = tree_string;
+                        }
+
+                        if (info.BIC_score < best_score_BIC) {
+                            best_model_BIC = info.name;
+                            best_score_BIC = info.BIC_score;
+                            if (!tree_string.empty())
+                                best_tree_BIC = tree_string;
+                        }
+                    }
+                    if (info.pruned_rounds)
+                        num_pruned++;
+
+                    switch (params.model_test_criterion) {
+                        case MTC_AIC: model_scores.push_back(info.AIC_score); break;
+                        case MTC_AICC: model_scores.push_back(info.AICc_score); break;
+                        default: model_scores.push_back(info.BIC_score); break;
+                    }
+
+                    CKP_SAVE(best_tree_AIC);
+                    CKP_SAVE(best_tree_AICc);
+                    CKP_SAVE(best_tree_BIC);
+                    checkpoint->dump();
+
+                    if (set_name == "") {
+                        cout.width(3);
+                        cout << right << m+1 << "  ";
+                        cout.width(13);
+                        cout << left << info.name << " ";
+
+                        cout.precision(3);
+                        cout << fixed;
+                        cout.width(12);
+                        cout << -info.logl << " ";
+                        cout.width(3);
+                        cout << info.df << " ";
+                        cout.width(12);
+                        cout << info.AIC_score << " ";
+                        cout.width(12);
+                        cout << info.AICc_score << " " << info.BIC_score;
+                        if (info.pruned_rounds)
+                            cout << "  pruned after " << info.pruned_rounds << " iterations";
+                        cout << endl;
+                    }
+                }
+#ifdef _OPENMP
+#pragma omp critical(model_best_scores)
+#endif
+                {
+                    chain_best_scores[3*chain] = best_score_AIC;
+                    chain_best_scores[3*chain+1] = best_score_AICc;
+                    chain_best_scores[3*chain+2] = best_score_BIC;
+                    chain_merged[chain] = 1;
+                }
+            }
+        }
+#ifdef _OPENMP
+        omp_set_max_active_levels(max_levels);
+#endif
+        verbose_mode = orig_verbose;
+        in_tree->aln->seq_states_fixed = false;
+        stage_start = stage_end;
 	}
 
     ASSERT(model_scores.size() == model_names.size());
@@ -2368,6 +2710,8 @@ string testModel(Params &params, PhyloTree* in_tree, ModelCheckpoint &model_info
         outError("No models were examined! Please check messages above");
 
 	if (set_name == "") {
+        if (num_pruned)
+            cout << num_pruned << " models were not expected to beat the best model and not optimized to convergence (-mprune)" << endl;
 		cout << "Akaike Information Criterion:           " << best_model_AIC << endl;
 		cout << "Corrected Akaike Information Criterion: " << best_model_AICc << endl;
 		cout << "Bayesian Information Criterion:         " << best_model_BIC << endl;
@@ -2458,11 +2802,10 @@ int countDistinctTrees(const char *filename, bool rooted, IQTree *tree, IntVecto
 					treels[ostr.str()] = tree_id;
 				}
 			} else {
-				// ignore tree
-				char ch;
-				do {
-					in >> ch;
-				} while (!in.eof() && ch != ';');
+				// ignore tree, semi-colons in comments and quoted names do not end it
+				MTree mtree;
+				bool is_rooted = rooted;
+				mtree.readTree(in, is_rooted);
 				distinct_ids.push_back(-1);
 			}
 			char ch;
@@ -3019,6 +3362,207 @@ void performAUTest(Params &params, PhyloTree *tree, double *pattern_lhs, vector<
 }
 
 
+/** memory budget for the bootstrap replicates of the topology tests held at the same time */
+const size_t RELL_BLOCK_BYTES = 64 << 20;
+
+/**
+    add the RELL scores of a block of trees and replicates: lh[i][j] is the dot product of the
+    pattern log-likelihoods of tree i with the pattern counts of replicate j, summed in pattern order
+*/
+template <int NTREE, int NREP>
+static void computeRELLTile(double *pattern_lhs, size_t maxnptn, int *samples, size_t nptn,
+    size_t ntree, size_t nrep, double lh[NTREE][NREP])
+{
+    for (size_t i = 0; i < ntree; i++)
+        for (size_t j = 0; j < nrep; j++)
+            lh[i][j] = 0.0;
+    if (ntree == NTREE && nrep == NREP) {
+        for (size_t ptn = 0; ptn < nptn; ptn++)
+            for (int i = 0; i < NTREE; i++)
+                for (int j = 0; j < NREP; j++)
+                    lh[i][j] += pattern_lhs[i*maxnptn + ptn] * samples[j*nptn + ptn];
+    } else {
+        for (size_t ptn = 0; ptn < nptn; ptn++)
+            for (size_t i = 0; i < ntree; i++)
+                for (size_t j = 0; j < nrep; j++)
+                    lh[i][j] += pattern_lhs[i*maxnptn + ptn] * samples[j*nptn + ptn];
+    }
+}
+
+/**
+    compute RELL scores of a block of trees for the bootstrap replicates of the topology tests.
+    Instead of keeping all replicates, they are regenerated block by block from the same random
+    streams and in the same order as when creating all of them at once, such that the scores
+    do not change and every block of trees is scored on the same replicates.
+    @param pattern_lhs pattern log-likelihoods of size #trees x maxnptn
+    @param ntrees number of trees in the block
+    @param[out] tree_lhs RELL score matrix of size #trees x #replicates
+*/
+static void computeRELLScores(Params &params, PhyloTree *tree, double *pattern_lhs, size_t ntrees, double *tree_lhs) {
+    size_t nptn = tree->getAlnNPattern();
+    size_t maxnptn = get_safe_upper_limit(nptn);
+    size_t nboot = params.topotest_replicates;
+
+    // replicates [stream_start[s], stream_start[s+1]) are drawn one after another from stream s,
+    // as done by a static OpenMP schedule over all replicates
+    int nstreams = 1;
+#ifdef _OPENMP
+    if (nptn > 10000)
+        nstreams = omp_get_max_threads();
+#endif
+    vector<size_t> stream_start(nstreams+1);
+    for (int s = 0; s <= nstreams; s++)
+        stream_start[s] = s*(nboot/nstreams) + min((size_t)s, nboot%nstreams);
+    vector<int*> rstreams(nstreams, randstream);
+#ifdef _OPENMP
+    for (int s = 0; s < nstreams; s++)
+        init_random(params.ran_seed + s, false, &rstreams[s]);
+#endif
+
+    // number of replicates per stream in one block
+    size_t stream_block = max((size_t)1, RELL_BLOCK_BYTES / (nptn*sizeof(int)*nstreams));
+    stream_block = min(stream_block, stream_start[1] - stream_start[0]);
+    int *samples = new int[stream_block*nstreams*nptn];
+    vector<size_t> boot_ids, block_start(nstreams);
+
+    for (size_t offset = 0; offset < stream_start[1] - stream_start[0]; offset += stream_block) {
+        boot_ids.clear();
+        for (int s = 0; s < nstreams; s++) {
+            block_start[s] = boot_ids.size();
+            for (size_t boot = stream_start[s] + offset; boot < min(stream_start[s] + offset + stream_block, stream_start[s+1]); boot++)
+                boot_ids.push_back(boot);
+        }
+        size_t nrep = boot_ids.size();
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1) num_threads(nstreams) if(nstreams > 1)
+#endif
+        for (int s = 0; s < nstreams; s++) {
+            size_t first = stream_start[s] + offset;
+            size_t last = min(first + stream_block, stream_start[s+1]);
+            int *sample = samples + block_start[s]*nptn;
+            for (size_t boot = first; boot < last; boot++, sample += nptn)
+                if (boot == 0)
+                    tree->aln->getPatternFreq(sample);
+                else
+                    tree->aln->createBootstrapAlignment(sample, params.bootstrap_spec, rstreams[s]);
+        }
+
+        // blocked product of tree pattern log-likelihoods with replicate pattern counts
+        size_t ntiles = (nrep+3)/4;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) if(nptn*nrep*ntrees > 1000000)
+#endif
+        for (size_t tile = 0; tile < ntiles; tile++) {
+            size_t rep = tile*4;
+            size_t ntile_rep = min((size_t)4, nrep - rep);
+            double lh[4][4];
+            for (size_t tid = 0; tid < ntrees; tid += 4) {
+                size_t ntile_tree = min((size_t)4, ntrees - tid);
+                computeRELLTile<4,4>(pattern_lhs + tid*maxnptn, maxnptn, samples + rep*nptn, nptn,
+                    ntile_tree, ntile_rep, lh);
+                for (size_t i = 0; i < ntile_tree; i++)
+                    for (size_t j = 0; j < ntile_rep; j++)
+                        tree_lhs[(tid+i)*nboot + boot_ids[rep+j]] = lh[i][j];
+            }
+        }
+    }
+
+    delete [] samples;
+#ifdef _OPENMP
+    for (int s = 0; s < nstreams; s++)
+        finish_random(rstreams[s]);
+#endif
+}
+
+/**
+    read the next tree of the tree set and compute its log-likelihood
+    @param tree tree to read into
+    @param in stream of the tree set
+*/
+static void evaluateUserTree(Params &params, PhyloTree *tree, istream &in) {
+    tree->freeNode();
+    tree->readTree(in, tree->rooted);
+    if (!tree->findNodeName(tree->aln->getSeqName(0))) {
+        outError("Taxon " + tree->aln->getSeqName(0) + " not found in tree");
+    }
+
+    if (tree->rooted && tree->getModel()->isReversible()) {
+        if (tree->leafNum != tree->aln->getNSeq()+1)
+            outError("Tree does not have same number of taxa as alignment");
+        tree->convertToUnrooted();
+    } else if (!tree->rooted && !tree->getModel()->isReversible()) {
+        if (tree->leafNum != tree->aln->getNSeq())
+            outError("Tree does not have same number of taxa as alignment");
+        tree->convertToRooted();
+    }
+    tree->setAlignment(tree->aln);
+    tree->setRootNode(params.root);
+    if (tree->isSuperTree())
+        ((PhyloSuperTree*) tree)->mapTrees();
+
+    tree->initializeAllPartialLh();
+    tree->fixNegativeBranch(false);
+    if (!params.fixed_branch_length) {
+        tree->setCurScore(tree->optimizeAllBranches(100, 0.001));
+    } else {
+        tree->setCurScore(tree->computeLikelihood());
+    }
+}
+
+/**
+    read the distinct trees of the tree set
+    @param[out] texts Newick strings of the distinct trees
+*/
+static void readDistinctTrees(PhyloTree *tree, istream &in, IntVector &distinct_ids, StrVector &texts) {
+    // split the trees with the Newick parser, which skips semi-colons in comments and quoted names
+    for (int tree_index = 0; tree_index < distinct_ids.size(); tree_index++) {
+        MTree mtree;
+        bool is_rooted = tree->rooted;
+        mtree.readTree(in, is_rooted);
+        if (distinct_ids[tree_index] < 0)
+            texts.push_back(mtree.getTreeText());
+    }
+}
+
+/**
+    evaluate the distinct trees first..last-1 of the tree set concurrently, each thread on its own worker tree
+    @param texts Newick strings of the distinct trees (see readDistinctTrees)
+    @param[out] scores log-likelihoods of the distinct trees
+    @param[out] tree_strings distinct trees with branch lengths as printed to .trees file
+    @param[out] pattern_lhs pattern log-likelihoods of trees first..last-1 (if not NULL)
+*/
+static void evaluateUserTreesParallel(Params &params, IQTree *tree, StrVector &texts, size_t first, size_t last,
+    DoubleVector &scores, StrVector &tree_strings, double *pattern_lhs, size_t maxnptn)
+{
+    scores.resize(texts.size());
+    tree_strings.resize(texts.size());
+#ifdef _OPENMP
+    int num_workers = min(params.num_threads, (int)(last - first));
+    tree->createWorkers(num_workers);
+#pragma omp parallel num_threads(num_workers)
+    {
+        PhyloTree *worker = tree->getWorker(omp_get_thread_num());
+        tree->setupWorker(worker);
+#pragma omp for schedule(dynamic)
+        for (int tid = first; tid < (int)last; tid++) {
+            stringstream str(texts[tid]);
+            evaluateUserTree(params, worker, str);
+            scores[tid] = worker->getCurScore();
+            stringstream out;
+            worker->printTree(out);
+            tree_strings[tid] = out.str();
+            if (pattern_lhs) {
+                double curScore = scores[tid];
+                double *tree_pattern_lh = pattern_lhs + (tid - first)*maxnptn;
+                memset(tree_pattern_lh, 0, maxnptn*sizeof(double));
+                worker->computePatternLikelihood(tree_pattern_lh, &curScore);
+            }
+        }
+    }
+#endif
+}
+
 void evaluateTrees(Params &params, IQTree *tree, vector<TreeInfo> &info, IntVector &distinct_ids)
 {
 	if (!params.treeset_file)
@@ -3070,7 +3614,6 @@ void evaluateTrees(Params &params, IQTree *tree, vector<TreeInfo> &info, IntVect
 
 	double time_start = getRealTime();
 
-	int *boot_samples = NULL;
 	size_t boot;
 	//double *saved_tree_lhs = NULL;
 	double *tree_lhs = NULL; // RELL score matrix of size #trees x #replicates
@@ -3081,38 +3624,27 @@ void evaluateTrees(Params &params, IQTree *tree, vector<TreeInfo> &info, IntVect
 	double *lhdiff_weights = NULL;
 	size_t nptn = tree->getAlnNPattern();
     size_t maxnptn = get_safe_upper_limit(nptn);
-    
+
+    // pattern log-likelihoods are kept for a block of trees only, which is scored on the replicates
+    // before the next block is evaluated. The replicates are regenerated for every block from the
+    // same random streams, that are private to the topology tests only with OpenMP. The weighted
+    // and AU tests need the pattern log-likelihoods of all trees at the same time.
+    size_t tree_block = ntrees;
+#ifdef _OPENMP
+    if (!params.do_weighted_test && !params.do_au_test)
+        tree_block = min(ntrees, max((size_t)1, max(RELL_BLOCK_BYTES, (size_t)(getMemorySize()/10)) / (maxnptn*sizeof(double))));
+#endif
+
 	if (params.topotest_replicates && ntrees > 1) {
-		size_t mem_size = (size_t)params.topotest_replicates*nptn*sizeof(int) +
+		size_t mem_size = min((size_t)params.topotest_replicates*nptn*sizeof(int), RELL_BLOCK_BYTES + nptn*sizeof(int)) +
 				ntrees*params.topotest_replicates*sizeof(double) +
 				(nptn + ntrees*3 + params.topotest_replicates*2)*sizeof(double) +
 				ntrees*sizeof(TreeInfo) +
-				params.do_weighted_test*(ntrees * nptn * sizeof(double) + ntrees*ntrees*sizeof(double));
+				tree_block * nptn * sizeof(double) +
+				params.do_weighted_test*ntrees*ntrees*sizeof(double);
 		cout << "Note: " << ((double)mem_size/1024)/1024 << " MB of RAM required!" << endl;
 		if (mem_size > getMemorySize()-100000)
 			outWarning("The required memory does not fit in RAM!");
-		cout << "Creating " << params.topotest_replicates << " bootstrap replicates..." << endl;
-		if (!(boot_samples = new int [params.topotest_replicates*nptn]))
-			outError(ERR_NO_MEMORY);
-#ifdef _OPENMP
-        #pragma omp parallel private(boot) if(nptn > 10000)
-        {
-        int *rstream;
-        init_random(params.ran_seed + omp_get_thread_num(), false, &rstream);
-        #pragma omp for schedule(static)
-#else
-        int *rstream = randstream;
-#endif
-		for (boot = 0; boot < params.topotest_replicates; boot++)
-            if (boot == 0)
-                tree->aln->getPatternFreq(boot_samples + (boot*nptn));
-            else
-                tree->aln->createBootstrapAlignment(boot_samples + (boot*nptn), params.bootstrap_spec, rstream);
-#ifdef _OPENMP
-        finish_random(rstream);
-        }
-#endif
-        cout << "done" << endl;
 		//if (!(saved_tree_lhs = new double [ntrees * params.topotest_replicates]))
 		//	outError(ERR_NO_MEMORY);
 		if (!(tree_lhs = new double [ntrees * params.topotest_replicates]))
@@ -3120,10 +3652,9 @@ void evaluateTrees(Params &params, IQTree *tree, vector<TreeInfo> &info, IntVect
 		if (params.do_weighted_test || params.do_au_test) {
 			if (!(lhdiff_weights = new double [ntrees * ntrees]))
 				outError(ERR_NO_MEMORY);
-            pattern_lhs = aligned_alloc<double>(ntrees*maxnptn);
-//			if (!(pattern_lhs = new double[ntrees* nptn]))
-//				outError(ERR_NO_MEMORY);
 		}
+        // replicates are scored against a block of trees at once
+        pattern_lhs = aligned_alloc<double>(tree_block*maxnptn);
         pattern_lh = aligned_alloc<double>(maxnptn);
 //		if (!(pattern_lh = new double[nptn]))
 //			outError(ERR_NO_MEMORY);
@@ -3134,91 +3665,91 @@ void evaluateTrees(Params &params, IQTree *tree, vector<TreeInfo> &info, IntVect
 	}
 	int tree_index, tid, tid2;
 	info.resize(ntrees);
+
+	// evaluate each block of trees concurrently first, then print them in order
+	bool parallel = tree->isParallelTreeEval() && ntrees > 1;
+	DoubleVector par_scores;
+	StrVector par_trees, par_texts;
+	if (parallel) {
+		if (params.print_site_lh && !pattern_lhs)
+			pattern_lhs = aligned_alloc<double>(tree_block*maxnptn);
+		readDistinctTrees(tree, in, distinct_ids, par_texts);
+	}
+
 	//for (MTreeSet::iterator it = trees.begin(); it != trees.end(); it++, tree_index++) {
 	for (tree_index = 0, tid = 0; tree_index < distinct_ids.size(); tree_index++) {
 
+		if (parallel && distinct_ids[tree_index] < 0 && tid % tree_block == 0)
+			evaluateUserTreesParallel(params, tree, par_texts, tid, min(tid + tree_block, ntrees),
+				par_scores, par_trees, pattern_lhs, maxnptn);
+
 		cout << "Tree " << tree_index + 1;
 		if (distinct_ids[tree_index] >= 0) {
 			cout << " / identical to tree " << distinct_ids[tree_index]+1 << endl;
+			if (parallel)
+				continue;
 			// ignore tree
-			char ch;
-			do {
-				in >> ch;
-			} while (!in.eof() && ch != ';');
+			MTree mtree;
+			bool is_rooted = tree->rooted;
+			mtree.readTree(in, is_rooted);
 			continue;
 		}
-		tree->freeNode();
-		tree->readTree(in, tree->rooted);
-        if (!tree->findNodeName(tree->aln->getSeqName(0))) {
-            outError("Taxon " + tree->aln->getSeqName(0) + " not found in tree");
-        }
-
-        if (tree->rooted && tree->getModel()->isReversible()) {
-            if (tree->leafNum != tree->aln->getNSeq()+1)
-                outError("Tree does not have same number of taxa as alignment");
-            tree->convertToUnrooted();
-        } else if (!tree->rooted && !tree->getModel()->isReversible()) {
-            if (tree->leafNum != tree->aln->getNSeq())
-                outError("Tree does not have same number of taxa as alignment");
-            tree->convertToRooted();
-        }
-		tree->setAlignment(tree->aln);
-        tree->setRootNode(params.root);
-		if (tree->isSuperTree())
-			((PhyloSuperTree*) tree)->mapTrees();
-
-		tree->initializeAllPartialLh();
-		tree->fixNegativeBranch(false);
-		if (!params.fixed_branch_length) {
-			tree->setCurScore(tree->optimizeAllBranches(100, 0.001));
+		double logl;
+		treeout << "[ tree " << tree_index+1 << " lh=";
+		if (parallel) {
+			logl = par_scores[tid];
+			treeout << logl << " ]" << par_trees[tid];
 		} else {
-			tree->setCurScore(tree->computeLikelihood());
+			evaluateUserTree(params, tree, in);
+			logl = tree->getCurScore();
+			treeout << logl << " ]";
+			tree->printTree(treeout);
 		}
-		treeout << "[ tree " << tree_index+1 << " lh=" << tree->getCurScore() << " ]";
-		tree->printTree(treeout);
 		treeout << endl;
 		if (params.print_tree_lh)
-			scoreout << tree->getCurScore() << endl;
+			scoreout << logl << endl;
 
-		cout << " / LogL: " << tree->getCurScore() << endl;
+		cout << " / LogL: " << logl << endl;
 
-		if (pattern_lh) {
-			double curScore = tree->getCurScore();
+		if (pattern_lh && !parallel) {
+			double curScore = logl;
             memset(pattern_lh, 0, maxnptn*sizeof(double));
 			tree->computePatternLikelihood(pattern_lh, &curScore);
-			if (params.do_weighted_test || params.do_au_test)
-				memcpy(pattern_lhs + tid*maxnptn, pattern_lh, maxnptn*sizeof(double));
+			memcpy(pattern_lhs + (tid % tree_block)*maxnptn, pattern_lh, maxnptn*sizeof(double));
 		}
 		if (params.print_site_lh) {
 			string tree_name = "Tree" + convertIntToString(tree_index+1);
-			printSiteLh(site_lh_file.c_str(), tree, pattern_lh, true, tree_name.c_str());
+			printSiteLh(site_lh_file.c_str(), tree, parallel ? pattern_lhs + (tid % tree_block)*maxnptn : pattern_lh, true, tree_name.c_str());
 		}
 		if (params.print_partition_lh) {
 			string tree_name = "Tree" + convertIntToString(tree_index+1);
 			printPartitionLh(part_lh_file.c_str(), tree, pattern_lh, true, tree_name.c_str());
 		}
-		info[tid].logl = tree->getCurScore();
+		info[tid].logl = logl;
 
 		if (!params.topotest_replicates || ntrees <= 1) {
 			tid++;
 			continue;
 		}
-		// now compute RELL scores
-		orig_tree_lh[tid] = tree->getCurScore();
-		double *tree_lhs_offset = tree_lhs + (tid*params.topotest_replicates);
-		for (boot = 0; boot < params.topotest_replicates; boot++) {
-			double lh = 0.0;
-			int *this_boot_sample = boot_samples + (boot*nptn);
-			for (size_t ptn = 0; ptn < nptn; ptn++)
-				lh += pattern_lh[ptn] * this_boot_sample[ptn];
-			tree_lhs_offset[boot] = lh;
-		}
+		orig_tree_lh[tid] = logl;
 		tid++;
+		if (tid % tree_block == 0 && tid < ntrees) {
+			// score this block before its pattern log-likelihoods are overwritten by the next trees
+			if (tid == tree_block)
+				cout << "Scoring trees on " << params.topotest_replicates << " bootstrap replicates..." << endl;
+			computeRELLScores(params, tree, pattern_lhs, tree_block, tree_lhs + (tid - tree_block)*params.topotest_replicates);
+		}
 	}
 
 	ASSERT(tid == ntrees);
 
 	if (params.topotest_replicates && ntrees > 1) {
+		// now compute RELL scores of the last block
+		size_t first = (ntrees - 1) / tree_block * tree_block;
+		if (first == 0)
+			cout << "Scoring trees on " << params.topotest_replicates << " bootstrap replicates..." << endl;
+		computeRELLScores(params, tree, pattern_lhs, ntrees - first, tree_lhs + first*params.topotest_replicates);
+
 		double *tree_probs = new double[ntrees];
 		memset(tree_probs, 0, ntrees*sizeof(double));
 		int *tree_ranks = new int[ntrees];
@@ -3448,8 +3979,6 @@ void evaluateTrees(Params &params, IQTree *tree, vector<TreeInfo> &info, IntVect
 		delete [] tree_lhs;
 	//if (saved_tree_lhs)
 	//	delete [] saved_tree_lhs;
-	if (boot_samples)
-		delete [] boot_samples;
 
 	if (params.print_tree_lh) {
 		scoreout.close();
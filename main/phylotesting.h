@@ -26,6 +26,9 @@ public:
 	double AIC_score, AICc_score, BIC_score;    // scores
 	double AIC_weight, AICc_weight, BIC_weight; // weights
 	bool AIC_conf, AICc_conf, BIC_conf;         // in confidence set?
+    int pruned_rounds; // >0: optimization given up after this many rounds (-mprune), logl is not final
+
+    ModelInfo() : pruned_rounds(0) {}
 
     /**
         compute information criterion scores (AIC, AICc, BIC)
@@ -44,7 +47,9 @@ public:
         stringstream ostr;
         ostr.precision(10);
         ostr << logl << " " << df << " " << tree_len;
-        if (!tree.empty())
+        if (pruned_rounds)
+            ostr << " pruned " << pruned_rounds;
+        else if (!tree.empty())
             ostr << " " << tree;
         ckp->put(name, ostr.str());
     }
@@ -56,14 +61,18 @@ public:
         string val;
         if (ckp->getString(name, val)) {
             stringstream str(val);
+            string word;
             str >> logl >> df >> tree_len;
+            pruned_rounds = 0;
+            if (str >> word && word == "pruned")
+                str >> pruned_rounds;
             return true;
         }
         return false;
     }
 
     /**
-        restore model from checkpoint
+        restore the fully optimized model with one rate category less from checkpoint
     */
     bool restoreCheckpointRminus1(Checkpoint *ckp, string &model_name) {
         size_t posR;
@@ -72,7 +81,7 @@ public:
             if ((posR = model_name.find(rates[i])) != string::npos) {
                 int cat = convert_int(model_name.substr(posR+2).c_str());
                 name = model_name.substr(0, posR+2) + convertIntToString(cat-1);
-                return restoreCheckpoint(ckp);
+                return restoreCheckpoint(ckp) && !pruned_rounds;
             }
         }
         return false;
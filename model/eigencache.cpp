@@ -0,0 +1,170 @@
+/*
+ * eigencache.cpp
+ *
+ *  Process-wide cache of eigen decompositions and transition matrices
+ */
+
+#include "eigencache.h"
+#include <string.h>
+
+/** bookkeeping memory per entry on top of key and data */
+const size_t EIGEN_CACHE_ENTRY_OVERHEAD = 128;
+
+EigenCache &EigenCache::getInstance() {
+    static EigenCache instance;
+    return instance;
+}
+
+EigenCache::EigenCache() {
+    mem_limit = 0;
+    mem_used = 0;
+    next_id = 1;
+    eigen_lookups = eigen_hits = trans_lookups = trans_hits = evictions = 0;
+#ifdef _OPENMP
+    omp_init_lock(&mutex);
+#endif
+}
+
+EigenCache::~EigenCache() {
+#ifdef _OPENMP
+    omp_destroy_lock(&mutex);
+#endif
+}
+
+void EigenCache::lock() {
+#ifdef _OPENMP
+    omp_set_lock(&mutex);
+#endif
+}
+
+void EigenCache::unlock() {
+#ifdef _OPENMP
+    omp_unset_lock(&mutex);
+#endif
+}
+
+void EigenCache::setMemoryLimit(size_t limit) {
+    lock();
+    mem_limit = limit;
+    while (mem_used > mem_limit && !entries.empty()) {
+        Entry &entry = entries.back();
+        mem_used -= 2*entry.key.size() + entry.data.size()*sizeof(double) + EIGEN_CACHE_ENTRY_OVERHEAD;
+        index.erase(entry.key);
+        entries.pop_back();
+        evictions++;
+    }
+    unlock();
+}
+
+EigenCache::Entry *EigenCache::find(const string &key) {
+    auto it = index.find(key);
+    if (it == index.end())
+        return NULL;
+    entries.splice(entries.begin(), entries, it->second);
+    return &entries.front();
+}
+
+EigenCache::Entry *EigenCache::insert(const string &key, const double *data, size_t size) {
+    Entry *entry = find(key);
+    if (entry)
+        return entry;
+    size_t entry_mem = 2*key.size() + size*sizeof(double) + EIGEN_CACHE_ENTRY_OVERHEAD;
+    if (entry_mem > mem_limit)
+        return NULL;
+    while (mem_used + entry_mem > mem_limit) {
+        Entry &last = entries.back();
+        mem_used -= 2*last.key.size() + last.data.size()*sizeof(double) + EIGEN_CACHE_ENTRY_OVERHEAD;
+        index.erase(last.key);
+        entries.pop_back();
+        evictions++;
+    }
+    entries.push_front(Entry());
+    entry = &entries.front();
+    entry->key = key;
+    entry->data.assign(data, data + size);
+    entry->id = next_id++;
+    index[key] = entries.begin();
+    mem_used += entry_mem;
+    return entry;
+}
+
+uint64_t EigenCache::findEigen(const string &key, int num_states, double *eval, double *evec, double *inv_evec) {
+    if (!mem_limit)
+        return 0;
+    uint64_t id = 0;
+    lock();
+    eigen_lookups++;
+    Entry *entry = find(key);
+    if (entry) {
+        eigen_hits++;
+        size_t mat_size = (size_t)num_states*num_states;
+        memcpy(eval, &entry->data[0], num_states*sizeof(double));
+        memcpy(evec, &entry->data[num_states], mat_size*sizeof(double));
+        memcpy(inv_evec, &entry->data[num_states + mat_size], mat_size*sizeof(double));
+        id = entry->id;
+    }
+    unlock();
+    return id;
+}
+
+uint64_t EigenCache::insertEigen(const string &key, int num_states, double *eval, double *evec, double *inv_evec) {
+    if (!mem_limit)
+        return 0;
+    size_t mat_size = (size_t)num_states*num_states;
+    vector<double> data(num_states + 2*mat_size);
+    memcpy(&data[0], eval, num_states*sizeof(double));
+    memcpy(&data[num_states], evec, mat_size*sizeof(double));
+    memcpy(&data[num_states + mat_size], inv_evec, mat_size*sizeof(double));
+    lock();
+    Entry *entry = insert(key, &data[0], data.size());
+    uint64_t id = entry ? entry->id : 0;
+    unlock();
+    return id;
+}
+
+string EigenCache::transKey(uint64_t eigen_id, int64_t time_key, size_t size) {
+    // eigen decomposition keys start with 'E'
+    string key(1 + sizeof(eigen_id) + sizeof(time_key) + sizeof(size), 'T');
+    memcpy(&key[1], &eigen_id, sizeof(eigen_id));
+    memcpy(&key[1 + sizeof(eigen_id)], &time_key, sizeof(time_key));
+    memcpy(&key[1 + sizeof(eigen_id) + sizeof(time_key)], &size, sizeof(size));
+    return key;
+}
+
+bool EigenCache::findTransMatrix(uint64_t eigen_id, int64_t time_key, size_t size, double *trans_matrix) {
+    if (!mem_limit || !eigen_id)
+        return false;
+    string key = transKey(eigen_id, time_key, size);
+    lock();
+    trans_lookups++;
+    Entry *entry = find(key);
+    if (entry) {
+        trans_hits++;
+        memcpy(trans_matrix, &entry->data[0], size*sizeof(double));
+    }
+    unlock();
+    return entry != NULL;
+}
+
+void EigenCache::insertTransMatrix(uint64_t eigen_id, int64_t time_key, size_t size, double *trans_matrix) {
+    if (!mem_limit || !eigen_id)
+        return;
+    string key = transKey(eigen_id, time_key, size);
+    lock();
+    insert(key, trans_matrix, size);
+    unlock();
+}
+
+void EigenCache::report(ostream &out) {
+    if (!eigen_lookups)
+        return;
+    out << "Eigen decomposition cache: " << eigen_hits << " hits of " << eigen_lookups << " lookups ("
+        << (100*eigen_hits)/eigen_lookups << "%)";
+    if (trans_lookups)
+        out << ", transition matrices: " << trans_hits << " hits of " << trans_lookups << " lookups ("
+            << (100*trans_hits)/trans_lookups << "%)";
+    out << ", " << (mem_used >> 10) << " KB used";
+    if (evictions)
+        out << ", " << evictions << " evicted";
+    out << endl;
+}
@@ -0,0 +1,115 @@
+/*
+ * eigencache.h
+ *
+ *  Process-wide cache of eigen decompositions and transition matrices
+ */
+
+#ifndef EIGENCACHE_H
+#define EIGENCACHE_H
+
+#include <list>
+#include "utils/tools.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/**
+    Cache of eigen decompositions of rate matrices and of transition matrices, shared by all
+    models of the process. Entries are addressed by the content of the model parameters, such that
+    models with the same parameters (e.g. the same empirical protein matrix in several partitions
+    or ModelFinder candidates) decompose the rate matrix only once.
+    The least recently used entries are evicted once the memory limit is exceeded.
+*/
+class EigenCache {
+public:
+
+    /** @return the cache of this process */
+    static EigenCache &getInstance();
+
+    /**
+        set the memory limit
+        @param limit memory limit in bytes, 0 to disable the cache
+    */
+    void setMemoryLimit(size_t limit);
+
+    /**
+        look up the eigen decomposition of a rate matrix
+        @param key content of the model parameters defining the rate matrix, starting with 'E'
+        @param num_states number of states
+        @param[out] eval eigenvalues
+        @param[out] evec eigenvectors
+        @param[out] inv_evec inverse eigenvectors
+        @return ID of the decomposition, 0 if not found
+    */
+    uint64_t findEigen(const string &key, int num_states, double *eval, double *evec, double *inv_evec);
+
+    /**
+        store the eigen decomposition of a rate matrix
+        @return ID of the decomposition to look up its transition matrices, 0 if the cache is disabled
+    */
+    uint64_t insertEigen(const string &key, int num_states, double *eval, double *evec, double *inv_evec);
+
+    /**
+        look up a transition matrix, possibly followed by its derivatives
+        @param eigen_id ID of the eigen decomposition
+        @param time_key branch length bucket
+        @param size number of entries
+        @param[out] trans_matrix transition matrix
+        @return TRUE if found
+    */
+    bool findTransMatrix(uint64_t eigen_id, int64_t time_key, size_t size, double *trans_matrix);
+
+    /**
+        store a transition matrix, possibly followed by its derivatives
+    */
+    void insertTransMatrix(uint64_t eigen_id, int64_t time_key, size_t size, double *trans_matrix);
+
+    /**
+        print the hit rates
+    */
+    void report(ostream &out);
+
+private:
+
+    EigenCache();
+
+    ~EigenCache();
+
+    struct Entry {
+        string key;
+        vector<double> data;
+        uint64_t id;
+    };
+
+    typedef list<Entry> EntryList;
+
+    /** find entry and make it the most recently used, NULL if not found */
+    Entry *find(const string &key);
+
+    /** insert entry unless already present, evicting entries beyond the memory limit */
+    Entry *insert(const string &key, const double *data, size_t size);
+
+    /** @return key of a transition matrix */
+    string transKey(uint64_t eigen_id, int64_t time_key, size_t size);
+
+    void lock();
+
+    void unlock();
+
+    /** entries from the most to the least recently used */
+    EntryList entries;
+
+    unordered_map<string, EntryList::iterator> index;
+
+    size_t mem_limit, mem_used;
+
+    uint64_t next_id;
+
+    uint64_t eigen_lookups, eigen_hits, trans_lookups, trans_hits, evictions;
+
+#ifdef _OPENMP
+    omp_lock_t mutex;
+#endif
+};
+
+#endif
@@ -38,6 +38,7 @@
 #include "ratefreeinvar.h"
 #include "rateheterotachy.h"
 #include "rateheterotachyinvar.h"
+#include "eigencache.h"
 //#include "ngs.h"
 #include <string>
 #include "utils/timeutil.h"
@@ -132,6 +133,7 @@ ModelFactory::ModelFactory() : CheckpointFactory() {
 	site_rate = NULL;
 	store_trans_matrix = false;
 	is_storing = false;
+	pruned_rounds = 0;
 	joint_optimize = false;
 	fused_mix_rate = false;
 	unobserved_ptns = "";
@@ -151,6 +153,7 @@ size_t findCloseBracket(string &str, size_t start_pos) {
 ModelFactory::ModelFactory(Params &params, string &model_name, PhyloTree *tree, ModelsBlock *models_block) : CheckpointFactory() {
 	store_trans_matrix = params.store_trans_matrix;
 	is_storing = false;
+	pruned_rounds = 0;
 	joint_optimize = params.optimize_model_rate_joint;
 	fused_mix_rate = false;
     string model_str = model_name;
@@ -1159,8 +1162,15 @@ vector<double> ModelFactory::optimizeGammaInvWithInitValue(int fixed_len, double
 }
 
 
+/**
+    number of rounds of the current log-likelihood improvement assumed to be still ahead
+    when deciding whether optimizeParameters() can reach stop_logl. This is a heuristic:
+    a model may still converge above stop_logl, which is why pruning is only done with -mprune
+*/
+const double MAX_REMAINING_ROUNDS = 10.0;
+
 double ModelFactory::optimizeParameters(int fixed_len, bool write_info,
-                                        double logl_epsilon, double gradient_epsilon) {
+                                        double logl_epsilon, double gradient_epsilon, double stop_logl) {
 	ASSERT(model);
 	ASSERT(site_rate);
 
@@ -1203,6 +1213,7 @@ double ModelFactory::optimizeParameters(int fixed_len, bool write_info,
 
 
 	int i;
+	pruned_rounds = 0;
 	//bool optimize_rate = true;
 //	double gradient_epsilon = min(logl_epsilon, 0.01); // epsilon for parameters starts at epsilon for logl
 	for (i = 2; i < tree->params->num_param_iterations; i++) {
@@ -1235,9 +1246,18 @@ double ModelFactory::optimizeParameters(int fixed_len, bool write_info,
                 cout << "Scaled tree length: " << tree->treeLength() << endl;
 		}
 		if (new_lh > cur_lh + logl_epsilon) {
+            double improvement = new_lh - cur_lh;
 			cur_lh = new_lh;
 			if (write_info)
 				cout << i << ". Current log-likelihood: " << cur_lh << endl;
+            // improvements usually shrink from round to round: give up if even many more
+            // rounds of the current improvement are not expected to reach stop_logl
+            if (cur_lh + improvement * MAX_REMAINING_ROUNDS < stop_logl) {
+                pruned_rounds = i;
+                if (verbose_mode >= VB_MED || write_info)
+                    cout << "Stop optimization: log-likelihood not expected to reach " << stop_logl << endl;
+                break;
+            }
 		} else {
 			site_rate->classifyRates(new_lh);
             if (fixed_len == BRLEN_OPTIMIZE)
@@ -1332,7 +1352,13 @@ void ModelFactory::computeTransMatrix(double time, double *trans_matrix, int mix
 		// allocate memory for 3 matricies
 		double *trans_entry = new double[mat_size * 3];
 		trans_entry[mat_size] = trans_entry[mat_size+1] = 0.0;
-		model->computeTransMatrix(time, trans_entry, mixture);
+		// matrices of other models with the same eigen decomposition are shared
+		EigenCache &eigen_cache = EigenCache::getInstance();
+		uint64_t eigen_id = model->isMixture() ? 0 : model->getEigenCacheID();
+		if (!eigen_cache.findTransMatrix(eigen_id, round(time * 1e6), mat_size, trans_entry)) {
+			model->computeTransMatrix(time, trans_entry, mixture);
+			eigen_cache.insertTransMatrix(eigen_id, round(time * 1e6), mat_size, trans_entry);
+		}
 		ass_it = insert(value_type(round(time * 1e6), trans_entry)).first;
 	} else {
 		//if (verbose_mode >= VB_MAX)
@@ -1342,6 +1368,16 @@ void ModelFactory::computeTransMatrix(double time, double *trans_matrix, int mix
 	memcpy(trans_matrix, ass_it->second, mat_size * sizeof(double));
 }
 
+void ModelFactory::computeTransMatrices(int num_times, double *times, double *trans_matrices, int mixture) {
+	if (!store_trans_matrix || !is_storing || model->isSiteSpecificModel()) {
+		model->computeTransMatrices(num_times, times, trans_matrices, mixture);
+		return;
+	}
+	int trans_size = model->getTransMatrixSize();
+	for (int t = 0; t < num_times; t++)
+		computeTransMatrix(times[t], trans_matrices + t*trans_size, mixture);
+}
+
 void ModelFactory::computeTransDerv(double time, double *trans_matrix,
 	double *trans_derv1, double *trans_derv2, int mixture) {
 	if (!store_trans_matrix || !is_storing || model->isSiteSpecificModel()) {
@@ -1349,22 +1385,42 @@ void ModelFactory::computeTransDerv(double time, double *trans_matrix,
 		return;
 	}
 	int mat_size = model->num_states * model->num_states;
+	EigenCache &eigen_cache = EigenCache::getInstance();
+	uint64_t eigen_id = model->isMixture() ? 0 : model->getEigenCacheID();
 	iterator ass_it = find(round(time * 1e6));
 	if (ass_it == end()) {
 		// allocate memory for 3 matricies
 		double *trans_entry = new double[mat_size * 3];
 		trans_entry[mat_size] = trans_entry[mat_size+1] = 0.0;
-		model->computeTransDerv(time, trans_entry, trans_entry+mat_size, trans_entry+(mat_size*2), mixture);
+		if (!eigen_cache.findTransMatrix(eigen_id, round(time * 1e6), mat_size*3, trans_entry)) {
+			model->computeTransDerv(time, trans_entry, trans_entry+mat_size, trans_entry+(mat_size*2), mixture);
+			eigen_cache.insertTransMatrix(eigen_id, round(time * 1e6), mat_size*3, trans_entry);
+		}
 		ass_it = insert(value_type(round(time * 1e6), trans_entry)).first;
 	} else if (ass_it->second[mat_size] == 0.0 && ass_it->second[mat_size+1] == 0.0) {
 		double *trans_entry = ass_it->second;
-		model->computeTransDerv(time, trans_entry, trans_entry+mat_size, trans_entry+(mat_size*2), mixture);
+		if (!eigen_cache.findTransMatrix(eigen_id, round(time * 1e6), mat_size*3, trans_entry)) {
+			model->computeTransDerv(time, trans_entry, trans_entry+mat_size, trans_entry+(mat_size*2), mixture);
+			eigen_cache.insertTransMatrix(eigen_id, round(time * 1e6), mat_size*3, trans_entry);
+		}
 	}
 	memcpy(trans_matrix, ass_it->second, mat_size * sizeof(double));
 	memcpy(trans_derv1, ass_it->second + mat_size, mat_size * sizeof(double));
 	memcpy(trans_derv2, ass_it->second + (mat_size*2), mat_size * sizeof(double));
 }
 
+void ModelFactory::computeTransDervs(int num_times, double *times, double *trans_matrices,
+	double *trans_derv1s, double *trans_derv2s, int mixture) {
+	if (!store_trans_matrix || !is_storing || model->isSiteSpecificModel()) {
+		model->computeTransDervs(num_times, times, trans_matrices, trans_derv1s, trans_derv2s, mixture);
+		return;
+	}
+	int trans_size = model->getTransMatrixSize();
+	for (int t = 0; t < num_times; t++)
+		computeTransDerv(times[t], trans_matrices + t*trans_size, trans_derv1s + t*trans_size,
+			trans_derv2s + t*trans_size, mixture);
+}
+
 ModelFactory::~ModelFactory()
 {
 	for (iterator it = begin(); it != end(); it++)
@@ -129,6 +129,15 @@ public:
 	*/
 	void computeTransMatrix(double time, double *trans_matrix, int mixture = 0);
 
+	/**
+		Wrapper for computing the transition probability matrices for several times at once
+		@param num_times number of times
+		@param times times between two events
+        @param mixture (optional) class for mixture model
+		@param trans_matrices (OUT) the transition matrices, one after another.
+	*/
+	void computeTransMatrices(int num_times, double *times, double *trans_matrices, int mixture = 0);
+
 	/**
 		Wrapper for computing the transition probability between two states.
 		@param time time between two events
@@ -160,6 +169,18 @@ public:
 	void computeTransDerv(double time, double *trans_matrix, 
 		double *trans_derv1, double *trans_derv2, int mixture = 0);
 
+	/**
+		Wrapper for computing the transition probability matrices and their derivatives for several times at once
+		@param num_times number of times
+		@param times times between two events
+        @param mixture (optional) class for mixture model
+		@param trans_matrices (OUT) the transition matrices, one after another.
+		@param trans_derv1s (OUT) the 1st derivative matrices
+		@param trans_derv2s (OUT) the 2nd derivative matrices
+	*/
+	void computeTransDervs(int num_times, double *times, double *trans_matrices,
+		double *trans_derv1s, double *trans_derv2s, int mixture = 0);
+
 	/**
 		 destructor
 	*/
@@ -178,10 +199,12 @@ public:
         @param write_info TRUE to write model parameters every optimization step, FALSE to only print at the end
         @param logl_epsilon log-likelihood epsilon to stop
         @param gradient_epsilon gradient (derivative) epsilon to stop
+        @param stop_logl give up once the log-likelihood can no longer be expected to reach this value
 		@return the best likelihood 
 	*/
 	virtual double optimizeParameters(int fixed_len = BRLEN_OPTIMIZE, bool write_info = true,
-                                      double logl_epsilon = 0.1, double gradient_epsilon = 0.0001);
+                                      double logl_epsilon = 0.1, double gradient_epsilon = 0.0001,
+                                      double stop_logl = -DBL_MAX);
 
 	/**
 	 *  optimize model parameters and tree branch lengths for the +I+G model
@@ -221,6 +244,12 @@ public:
 	*/
 	bool is_storing;
 
+	/**
+		number of rounds after which the last optimizeParameters() gave up because of stop_logl,
+		0 if it ran until convergence
+	*/
+	int pruned_rounds;
+
 	/**
 	 * encoded constant sites that are unobservable and added in the alignment
 	 * this involves likelihood function for ascertainment bias correction for morphological or SNP data (Lewis 2001)
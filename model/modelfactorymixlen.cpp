@@ -46,14 +46,15 @@ ModelFactoryMixlen::ModelFactoryMixlen(Params &params, string &model_name, Phylo
     }
 }
 
-double ModelFactoryMixlen::optimizeParameters(int fixed_len, bool write_info, double logl_epsilon, double gradient_epsilon) {
+double ModelFactoryMixlen::optimizeParameters(int fixed_len, bool write_info, double logl_epsilon, double gradient_epsilon,
+                                              double stop_logl) {
 
 	PhyloTreeMixlen *tree = (PhyloTreeMixlen*)site_rate->getTree();
 	ASSERT(tree);
     
     tree->initializeMixlen(logl_epsilon, write_info);
 
-    double score = ModelFactory::optimizeParameters(fixed_len, write_info, logl_epsilon, gradient_epsilon);
+    double score = ModelFactory::optimizeParameters(fixed_len, write_info, logl_epsilon, gradient_epsilon, stop_logl);
 
     return score;
 }
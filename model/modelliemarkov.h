@@ -85,6 +85,17 @@ public:
 			Assume trans_matrix has size of num_states * num_states.
 	*/
 	virtual void computeTransMatrix(double time, double *trans_matrix, int mixture = 0);
+
+	/** compute each matrix with computeTransMatrix */
+	virtual void computeTransMatrices(int num_times, double *times, double *trans_matrices, int mixture = 0) {
+		ModelSubst::computeTransMatrices(num_times, times, trans_matrices, mixture);
+	}
+
+	/**
+	 * transition matrices may not be computed from the eigen decomposition, thus are not shared
+	 * @return 0
+	 */
+	virtual uint64_t getEigenCacheID() { return 0; }
 	// overrides Optimization::restartParameters
 	bool restartParameters(double guess[], int ndim, double lower[], double upper[], bool bound_check[], int iteration);
 
@@ -22,7 +22,10 @@
 #include <string.h>
 #include "modelliemarkov.h"
 #include "modelunrest.h"
+#include "eigencache.h"
 #include <Eigen/Eigenvalues>
+#include "vectorclass/vectorclass.h"
+#include "vectorclass/vectormath_exp.h"
 using namespace Eigen;
 
 
@@ -44,6 +47,7 @@ ModelMarkov::ModelMarkov(PhyloTree *tree, bool reversible)
 
     // variables for reversible model
     eigenvalues = eigenvectors = inv_eigenvectors = NULL;
+    eigen_cache_id = 0;
     highest_freq_state = num_states-1;
     freq_type = FREQ_UNKNOWN;
     half_matrix = true;
@@ -442,6 +446,65 @@ void ModelMarkov::computeTransMatrix(double time, double *trans_matrix, int mixt
 //	delete [] exptime;
 }
 
+/**
+    compute the exponentials of evol_times[t] * eval[i] for all times and eigenvalues
+    @param[out] exptimes num_times * num_states exponentials
+*/
+static void computeExpTimes(int num_times, double *evol_times, double *eval, int num_states, double *exptimes) {
+    int t, i;
+    for (t = 0; t < num_times; t++)
+        for (i = 0; i < num_states; i++)
+            exptimes[t*num_states+i] = evol_times[t] * eval[i];
+    int n = num_times*num_states;
+    for (i = 0; i < n; i += Vec2d::size()) {
+        Vec2d x;
+        x.load_partial(min(n-i, Vec2d::size()), &exptimes[i]);
+        exp(x).store_partial(min(n-i, Vec2d::size()), &exptimes[i]);
+    }
+}
+
+void ModelMarkov::computeTransMatrices(int num_times, double *times, double *trans_matrices, int mixture) {
+    if (!is_reversible || isMixture() || isSiteSpecificModel() || isPolymorphismAware()) {
+        ModelSubst::computeTransMatrices(num_times, times, trans_matrices, mixture);
+        return;
+    }
+    int t, i, j, k;
+    int mat_size = num_states*num_states;
+    double evol_times[num_times];
+    double *exptimes = new double[num_times*num_states];
+    for (t = 0; t < num_times; t++)
+        evol_times[t] = times[t] / total_num_subst;
+    computeExpTimes(num_times, evol_times, eigenvalues, num_states, exptimes);
+
+    // same as computeTransMatrix, but accumulate rows such that the innermost loop vectorizes
+    for (t = 0; t < num_times; t++) {
+        double *trans_matrix = trans_matrices + t*mat_size;
+        double *exptime = exptimes + t*num_states;
+        for (i = 0; i < num_states; i++) {
+            double *trans_row = trans_matrix + i*num_states;
+            for (j = i+1; j < num_states; j++)
+                trans_row[j] = 0.0;
+            for (k = 0; k < num_states; k++) {
+                double evec = eigenvectors[i*num_states+k];
+                double *inv_evec = inv_eigenvectors + k*num_states;
+                for (j = i+1; j < num_states; j++)
+                    trans_row[j] += evec * inv_evec[j] * exptime[k];
+            }
+            for (j = i+1; j < num_states; j++) {
+                if (trans_row[j] < 0.0)
+                    trans_row[j] = 0.0;
+                trans_matrix[j*num_states+i] = (state_freq[i]/state_freq[j]) * trans_row[j];
+            }
+            trans_row[i] = 0.0;
+            double sum = 0.0;
+            for (j = 0; j < num_states; j++)
+                sum += trans_row[j];
+            trans_row[i] = 1.0 - sum;
+        }
+    }
+    delete [] exptimes;
+}
+
 double ModelMarkov::computeTrans(double time, int state1, int state2) {
 
     if (is_reversible) {
@@ -540,6 +603,49 @@ void ModelMarkov::computeTransDerv(double time, double *trans_matrix,
 //	delete [] exptime;
 }
 
+void ModelMarkov::computeTransDervs(int num_times, double *times, double *trans_matrices,
+	double *trans_derv1s, double *trans_derv2s, int mixture)
+{
+    if (!is_reversible || isMixture() || isSiteSpecificModel() || isPolymorphismAware()) {
+        ModelSubst::computeTransDervs(num_times, times, trans_matrices, trans_derv1s, trans_derv2s, mixture);
+        return;
+    }
+    int t, i, j, k;
+    int mat_size = num_states*num_states;
+    double evol_times[num_times];
+    double *exptimes = new double[num_times*num_states];
+    for (t = 0; t < num_times; t++)
+        evol_times[t] = times[t] / total_num_subst;
+    computeExpTimes(num_times, evol_times, eigenvalues, num_states, exptimes);
+
+    for (t = 0; t < num_times; t++) {
+        double *exptime = exptimes + t*num_states;
+        for (i = 0; i < num_states; i++) {
+            double *trans_row = trans_matrices + t*mat_size + i*num_states;
+            double *derv1_row = trans_derv1s + t*mat_size + i*num_states;
+            double *derv2_row = trans_derv2s + t*mat_size + i*num_states;
+            for (j = 0; j < num_states; j++)
+                trans_row[j] = derv1_row[j] = derv2_row[j] = 0.0;
+            for (k = 0; k < num_states; k++) {
+                double evec = eigenvectors[i*num_states+k];
+                double *inv_evec = inv_eigenvectors + k*num_states;
+                double eval = eigenvalues[k];
+                for (j = 0; j < num_states; j++) {
+                    double trans = evec * inv_evec[j] * exptime[k];
+                    double trans2 = trans * eval;
+                    trans_row[j] += trans;
+                    derv1_row[j] += trans2;
+                    derv2_row[j] += trans2 * eval;
+                }
+            }
+            for (j = 0; j < num_states; j++)
+                if (trans_row[j] < 0.0)
+                    trans_row[j] = 0.0;
+        }
+    }
+    delete [] exptimes;
+}
+
 void ModelMarkov::getRateMatrix(double *rate_mat) {
 	int nrate = getNumRateEntries();
 	memcpy(rate_mat, rates, nrate * sizeof(double));
@@ -864,6 +970,7 @@ double ModelMarkov::optimizeParameters(double gradient_epsilon) {
 
 void ModelMarkov::decomposeRateMatrix(){
 	int i, j, k = 0;
+    eigen_cache_id = 0;
 
     if (!is_reversible) {
         double sum;
@@ -964,7 +1071,21 @@ void ModelMarkov::decomposeRateMatrix(){
 */
 	} else {
 
-        // general reversible model
+        // general reversible model: reuse the decomposition of a model with the same parameters
+        int nrates = half_matrix ? num_states*(num_states-1)/2 : num_states*num_states;
+        string key(1, 'E');
+        key.append((char*)&num_states, sizeof(num_states));
+        key.append((char*)&half_matrix, sizeof(half_matrix));
+        key.append((char*)&normalize_matrix, sizeof(normalize_matrix));
+        key.append((char*)&ignore_state_freq, sizeof(ignore_state_freq));
+        key.append((char*)&total_num_subst, sizeof(total_num_subst));
+        key.append((char*)rates, nrates*sizeof(double));
+        key.append((char*)state_freq, num_states*sizeof(double));
+        EigenCache &eigen_cache = EigenCache::getInstance();
+        eigen_cache_id = eigen_cache.findEigen(key, num_states, eigenvalues, eigenvectors, inv_eigenvectors);
+        if (eigen_cache_id)
+            return;
+
 		double **rate_matrix = new double*[num_states];
 
 		for (i = 0; i < num_states; i++)
@@ -991,6 +1112,7 @@ void ModelMarkov::decomposeRateMatrix(){
 		for (i = num_states-1; i >= 0; i--)
 			delete [] rate_matrix[i];
 		delete [] rate_matrix;
+        eigen_cache_id = eigen_cache.insertEigen(key, num_states, eigenvalues, eigenvectors, inv_eigenvectors);
 	}
 }
 
@@ -183,6 +183,16 @@ public:
 	*/
 	virtual void computeTransMatrix(double time, double *trans_matrix, int mixture = 0);
 
+	/**
+		compute the transition probability matrices for several times at once.
+		For reversible models the exponentials of all times are computed in one vectorized sweep.
+		@param num_times number of times
+		@param times times between two events
+        @param mixture (optional) class for mixture model
+		@param trans_matrices (OUT) the transition matrices, one after another.
+	*/
+	virtual void computeTransMatrices(int num_times, double *times, double *trans_matrices, int mixture = 0);
+
 	/**
 		compute the transition probability between two states
 		@param time time between two events
@@ -257,6 +267,18 @@ public:
 	virtual void computeTransDerv(double time, double *trans_matrix, 
 		double *trans_derv1, double *trans_derv2, int mixture = 0);
 
+	/**
+		compute the transition probability matrices and their derivatives for several times at once
+		@param num_times number of times
+		@param times times between two events
+        @param mixture (optional) class for mixture model
+		@param trans_matrices (OUT) the transition matrices, one after another.
+		@param trans_derv1s (OUT) the 1st derivative matrices
+		@param trans_derv2s (OUT) the 2nd derivative matrices
+	*/
+	virtual void computeTransDervs(int num_times, double *times, double *trans_matrices,
+		double *trans_derv1s, double *trans_derv2s, int mixture = 0);
+
 	/**
 		@return the number of dimensions
 	*/
@@ -320,6 +342,11 @@ public:
 	*/
 	virtual void decomposeRateMatrix();
 
+	/**
+	 * @return ID of the eigen decomposition in the EigenCache, 0 if not cached
+	 */
+	virtual uint64_t getEigenCacheID() { return eigen_cache_id; }
+
 //	double *getEigenCoeff() const;
 
 	virtual double *getEigenvalues() const;
@@ -449,6 +476,9 @@ protected:
 	/** state with highest frequency, used when optimizing state frequencies +FO */
 	int highest_freq_state;
 
+	/** ID of the current eigen decomposition in the EigenCache, 0 if not cached */
+	uint64_t eigen_cache_id;
+
     /****************************************************/
     /*      NON-REVERSIBLE STUFFS                       */
     /****************************************************/
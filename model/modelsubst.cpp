@@ -68,6 +68,12 @@ void ModelSubst::computeTransMatrix(double time, double *trans_matrix, int mixtu
 			trans_matrix[i] = non_diagonal;
 }
 
+void ModelSubst::computeTransMatrices(int num_times, double *times, double *trans_matrices, int mixture) {
+	int trans_size = getTransMatrixSize();
+	for (int t = 0; t < num_times; t++)
+		computeTransMatrix(times[t], trans_matrices + t*trans_size, mixture);
+}
+
 
 double ModelSubst::computeTrans(double time, int state1, int state2) {
 	double expt = exp(-time * num_states / (num_states-1));
@@ -173,6 +179,15 @@ void ModelSubst::computeTransDerv(double time, double *trans_matrix,
 
 }
 
+void ModelSubst::computeTransDervs(int num_times, double *times, double *trans_matrices,
+		double *trans_derv1s, double *trans_derv2s, int mixture)
+{
+	int trans_size = getTransMatrixSize();
+	for (int t = 0; t < num_times; t++)
+		computeTransDerv(times[t], trans_matrices + t*trans_size, trans_derv1s + t*trans_size,
+			trans_derv2s + t*trans_size, mixture);
+}
+
 double *ModelSubst::newTransMatrix() {
 	return new double[num_states * num_states];
 }
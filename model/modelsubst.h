@@ -71,6 +71,11 @@ public:
 	 */
 	virtual bool isMixture() { return false; }
 
+	/**
+	 * @return ID of the eigen decomposition in the EigenCache, 0 if not cached
+	 */
+	virtual uint64_t getEigenCacheID() { return 0; }
+
     /** 
      * Confer to modelpomo.h.
      * 
@@ -135,6 +140,17 @@ public:
 	*/
 	virtual void computeTransMatrix(double time, double *trans_matrix, int mixture = 0);
 
+	/**
+		compute the transition probability matrices for several times at once.
+		The default calls computeTransMatrix for each time.
+		@param num_times number of times
+		@param times times between two events
+        @param mixture (optional) class for mixture model
+		@param trans_matrices (OUT) the transition matrices, one after another.
+			Assume trans_matrices has size of num_times * getTransMatrixSize().
+	*/
+	virtual void computeTransMatrices(int num_times, double *times, double *trans_matrices, int mixture = 0);
+
 	/**
 		compute the transition probability between two states. 
 		One should override this function when defining new model.
@@ -241,6 +257,20 @@ public:
 	virtual void computeTransDerv(double time, double *trans_matrix, 
 		double *trans_derv1, double *trans_derv2, int mixture = 0);
 
+	/**
+		compute the transition probability matrices and their derivatives for several times at once.
+		The default calls computeTransDerv for each time.
+		@param num_times number of times
+		@param times times between two events
+        @param mixture (optional) class for mixture model
+		@param trans_matrices (OUT) the transition matrices, one after another.
+			Assume trans_matrices has size of num_times * getTransMatrixSize(), the same for the derivatives.
+		@param trans_derv1s (OUT) the 1st derivative matrices
+		@param trans_derv2s (OUT) the 2nd derivative matrices
+	*/
+	virtual void computeTransDervs(int num_times, double *times, double *trans_matrices,
+		double *trans_derv1s, double *trans_derv2s, int mixture = 0);
+
 	/**
 		decompose the rate matrix into eigenvalues and eigenvectors
 	*/
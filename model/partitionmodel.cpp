@@ -148,7 +148,8 @@ double PartitionModel::optimizeLinkedAlpha(bool write_info, double gradient_epsi
     
 }
 
-double PartitionModel::optimizeParameters(int fixed_len, bool write_info, double logl_epsilon, double gradient_epsilon) {
+double PartitionModel::optimizeParameters(int fixed_len, bool write_info, double logl_epsilon, double gradient_epsilon,
+    double stop_logl) {
     PhyloSuperTree *tree = (PhyloSuperTree*)site_rate->getTree();
     double tree_lh = 0.0;
     int ntrees = tree->size();
@@ -78,10 +78,12 @@ public:
         @param write_info TRUE to write model parameters every optimization step, FALSE to only print at the end
         @param logl_epsilon log-likelihood epsilon to stop
         @param gradient_epsilon gradient (derivative) epsilon to stop
+        @param stop_logl not used for partition models
 		@return the best likelihood 
 	*/
 	virtual double optimizeParameters(int fixed_len = BRLEN_OPTIMIZE, bool write_info = true,
-                                      double logl_epsilon = 0.1, double gradient_epsilon = 0.0001);
+                                      double logl_epsilon = 0.1, double gradient_epsilon = 0.0001,
+                                      double stop_logl = -DBL_MAX);
 
 	/**
 	 *  optimize model parameters and tree branch lengths for the +I+G model
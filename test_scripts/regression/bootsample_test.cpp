@@ -0,0 +1,106 @@
+/*
+ * bootsample_test.cpp
+ *
+ * Tests of BootSampleMatrix: counts survive widening the storage from 1 to 2 and 4 bytes,
+ * and computeRELL of a range of replicates agrees with a plain double-precision sum and
+ * does not depend on the number of threads.
+ * Built and run by run_regression.sh.
+ *
+ * USAGE: bootsample_test
+ */
+
+#include "tree/bootsamplematrix.h"
+#include "test_util.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/** number of patterns, not a multiple of RELL_BLOCK_SIZE */
+const size_t NPTN = 10 * RELL_BLOCK_SIZE + 37;
+
+/** number of replicates, not a multiple of 16 */
+const int NREP = 101;
+
+/** RELL of replicates [first_rep, last_rep) summed in double precision */
+static void plainRELL(BootSampleMatrix &boot, vector<double> &pattern_lh, int first_rep, int last_rep,
+                      vector<double> &rell, vector<double> &magnitude) {
+    for (int rep = first_rep; rep < last_rep; rep++) {
+        rell[rep] = magnitude[rep] = 0.0;
+        for (size_t ptn = 0; ptn < NPTN; ptn++) {
+            rell[rep] += boot.getCount(rep, ptn) * pattern_lh[ptn];
+            magnitude[rep] += boot.getCount(rep, ptn) * fabs(pattern_lh[ptn]);
+        }
+    }
+}
+
+/** compare computeRELL of a range of replicates with plainRELL */
+static void testRELL(BootSampleMatrix &boot, vector<double> &pattern_lh, int first_rep, int last_rep,
+                     const string &what) {
+    vector<double> rell(NREP, 1.0), expected(NREP, 1.0), magnitude(NREP, 0.0);
+    boot.computeRELL(&pattern_lh[0], first_rep, last_rep, &rell[0]);
+    plainRELL(boot, pattern_lh, first_rep, last_rep, expected, magnitude);
+    bool ok = true;
+    for (int rep = 0; rep < NREP; rep++) {
+        // patterns are summed in single precision within blocks
+        if (rep >= first_rep && rep < last_rep)
+            ok &= fabs(rell[rep] - expected[rep]) <= 1e-5 * magnitude[rep];
+        else
+            ok &= (rell[rep] == 1.0);
+    }
+    check(ok, "RELL of replicates " + convertIntToString(first_rep) + "-" + convertIntToString(last_rep) +
+          " with " + what);
+}
+
+int main(int argc, char *argv[]) {
+    mt19937 rng(3);
+    uniform_real_distribution<double> lh_dist(-30.0, -0.5);
+    vector<double> pattern_lh(NPTN);
+    for (size_t ptn = 0; ptn < NPTN; ptn++)
+        pattern_lh[ptn] = lh_dist(rng);
+
+    BootSampleMatrix boot;
+    boot.init(NPTN, NREP);
+    check(boot.size() == NREP && boot.getMemory() == NPTN * NREP, "1 byte per count");
+    vector<uint32_t> counts(NPTN * NREP);
+    for (size_t i = 0; i < counts.size(); i++) {
+        counts[i] = rng() % 4;
+        boot.setCount(i % NREP, i / NREP, counts[i]);
+    }
+    testRELL(boot, pattern_lh, 0, NREP, "1-byte counts");
+    testRELL(boot, pattern_lh, 17, 60, "1-byte counts");
+
+    // widen the storage, the counts set before must be kept
+    uint32_t wide_counts[] = {300, 70000};
+    size_t widths[] = {2, 4};
+    for (int i = 0; i < 2; i++) {
+        counts[i] = wide_counts[i];
+        boot.setCount(i, 0, wide_counts[i]);
+        string what = convertIntToString(widths[i]) + "-byte counts";
+        check(boot.getMemory() == NPTN * NREP * widths[i], what);
+        bool same = true;
+        for (size_t j = 0; j < counts.size(); j++)
+            same &= (boot.getCount(j % NREP, j / NREP) == counts[j]);
+        check(same, "counts kept after widening to " + what);
+        testRELL(boot, pattern_lh, 0, NREP, what);
+    }
+
+#ifdef _OPENMP
+    // every replicate is summed in the same order whatever the number of slices
+    vector<double> rell1(NREP), rell3(NREP);
+    omp_set_num_threads(1);
+    boot.computeRELL(&pattern_lh[0], 0, NREP, &rell1[0]);
+    omp_set_num_threads(3);
+    boot.computeRELL(&pattern_lh[0], 0, NREP, &rell3[0]);
+    check(rell1 == rell3, "RELL with 1 and 3 threads");
+#endif
+
+    boot.clear();
+    check(boot.empty() && boot.getMemory() == 0, "clear");
+
+    if (num_failed) {
+        cout << num_failed << " test(s) FAILED" << endl;
+        return 1;
+    }
+    cout << "All BootSampleMatrix tests passed" << endl;
+    return 0;
+}
@@ -0,0 +1,92 @@
+/*
+ * checkpoint_test.cpp
+ *
+ * Tests of the checkpoint log: changes and erased keys dumped after a full dump are
+ * replayed by load(), a truncated or corrupted record stops the replay at the last
+ * intact record, and the next dump after such a load rewrites the whole checkpoint.
+ * Built and run by run_regression.sh.
+ *
+ * USAGE: checkpoint_test <work_dir>
+ */
+
+#include "utils/checkpoint.h"
+#include "test_util.h"
+
+/** checkpoint content of a file */
+static map<string, string> loadContent(const string &filename) {
+    Checkpoint ckp;
+    ckp.setFileName(filename);
+    check(ckp.load(), "load " + filename);
+    return map<string, string>(ckp.begin(), ckp.end());
+}
+
+static string readFile(const string &filename) {
+    ifstream in(filename.c_str(), ios::in | ios::binary);
+    stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+static void writeFile(const string &filename, const string &data) {
+    ofstream out(filename.c_str(), ios::out | ios::binary | ios::trunc);
+    out << data;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        cout << "USAGE: " << argv[0] << " <work_dir>" << endl;
+        return 1;
+    }
+    string filename = string(argv[1]) + "/test.ckp.gz";
+    string filename_log = filename + ".log";
+
+    Checkpoint ckp;
+    ckp.setFileName(filename);
+    // a large value keeps the log smaller than the checkpoint, so that it is not compacted
+    ckp.put("bulk", string(1000, 'x'));
+    ckp.put("a", 1);
+    ckp.put("c", 2.5);
+    ckp.dump(true);
+    check(readFile(filename_log).size() == 8, "empty log after the full dump");
+
+    ckp.put("a", 2);
+    ckp.eraseKeyPrefix("c");
+    ckp.put("d", string("new"));
+    ckp.dump(true);
+    size_t first_log_size = readFile(filename_log).size();
+    check(first_log_size > 8, "log records appended");
+    map<string, string> expected(ckp.begin(), ckp.end());
+    check(loadContent(filename) == expected, "replay of put and erased keys");
+
+    ckp.put("e", string("last"));
+    ckp.dump(true);
+    string log = readFile(filename_log);
+    check(log.size() > first_log_size, "second batch of log records");
+    map<string, string> expected_last(ckp.begin(), ckp.end());
+    check(loadContent(filename) == expected_last, "replay of two batches");
+
+    // the last record is dropped, the previous ones are kept
+    writeFile(filename_log, log.substr(0, log.size() - 2));
+    check(loadContent(filename) == expected, "replay of a truncated log");
+    string corrupted = log;
+    corrupted[log.size() - 5] ^= 1;
+    writeFile(filename_log, corrupted);
+    check(loadContent(filename) == expected, "replay of a log with a wrong CRC");
+
+    // the damaged log must not be appended to, so the next dump is a full one
+    Checkpoint reloaded;
+    reloaded.setFileName(filename);
+    reloaded.load();
+    reloaded.put("f", 3);
+    reloaded.dump(true);
+    check(readFile(filename_log).size() == 8, "full dump after loading a damaged log");
+    expected["f"] = "3";
+    check(loadContent(filename) == expected, "checkpoint after loading a damaged log");
+
+    if (num_failed) {
+        cout << num_failed << " test(s) FAILED" << endl;
+        return 1;
+    }
+    cout << "All checkpoint tests passed" << endl;
+    return 0;
+}
@@ -0,0 +1,135 @@
+/*
+ * newick_test.cpp
+ *
+ * Round trip tests and micro-benchmark of the Newick parser (MTree::readNewick).
+ * Built and run by run_regression.sh.
+ *
+ * USAGE: newick_test <alignment>                   run the round trip tests
+ *        newick_test <alignment> bench [num_trees] time parsing num_trees trees (default 100000)
+ */
+
+#include "tree/phylotree.h"
+#include "alignment/alignment.h"
+#include "utils/timeutil.h"
+#include "test_util.h"
+
+/** trees with names: print, re-read and print again must give the same string and tree length */
+static void testNameRoundTrip() {
+    const char *cases[] = {
+        "((A:0.1,B:0.2):0.05,C:0.3,(D:1e-3,E:2.5E-1):0.4);",
+        "(A,B,(C,D)90:0.1,[comment; with semi-colon]E);",
+        "('taxon one':0.1,'x;y':0.2,(\"q(r)\":0.3,D:0.4):0.5);",
+        "(\n  A : 0.1 ,\n  B : 0.2 ,\n  (C:0.3, D:0.4)'node [1]':0.5\n);",
+        "(A:0.1,B:0.2,(C:0.3,D:0.4,E:0.5,F:0.6):0.7);",
+        NULL};
+    stringstream all;
+    StrVector prints;
+    for (int i = 0; cases[i]; i++) {
+        string str = cases[i];
+        all << str << endl;
+        MTree tree(str, false);
+        string first = printTree(tree, WT_BR_LEN | WT_INT_NODE);
+        MTree tree2(first, false);
+        string second = printTree(tree2, WT_BR_LEN | WT_INT_NODE);
+        check(first == second, string("round trip of ") + cases[i] + ": " + first + " != " + second);
+        check(fabs(tree.treeLength() - tree2.treeLength()) < 1e-9, string("tree length of ") + cases[i]);
+        prints.push_back(first);
+    }
+    // the same trees read one after the other from a stream
+    for (int i = 0; cases[i]; i++) {
+        MTree tree;
+        bool is_rooted = false;
+        tree.readTree(all, is_rooted);
+        check(printTree(tree, WT_BR_LEN | WT_INT_NODE) == prints[i], string("reading from stream ") + cases[i]);
+    }
+
+    // a rooted tree keeps its root
+    string rooted = "((A:0.1,B:0.2):0.3,(C:0.1,D:0.2):0.4);";
+    MTree tree(rooted, true);
+    check(tree.rooted && tree.leafNum == 5, "rooted tree " + rooted);
+    string first = printTree(tree, WT_BR_LEN);
+    MTree tree2(first, true);
+    check(printTree(tree2, WT_BR_LEN) == first, "round trip of rooted tree " + rooted);
+}
+
+/** trees labelled by taxon IDs, as IQ-TREE prints them internally */
+static void testTaxonIDs(Alignment *aln) {
+    PhyloTree tree(aln);
+    tree.setParams(&Params::getInstance());
+    mt19937 rng(1);
+    for (int i = 0; i < 20; i++) {
+        string id_tree = randomIDTree(aln->getNSeq(), rng);
+        tree.readTreeString(id_tree);
+        string ids = printTree(tree, WT_TAXON_ID | WT_BR_LEN | WT_SORT_TAXA);
+        tree.readTreeString(ids);
+        check(printTree(tree, WT_TAXON_ID | WT_BR_LEN | WT_SORT_TAXA) == ids, "re-reading " + ids);
+        string names = printTree(tree, WT_BR_LEN | WT_SORT_TAXA);
+        tree.readTreeStringSeqName(names);
+        check(printTree(tree, WT_TAXON_ID | WT_BR_LEN | WT_SORT_TAXA) == ids, "taxon names of " + ids);
+    }
+
+    // labels that are not plain numbers are converted by atoi as assignLeafNames did
+    string plain = "(0:0.1,1:0.2,(2:0.3,3:0.4):0.5);";
+    string odd = "(0:0.1,1.0:0.2,(2_x:0.3,3:0.4):0.5);";
+    tree.readTreeString(plain);
+    string expected = printTree(tree, WT_BR_LEN);
+    tree.readTreeString(odd);
+    check(printTree(tree, WT_BR_LEN) == expected, "taxon IDs of " + odd);
+}
+
+static void benchmark(Alignment *aln, int num_trees) {
+    PhyloTree tree(aln);
+    tree.setParams(&Params::getInstance());
+    mt19937 rng(1);
+    StrVector id_trees, name_trees;
+    for (int i = 0; i < 100; i++) {
+        tree.readTreeString(randomIDTree(aln->getNSeq(), rng));
+        id_trees.push_back(printTree(tree, WT_TAXON_ID | WT_BR_LEN));
+        name_trees.push_back(printTree(tree, WT_BR_LEN));
+    }
+    cout << num_trees << " trees with " << aln->getNSeq() << " taxa" << endl;
+
+    double start = getCPUTime();
+    for (int i = 0; i < num_trees; i++)
+        tree.readTreeString(id_trees[i % id_trees.size()]);
+    cout << "PhyloTree::readTreeString (taxon IDs): " << getCPUTime() - start << " s" << endl;
+
+    stringstream all;
+    for (int i = 0; i < num_trees; i++)
+        all << name_trees[i % name_trees.size()] << endl;
+    start = getCPUTime();
+    for (int i = 0; i < num_trees; i++) {
+        MTree mtree;
+        bool is_rooted = false;
+        mtree.readTree(all, is_rooted);
+    }
+    cout << "MTree::readTree (names, stream): " << getCPUTime() - start << " s" << endl;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        cout << "USAGE: " << argv[0] << " <alignment> [bench [num_trees]]" << endl;
+        return 1;
+    }
+    char *args[] = {argv[0], (char*)"-s", argv[1], (char*)"-quiet"};
+    Params &params = Params::getInstance();
+    parseArg(4, args, params);
+    InputType intype = IN_OTHER;
+    Alignment *aln = new Alignment(params.aln_file, params.sequence_type, intype, "");
+
+    if (argc > 2 && strcmp(argv[2], "bench") == 0) {
+        benchmark(aln, (argc > 3) ? convert_int(argv[3]) : 100000);
+        delete aln;
+        return 0;
+    }
+
+    testNameRoundTrip();
+    testTaxonIDs(aln);
+    delete aln;
+    if (num_failed) {
+        cout << num_failed << " test(s) FAILED" << endl;
+        return 1;
+    }
+    cout << "All Newick tests passed" << endl;
+    return 0;
+}
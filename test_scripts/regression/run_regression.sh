@@ -0,0 +1,279 @@
+#!/bin/bash -
+#===============================================================================
+#
+#          FILE: run_regression.sh
+#
+#         USAGE: ./run_regression.sh <build_dir> [<test_name> ...]
+#
+#   DESCRIPTION: Regression tests of a CMake build of IQ-TREE. The C++ drivers
+#                (*_test.cpp) are compiled with the flags of the iqtree target
+#                and linked against the libraries of the build directory; the
+#                other tests run the iqtree binary on test_data. Without test
+#                names all tests are run; benchmarks (bench_*) only run when
+#                named, e.g. ./run_regression.sh build bench_newick
+#
+#===============================================================================
+
+set -o nounset                              # Treat unset variables as an error
+
+if [ "$#" -lt 1 ]
+then
+    echo "USAGE: $0 <build_dir> [<test_name> ...]" >&2
+    exit 1
+fi
+
+scriptDir=$(cd "$(dirname "$0")" && pwd)
+buildDir=$(cd "$1" && pwd)
+shift
+dataDir=$scriptDir/../test_data
+iqtree=$buildDir/iqtree
+workDir=$(mktemp -d)
+trap 'rm -rf "$workDir"' EXIT
+numFailed=0
+
+# compile a test driver and test_util.cpp with the flags of the iqtree target, replacing main.cpp
+buildDriver() {
+    local name=$1
+    local flags=$buildDir/CMakeFiles/iqtree.dir/flags.make
+    local cxxFlags=$(sed -n 's/^CXX_FLAGS = //p' "$flags")
+    local cxxDefines=$(sed -n 's/^CXX_DEFINES = //p' "$flags")
+    local cxxIncludes=$(sed -n 's/^CXX_INCLUDES = //p' "$flags")
+    local linkCmd=$(sed -e 's# [^ ]*main/main\.cpp\.o# '"$workDir/$name.o $workDir/test_util.o"'#' -e 's# -o iqtree # -o '"$workDir/$name"' #' \
+        "$buildDir/CMakeFiles/iqtree.dir/link.txt")
+    c++ $cxxFlags $cxxDefines $cxxIncludes -w -c "$scriptDir/test_util.cpp" -o "$workDir/test_util.o" &&
+    c++ $cxxFlags $cxxDefines $cxxIncludes -w -c "$scriptDir/$name.cpp" -o "$workDir/$name.o" &&
+        (cd "$buildDir" && eval "$linkCmd")
+}
+
+# run one test, reporting its result
+runTest() {
+    local name=$1
+    shift
+    echo "=== $name"
+    if "$@"
+    then
+        echo "=== $name: OK"
+    else
+        echo "=== $name: FAILED"
+        numFailed=$((numFailed+1))
+    fi
+}
+
+test_newick() {
+    buildDriver newick_test && "$workDir/newick_test" "$dataDir/example.phy"
+}
+
+test_treecode() {
+    buildDriver treecode_test && "$workDir/treecode_test" "$dataDir/example.phy"
+}
+
+test_bootsample() {
+    buildDriver bootsample_test && "$workDir/bootsample_test"
+}
+
+test_checkpoint() {
+    buildDriver checkpoint_test && "$workDir/checkpoint_test" "$workDir"
+}
+
+# the streaming PHYLIP and FASTA readers must build the same alignment as the in-memory readers
+# (gzipped FASTA, --sequential PHYLIP) from an alignment longer than one batch of columns
+test_streaming() {
+    local opts="-m JC -n 0 -wsl -seed 1 -redo -quiet"
+    (cd "$workDir" &&
+        awk 'NR == 1 {print $1, $2 * 200; next}
+            NF == 2 {s = ""; for (i = 0; i < 200; i++) s = s $2; print $1, s}' "$dataDir/example.phy" > long.phy &&
+        awk 'NR > 1 {print ">" $1; for (i = 1; i <= length($2); i += 60) print substr($2, i, 60)}' long.phy > long.fa &&
+        gzip -c long.fa > long.fa.gz &&
+        awk 'NR == 1 {print; next} {names[NR] = $1; seqs[NR] = $2; n = NR}
+            END {for (i = 1; i <= length(seqs[2]); i += 1000) {
+                for (j = 2; j <= n; j++) print (i == 1 ? names[j] " " : "") substr(seqs[j], i, 1000); print ""}}' \
+            long.phy > interleaved.phy &&
+        "$iqtree" -s long.phy $opts -pre phylip &&
+        "$iqtree" -s interleaved.phy $opts -pre interleaved &&
+        "$iqtree" -s long.fa $opts -pre fasta &&
+        "$iqtree" -s long.fa.gz $opts -pre fastagz &&
+        "$iqtree" -s long.phy $opts --sequential -pre sequential) > /dev/null || return 1
+    local summary=$(grep "^Alignment has" "$workDir/fastagz.log")
+    for pre in phylip interleaved fasta sequential
+    do
+        [ "$summary" == "$(grep "^Alignment has" "$workDir/$pre.log")" ] || { echo "$pre: different patterns"; return 1; }
+        diff -q "$workDir/fastagz.sitelh" "$workDir/$pre.sitelh" || return 1
+    done
+}
+
+# the split dictionary of -rf_all and -rf_adj must give the distances of the per-tree split maps
+# still used between two tree sets (-rf)
+test_rfdist() {
+    (cd "$workDir" &&
+        "$iqtree" -s "$dataDir/example.phy" -m HKY -seed 1 -bb 1000 -wbt -pre rf -quiet &&
+        awk '!seen[$0]++' rf.ufboot | head -n 100 > rf.trees &&
+        "$iqtree" -t rf.trees -rf_all -pre all -quiet &&
+        "$iqtree" -t rf.trees -rf_adj -pre adj -quiet &&
+        "$iqtree" -t rf.trees -rf rf.trees -pre sets -quiet) > /dev/null || return 1
+    diff "$workDir/all.rfdist" "$workDir/sets.rfdist" || return 1
+    # adjacent pairs are the diagonal above the main one
+    diff <(awk 'NR == 2 {NF--; print}' "$workDir/adj.rfdist" | tr -s ' ' '\n' | grep .) \
+        <(awk 'NR > 1 && NR + 1 <= NF {print $(NR + 1)}' "$workDir/sets.rfdist")
+}
+
+# best models of the ModelFinder table of a log file
+bestModels() {
+    grep -E "^(Akaike|Corrected Akaike|Bayesian) Information Criterion:" "$1"
+}
+
+# rows of the model table of a .iqtree file
+modelTable() {
+    grep -E "^[A-Za-z0-9+{}.,]+ +-[0-9]+\.[0-9]+ " "$1"
+}
+
+# ModelFinder must compute the same model table with the eigen decomposition cache, without it
+# (-mcache 0) and with a 1 MB cache that has to evict entries
+test_eigencache() {
+    local aln=$dataDir/example.phy
+    (cd "$workDir" &&
+        "$iqtree" -s "$aln" -m MF -seed 1 -pre eigen -quiet &&
+        "$iqtree" -s "$aln" -m MF -seed 1 -mcache 0 -pre noeigen -quiet &&
+        "$iqtree" -s "$aln" -m MF -seed 1 -mcache 1 -pre smalleigen -quiet) > /dev/null || return 1
+    grep -qE "^Eigen decomposition cache: [1-9][0-9]* hits" "$workDir/eigen.log" || { echo "no cache hits"; return 1; }
+    grep -q "^Eigen decomposition cache" "$workDir/noeigen.log" && { echo "cache used with -mcache 0"; return 1; }
+    grep -qE "^Eigen decomposition cache: .* evicted" "$workDir/smalleigen.log" || { echo "no entries evicted"; return 1; }
+    [ -n "$(modelTable "$workDir/eigen.iqtree")" ] || { echo "no model table"; return 1; }
+    diff <(modelTable "$workDir/eigen.iqtree") <(modelTable "$workDir/noeigen.iqtree") || return 1
+    diff <(modelTable "$workDir/eigen.iqtree") <(modelTable "$workDir/smalleigen.iqtree")
+}
+
+# -mprune must select the same models as full optimization, and a later run without
+# -mprune must re-optimize the pruned models instead of reusing them from the checkpoint
+test_mprune() {
+    local aln=$dataDir/example.phy
+    (cd "$workDir" &&
+        "$iqtree" -s "$aln" -m MF -seed 1 -pre prune -mprune -quiet &&
+        "$iqtree" -s "$aln" -m MF -seed 1 -pre full -quiet &&
+        cp prune.model.gz reuse.model.gz && cp prune.model.gz.log reuse.model.gz.log &&
+        "$iqtree" -s "$aln" -m MF -seed 1 -pre reuse -quiet) > /dev/null || return 1
+    grep -q "pruned after" "$workDir/prune.log" || { echo "no model pruned"; return 1; }
+    diff <(bestModels "$workDir/prune.log") <(bestModels "$workDir/full.log") || return 1
+    if grep -q "pruned after" "$workDir/reuse.log"
+    then
+        echo "pruned models reused without -mprune"
+        return 1
+    fi
+    diff <(bestModels "$workDir/reuse.log") <(bestModels "$workDir/full.log")
+}
+
+# log-likelihood of the tree reported in a .iqtree file
+treeLogl() {
+    grep "^Log-likelihood of the tree:" "$1"
+}
+
+# --aln-cache must load the .alnbin written by the first run, reuse it after the alignment is only
+# touched, and ignore it after the alignment is edited or the cache is truncated
+test_alncache() {
+    local opts="-m HKY -n 0 -seed 1 -redo -quiet --aln-cache"
+    cp "$dataDir/example.phy" "$workDir/cache.phy"
+    (cd "$workDir" &&
+        "$iqtree" -s cache.phy $opts -pre write &&
+        "$iqtree" -s cache.phy $opts -pre load) > /dev/null || return 1
+    [ -s "$workDir/cache.phy.alnbin" ] || { echo "no cache written"; return 1; }
+    grep -q "Alignment cache cache.phy.alnbin loaded" "$workDir/load.log" || { echo "cache not loaded"; return 1; }
+    diff <(treeLogl "$workDir/write.iqtree") <(treeLogl "$workDir/load.iqtree") || return 1
+    touch -d "2001-01-01" "$workDir/cache.phy"
+    (cd "$workDir" && "$iqtree" -s cache.phy $opts -pre touched) > /dev/null || return 1
+    grep -q "Alignment cache cache.phy.alnbin loaded" "$workDir/touched.log" || { echo "cache not loaded after touch"; return 1; }
+    # same file size, so only the checksum tells the edit apart
+    sed -i '3s/^OSH-1-103    atg/OSH-1-103    ctg/' "$workDir/cache.phy"
+    touch -d "2002-01-01" "$workDir/cache.phy"
+    (cd "$workDir" &&
+        "$iqtree" -s cache.phy $opts -pre edited &&
+        "$iqtree" -s cache.phy -m HKY -n 0 -seed 1 -redo -quiet -pre nocache) > /dev/null || return 1
+    if grep -q "Alignment cache cache.phy.alnbin loaded" "$workDir/edited.log"
+    then
+        echo "stale cache loaded"
+        return 1
+    fi
+    diff <(treeLogl "$workDir/edited.iqtree") <(treeLogl "$workDir/nocache.iqtree") || return 1
+    truncate -s -10 "$workDir/cache.phy.alnbin"
+    (cd "$workDir" && "$iqtree" -s cache.phy $opts -pre truncated) > /dev/null || return 1
+    grep -q "Ignoring truncated alignment cache" "$workDir/truncated.log" || { echo "truncated cache not detected"; return 1; }
+    diff <(treeLogl "$workDir/truncated.iqtree") <(treeLogl "$workDir/nocache.iqtree")
+}
+
+# SH-aLRT, lbp and aBayes supports of a fixed tree must not depend on the number of threads,
+# nor on testing branches concurrently (-nni-par)
+test_shalrt() {
+    if [ "$(nproc)" -lt 2 ]
+    then
+        echo "skipped: needs at least 2 CPU cores"
+        return 0
+    fi
+    local aln=$dataDir/example.phy
+    local opts="-m HKY+G -seed 1 -alrt 1000 -lbp 1000 -abayes -quiet"
+    (cd "$workDir" &&
+        "$iqtree" -s "$aln" -m HKY+G -seed 1 -fast -pre start -quiet &&
+        "$iqtree" -s "$aln" $opts -te start.treefile -pre nt1 -nt 1 &&
+        "$iqtree" -s "$aln" $opts -te start.treefile -pre nt2 -nt 2 &&
+        "$iqtree" -s "$aln" $opts -te start.treefile -pre nnipar -nt 2 -nni-par) > /dev/null || return 1
+    # branch lengths may differ in the last digits
+    local supports=$(sed 's/:[-0-9.e]*//g' "$workDir/nt1.treefile")
+    [ "$supports" == "$(sed 's/:[-0-9.e]*//g' "$workDir/nt2.treefile")" ] || { echo "-nt 2 differs"; return 1; }
+    [ "$supports" == "$(sed 's/:[-0-9.e]*//g' "$workDir/nnipar.treefile")" ] || { echo "-nni-par differs"; return 1; }
+}
+
+# a tree set with semi-colons in comments is split into the same trees with and without
+# evaluating trees concurrently
+test_usertrees() {
+    local aln=$dataDir/example.phy
+    (cd "$workDir" &&
+        "$iqtree" -s "$aln" -m HKY -seed 1 -fast -pre set -quiet &&
+        sed 's/;$/[comment; with semi-colon];/' set.treefile > set.trees &&
+        echo "[second; tree] $(cat set.treefile)" >> set.trees &&
+        "$iqtree" -s "$aln" -m HKY -z set.trees -n 0 -zb 1000 -seed 1 -pre zb1 -nt 1 -quiet) > /dev/null || return 1
+    grep -q "^2 trees detected" "$workDir/zb1.log" || { echo "trees not split at their semi-colons"; return 1; }
+    if [ "$(nproc)" -lt 2 ]
+    then
+        echo "concurrent evaluation skipped: needs at least 2 CPU cores"
+        return 0
+    fi
+    (cd "$workDir" &&
+        "$iqtree" -s "$aln" -m HKY -z set.trees -n 0 -zb 1000 -seed 1 -pre zb2 -nt 2 -quiet) > /dev/null || return 1
+    diff <(grep "^Tree [0-9]" "$workDir/zb1.log") <(grep "^Tree [0-9]" "$workDir/zb2.log")
+}
+
+# micro-benchmark of the Newick parser on 100000 trees (NUM_TREES to change)
+test_bench_newick() {
+    buildDriver newick_test && "$workDir/newick_test" "$dataDir/example.phy" bench ${NUM_TREES:-100000}
+}
+
+# time to evaluate NUM_TREES distinct UFBoot trees (default 200) with -z at -nt 1 and with -tree-par
+# at -nt 2 and 4, as printed by iqtree
+test_bench_treepar() {
+    local aln=$dataDir/example.phy
+    (cd "$workDir" &&
+        "$iqtree" -s "$aln" -m HKY -seed 1 -bb 1000 -wbt -pre boot -quiet &&
+        awk '!seen[$0]++' boot.ufboot | head -n ${NUM_TREES:-200} > boot.trees) > /dev/null || return 1
+    for opts in "-nt 1" "-nt 2 -tree-par" "-nt 4 -tree-par"
+    do
+        local nt=$(echo $opts | cut -d' ' -f2)
+        if [ "$(nproc)" -lt $nt ]
+        then
+            echo "$opts: skipped, needs at least $nt CPU cores"
+            continue
+        fi
+        (cd "$workDir" &&
+            "$iqtree" -s "$aln" -m HKY -z boot.trees -n 0 -zb 1000 -seed 1 $opts -pre treepar -redo -quiet) > /dev/null || return 1
+        echo "$opts: $(grep "^Time for evaluating all trees" "$workDir/treepar.log")"
+    done
+}
+
+allTests="newick treecode bootsample checkpoint alncache streaming rfdist eigencache mprune shalrt usertrees"
+for t in ${@:-$allTests}
+do
+    runTest $t test_$t
+done
+
+if [ $numFailed -gt 0 ]
+then
+    echo "$numFailed test(s) FAILED"
+    exit 1
+fi
+echo "All tests passed"
@@ -0,0 +1,12 @@
+/*
+ * test_util.cpp
+ *
+ * Definitions linked into every regression test driver.
+ */
+
+#include <iostream>
+
+using namespace std;
+
+/** defined in main/main.cpp, which is not linked into the test drivers */
+void printCopyright(ostream &out) {}
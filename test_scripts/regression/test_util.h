@@ -0,0 +1,48 @@
+/*
+ * test_util.h
+ *
+ * Helpers shared by the regression test drivers.
+ */
+
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <random>
+#include "tree/mtree.h"
+
+static int num_failed = 0;
+
+/** report a failed test */
+static void check(bool ok, const string &what) {
+    if (ok)
+        return;
+    cout << "FAILED: " << what << endl;
+    num_failed++;
+}
+
+static string printTree(MTree &tree, int brtype) {
+    stringstream ss;
+    tree.printTree(ss, brtype);
+    return ss.str();
+}
+
+/** random unrooted tree labelled by taxon IDs, built by joining random pairs of subtrees */
+static string randomIDTree(int ntaxa, mt19937 &rng) {
+    StrVector subtrees;
+    uniform_real_distribution<double> brlen(0.0, 0.1);
+    for (int i = 0; i < ntaxa; i++)
+        subtrees.push_back(convertIntToString(i));
+    while (subtrees.size() > 3) {
+        size_t i = rng() % subtrees.size();
+        string a = subtrees[i];
+        subtrees[i] = subtrees.back();
+        subtrees.pop_back();
+        size_t j = rng() % subtrees.size();
+        stringstream ss;
+        ss << "(" << a << ":" << brlen(rng) << "," << subtrees[j] << ":" << brlen(rng) << ")";
+        subtrees[j] = ss.str();
+    }
+    return "(" + subtrees[0] + ":0.1," + subtrees[1] + ":0.1," + subtrees[2] + ":0.1);";
+}
+
+#endif // TEST_UTIL_H
@@ -0,0 +1,155 @@
+/*
+ * treecode_test.cpp
+ *
+ * Round trip tests of TreeCode: encode, decode, pack and unpack, for unrooted and rooted
+ * trees, 1- and 2-byte entries, and UFBoot checkpoint entries of the older Newick format.
+ * Built and run by run_regression.sh.
+ *
+ * USAGE: treecode_test <alignment>
+ */
+
+#include "tree/iqtree.h"
+#include "tree/treecode.h"
+#include "alignment/alignment.h"
+#include "test_util.h"
+
+/** the format decode() reproduces */
+const int TREECODE_FORMAT = WT_TAXON_ID | WT_SORT_TAXA;
+
+/** names "0", "1", ... for trees without alignment */
+static StrVector taxonIDNames(int ntaxa) {
+    StrVector names;
+    for (int i = 0; i < ntaxa; i++)
+        names.push_back(convertIntToString(i));
+    return names;
+}
+
+/** read a tree labelled by taxon IDs, unrooted trees are rooted at taxon 0 like in IQ-TREE */
+static void readIDTree(MTree &tree, const string &str, bool is_rooted, StrVector &names) {
+    tree.readNewick(str.c_str(), str.c_str() + str.length(), is_rooted, &names);
+    if (!tree.rooted)
+        tree.root = tree.findNodeID(0);
+}
+
+/** encode, decode, pack and unpack a tree */
+static void testRoundTrip(const string &str, bool is_rooted, StrVector &names) {
+    MTree tree;
+    readIDTree(tree, str, is_rooted, names);
+    string topology = printTree(tree, TREECODE_FORMAT);
+
+    TreeCode code;
+    code.encode(&tree);
+    check(!code.empty() && !code.hasLength(), "encode without lengths " + str);
+    MTree decoded;
+    code.decode(&decoded, &names);
+    check(decoded.rooted == tree.rooted, "rooted flag of " + str);
+    check(printTree(decoded, TREECODE_FORMAT) == topology, "decode " + str + ": " + printTree(decoded, TREECODE_FORMAT));
+    MTree by_id;
+    code.decode(&by_id);
+    check(printTree(by_id, TREECODE_FORMAT) == topology, "decode with taxon IDs as names " + str);
+
+    // lengths are kept in single precision
+    TreeCode code_len;
+    code_len.encode(&tree, true);
+    check(code_len.topology == code.topology && code_len.hasLength(), "encode with lengths " + str);
+    MTree decoded_len;
+    code_len.decode(&decoded_len, &names);
+    check(printTree(decoded_len, TREECODE_FORMAT) == topology, "decode with lengths " + str);
+    check(fabs(decoded_len.treeLength() - tree.treeLength()) < 1e-5 * tree.treeLength(), "branch lengths of " + str);
+
+    for (TreeCode *c : {&code, &code_len}) {
+        string packed = c->pack();
+        check(packed.find_first_of(" \t\n()") == string::npos, "packed code is one word " + packed);
+        TreeCode unpacked;
+        check(unpacked.unpack(packed) && unpacked == *c, "unpack(pack()) of " + str);
+    }
+}
+
+static void testEncoding() {
+    StrVector names = taxonIDNames(200);
+    testRoundTrip("(0:0.1,1:0.2,2:0.3);", false, names);
+    testRoundTrip("(3:0.1,(1:0.2,(4:0.3,0:0.4):0.5):0.6,2:0.7);", false, names);
+    testRoundTrip("(0:0.1,1:0.2,(2:0.3,3:0.4,4:0.5,5:0.6):0.7);", false, names);
+    testRoundTrip("((0:0.1,1:0.2):0.3,(2:0.1,3:0.2):0.4);", true, names);
+    testRoundTrip("(((2:0.1,0:0.2):0.3,4:0.1):0.2,(1:0.1,3:0.2):0.4);", true, names);
+    mt19937 rng(1);
+    for (int i = 0; i < 10; i++)
+        testRoundTrip(randomIDTree(44, rng), false, names);
+    // more than 255 nodes need 2-byte entries
+    for (int i = 0; i < 3; i++)
+        testRoundTrip(randomIDTree(200, rng), false, names);
+
+    // the topology code identifies the topology, whatever the order of children
+    MTree a, b, c;
+    readIDTree(a, "(0,(1,2),(3,4));", false, names);
+    readIDTree(b, "((4,3),0,(2,1));", false, names);
+    readIDTree(c, "(0,(1,3),(2,4));", false, names);
+    TreeCode code_a, code_b, code_c;
+    code_a.encode(&a);
+    code_b.encode(&b);
+    code_c.encode(&c);
+    check(code_a == code_b, "same topology, different order of children");
+    check(code_a != code_c, "different topologies");
+
+    // Newick strings and other text are not packed codes
+    TreeCode code;
+    check(!code.unpack("(0,1,2);") && code.empty(), "unpack of a Newick string");
+    check(!code.unpack("AB!D") && code.empty(), "unpack of a string outside the alphabet");
+    check(!code.unpack("A") && code.empty(), "unpack of a truncated code");
+}
+
+/** UFBoot trees in checkpoints: packed codes, and Newick strings with taxon IDs of older versions */
+static void testCheckpointEntries(Alignment *aln) {
+    IQTree tree(aln);
+    tree.setParams(&Params::getInstance());
+    mt19937 rng(2);
+    string newick = randomIDTree(aln->getNSeq(), rng);
+    tree.readTreeString(newick);
+    string topology = printTree(tree, TREECODE_FORMAT);
+
+    TreeCode code;
+    tree.restoreUFBootTree(tree.getTreeString(), code);
+    check(code.hasLength(), "old checkpoint entry with branch lengths");
+    MTree decoded;
+    code.decode(&decoded, &aln->getSeqNames());
+    check(printTree(decoded, TREECODE_FORMAT) == topology, "old checkpoint entry " + newick);
+    check(fabs(decoded.treeLength() - tree.treeLength()) < 1e-5 * tree.treeLength(), "branch lengths of old checkpoint entry");
+
+    stringstream ss;
+    tree.printTree(ss, WT_TAXON_ID | WT_SORT_TAXA);
+    TreeCode code_topo;
+    tree.restoreUFBootTree(ss.str(), code_topo);
+    check(code_topo.topology == code.topology && !code_topo.hasLength(), "old checkpoint entry without branch lengths");
+
+    TreeCode restored;
+    tree.restoreUFBootTree(code.pack(), restored);
+    check(restored == code, "packed checkpoint entry");
+    tree.restoreUFBootTree("", restored);
+    check(restored.empty(), "empty checkpoint entry");
+
+    // the tree read back from its code is the same tree
+    tree.readTreeCode(code);
+    check(printTree(tree, TREECODE_FORMAT) == topology, "readTreeCode");
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        cout << "USAGE: " << argv[0] << " <alignment>" << endl;
+        return 1;
+    }
+    char *args[] = {argv[0], (char*)"-s", argv[1], (char*)"-quiet"};
+    Params &params = Params::getInstance();
+    parseArg(4, args, params);
+    InputType intype = IN_OTHER;
+    Alignment *aln = new Alignment(params.aln_file, params.sequence_type, intype, "");
+
+    testEncoding();
+    testCheckpointEntries(aln);
+    delete aln;
+    if (num_failed) {
+        cout << num_failed << " test(s) FAILED" << endl;
+        return 1;
+    }
+    cout << "All TreeCode tests passed" << endl;
+    return 0;
+}
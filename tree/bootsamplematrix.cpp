@@ -0,0 +1,141 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2016 by                                            *
+ *   BUI Quang Minh <minh.bui@univie.ac.at>                                *
+ *                                                                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "bootsamplematrix.h"
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+BootSampleMatrix::BootSampleMatrix() {
+    nptn = 0;
+    nrep = 0;
+    width = 1;
+}
+
+void BootSampleMatrix::init(size_t nptn, int nrep) {
+    this->nptn = nptn;
+    this->nrep = nrep;
+    width = 1;
+    counts.assign(nptn * nrep, 0);
+}
+
+void BootSampleMatrix::clear() {
+    nptn = 0;
+    nrep = 0;
+    width = 1;
+    vector<uint8_t>().swap(counts);
+}
+
+void BootSampleMatrix::widen(int new_width) {
+    vector<uint8_t> new_counts(nptn * nrep * new_width, 0);
+    size_t num = nptn * nrep;
+    for (size_t i = 0; i < num; i++) {
+        uint32_t count;
+        switch (width) {
+        case 1: count = counts[i]; break;
+        case 2: count = ((uint16_t*)&counts[0])[i]; break;
+        default: count = ((uint32_t*)&counts[0])[i]; break;
+        }
+        if (new_width == 2)
+            ((uint16_t*)&new_counts[0])[i] = count;
+        else
+            ((uint32_t*)&new_counts[0])[i] = count;
+    }
+    counts.swap(new_counts);
+    width = new_width;
+}
+
+void BootSampleMatrix::setCount(int rep, size_t ptn, uint32_t count) {
+    if (width == 1 && count > 0xff)
+        widen(count > 0xffff ? 4 : 2);
+    else if (width == 2 && count > 0xffff)
+        widen(4);
+    size_t i = ptn * nrep + rep;
+    switch (width) {
+    case 1: counts[i] = count; break;
+    case 2: ((uint16_t*)&counts[0])[i] = count; break;
+    default: ((uint32_t*)&counts[0])[i] = count; break;
+    }
+}
+
+uint32_t BootSampleMatrix::getCount(int rep, size_t ptn) const {
+    size_t i = ptn * nrep + rep;
+    switch (width) {
+    case 1: return counts[i];
+    case 2: return ((const uint16_t*)&counts[0])[i];
+    default: return ((const uint32_t*)&counts[0])[i];
+    }
+}
+
+void BootSampleMatrix::computeRELL(double *pattern_lh, int first_rep, int last_rep, double *rell) {
+    switch (width) {
+    case 1: computeRELL<uint8_t>(pattern_lh, first_rep, last_rep, rell); break;
+    case 2: computeRELL<uint16_t>(pattern_lh, first_rep, last_rep, rell); break;
+    default: computeRELL<uint32_t>(pattern_lh, first_rep, last_rep, rell); break;
+    }
+}
+
+template <class T>
+void BootSampleMatrix::computeRELL(double *pattern_lh, int first_rep, int last_rep, double *rell) {
+    if (first_rep >= last_rep)
+        return;
+    // replicates are split into one slice per thread, each thread streams all patterns
+    // for its slice; the inner loop over replicates is an axpy that vectorizes
+    int num_slices = 1;
+#ifdef _OPENMP
+    num_slices = omp_get_max_threads();
+#endif
+    int slice_size = (last_rep - first_rep + num_slices - 1) / num_slices;
+    // keep slices a multiple of 16 replicates to fill whole vectors
+    slice_size = ((slice_size + 15) / 16) * 16;
+    const T *data = (const T*)&counts[0];
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int slice = 0; slice < num_slices; slice++) {
+        int rep_start = first_rep + slice * slice_size;
+        int rep_end = min(last_rep, rep_start + slice_size);
+        if (rep_start >= rep_end)
+            continue;
+        int len = rep_end - rep_start;
+        vector<float> block_lh(len);
+        float *acc = &block_lh[0];
+        double *slice_rell = rell + rep_start;
+        for (int rep = 0; rep < len; rep++)
+            slice_rell[rep] = 0.0;
+        // sum a block of patterns in single precision, then add it to the double result
+        for (size_t ptn_start = 0; ptn_start < nptn; ptn_start += RELL_BLOCK_SIZE) {
+            size_t ptn_end = min(nptn, ptn_start + RELL_BLOCK_SIZE);
+            for (int rep = 0; rep < len; rep++)
+                acc[rep] = 0.0f;
+            for (size_t ptn = ptn_start; ptn < ptn_end; ptn++) {
+                float lh = pattern_lh[ptn];
+                const T *row = data + ptn * nrep + rep_start;
+                for (int rep = 0; rep < len; rep++)
+                    acc[rep] += lh * row[rep];
+            }
+            for (int rep = 0; rep < len; rep++)
+                slice_rell[rep] += acc[rep];
+        }
+    }
+}
@@ -0,0 +1,112 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2016 by                                            *
+ *   BUI Quang Minh <minh.bui@univie.ac.at>                                *
+ *                                                                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef BOOTSAMPLEMATRIX_H
+#define BOOTSAMPLEMATRIX_H
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+using namespace std;
+
+/** number of patterns whose weighted likelihoods are summed in single precision */
+#define RELL_BLOCK_SIZE 64
+
+/**
+    pattern counts of the ultrafast bootstrap replicates.
+    Counts are stored pattern-major (all replicates of one pattern are adjacent)
+    in the narrowest unsigned type that holds the largest count, 1 byte in most cases,
+    so that RELL scores of all replicates are one matrix-vector product
+*/
+class BootSampleMatrix {
+public:
+
+    BootSampleMatrix();
+
+    /**
+        allocate zero counts
+        @param nptn number of patterns
+        @param nrep number of replicates
+    */
+    void init(size_t nptn, int nrep);
+
+    /** release memory */
+    void clear();
+
+    /** @return number of replicates */
+    int size() const { return nrep; }
+
+    /** @return true if there is no replicate */
+    bool empty() const { return nrep == 0; }
+
+    /**
+        set a pattern count, widening the storage if the count does not fit
+        @param rep replicate ID
+        @param ptn pattern ID
+        @param count number of sites of pattern ptn in replicate rep
+    */
+    void setCount(int rep, size_t ptn, uint32_t count);
+
+    /**
+        @param rep replicate ID
+        @param ptn pattern ID
+        @return pattern count
+    */
+    uint32_t getCount(int rep, size_t ptn) const;
+
+    /**
+        compute RELL log-likelihoods of a range of replicates,
+        rell[rep] = sum over patterns of count[rep][ptn] * pattern_lh[ptn]
+        @param pattern_lh log-likelihood of each pattern
+        @param first_rep first replicate
+        @param last_rep last replicate (exclusive)
+        @param[out] rell RELL log-likelihood, indexed by replicate ID
+    */
+    void computeRELL(double *pattern_lh, int first_rep, int last_rep, double *rell);
+
+    /** @return memory in bytes used by the counts */
+    size_t getMemory() const { return counts.size(); }
+
+protected:
+
+    /** widen the storage to a given number of bytes per count */
+    void widen(int new_width);
+
+    /** compute RELL of replicates [first_rep, last_rep) with counts of type T */
+    template <class T>
+    void computeRELL(double *pattern_lh, int first_rep, int last_rep, double *rell);
+
+    /** number of patterns */
+    size_t nptn;
+
+    /** number of replicates */
+    int nrep;
+
+    /** bytes per count: 1, 2 or 4 */
+    int width;
+
+    /** count storage, nptn x nrep entries of width bytes */
+    vector<uint8_t> counts;
+
+};
+
+#endif // BOOTSAMPLEMATRIX_H
@@ -229,7 +229,7 @@ void CandidateSet::initParentTrees() {
 }
 
 
-int CandidateSet::update(string newTree, double newScore) {
+int CandidateSet::update(string newTree, double newScore, MTree *tree) {
     // Do not update candidate set if the new tree has worse score than the
     // worst tree in the candidate set
     if (newScore < begin()->first && size() >= maxSize) {
@@ -237,26 +237,30 @@ int CandidateSet::update(string newTree, double newScore) {
     }
     CandidateTree candidate;
     candidate.score = newScore;
-    candidate.topology = convertTreeString(newTree);
+    if (tree)
+        getTreeCode(tree, candidate.code);
+    else
+        candidate.code.topology = getTopology(newTree);
     candidate.tree = newTree;
+    const string &topology = candidate.code.topology;
 
     int treePos;
     CandidateSet::iterator candidateTreeIt;
 
-    if (treeTopologyExist(candidate.topology)) {
+    if (treeTopologyExist(topology)) {
         // update new score if it is better the old score
-        double oldScore = topologies[candidate.topology];
+        double oldScore = topologies[topology];
         if (oldScore < newScore) {
-            removeCandidateTree(candidate.topology);
+            removeCandidateTree(topology);
             insert(CandidateSet::value_type(newScore, candidate));
-            topologies[candidate.topology] = newScore;
+            topologies[topology] = newScore;
         }
         ASSERT(topologies.size() == size());
         return -1;
     }
 
     candidateTreeIt = insert(CandidateSet::value_type(newScore, candidate));
-    topologies[candidate.topology] = newScore;
+    topologies[topology] = newScore;
 
     if (size() > maxSize) {
         removeWorstTree();
@@ -287,10 +291,7 @@ double CandidateSet::getBestScore() {
 
 string CandidateSet::convertTreeString(string treeString, int format) {
     MTree mtree;
-    stringstream str;
-    str << treeString;
-    str.seekg(0, ios::beg);
-    mtree.readTree(str, Params::getInstance().is_rooted);
+    mtree.readNewick(treeString.c_str(), treeString.c_str() + treeString.length(), Params::getInstance().is_rooted);
     mtree.assignLeafID();
     string rootName = "0";
     mtree.root = mtree.findLeafName(rootName);
@@ -301,26 +302,28 @@ string CandidateSet::convertTreeString(string treeString, int format) {
 }
 
 string CandidateSet::getTopology(string tree) {
-//	PhyloTree mtree;
-//	mtree.rooted = params->is_rooted;
-//	mtree.aln = this->aln;
-//	mtree.setParams(params);
     MTree mtree;
+    mtree.readNewick(tree.c_str(), tree.c_str() + tree.length(), Params::getInstance().is_rooted);
+    NodeVector taxa;
+    mtree.getTaxa(taxa);
+    for (NodeVector::iterator it = taxa.begin(); it != taxa.end(); it++)
+        if ((*it)->name != ROOT_NAME) {
+            (*it)->id = atoi((*it)->name.c_str());
+            ASSERT((*it)->id >= 0 && (*it)->id < mtree.leafNum);
+        }
 
-    stringstream str;
-    str << tree;
-    str.seekg(0, ios::beg);
-//	freeNode();
-    mtree.readTree(str, Params::getInstance().is_rooted);
-//	mtree.setAlignment(aln);
-//	mtree.setRootNode(params->root);
-    mtree.assignLeafID();
-    string x = "0";
-    mtree.root = mtree.findLeafName(x);
+    TreeCode code;
+    getTreeCode(&mtree, code);
+    return code.topology;
+}
 
-    ostringstream ostr;
-    mtree.printTree(ostr, WT_TAXON_ID | WT_SORT_TAXA);
-    return ostr.str();
+void CandidateSet::getTreeCode(MTree *tree, TreeCode &code) {
+    Node *saved_root = tree->root;
+    if (!tree->rooted)
+        tree->root = tree->findNodeID(0);
+    ASSERT(tree->root && tree->root->isLeaf());
+    code.encode(tree);
+    tree->root = saved_root;
 }
 
 double CandidateSet::getTopologyScore(string topology) {
@@ -368,12 +371,12 @@ bool CandidateSet::treeTopologyExist(string topo) {
 }
 
 bool CandidateSet::treeExist(string tree) {
-    return treeTopologyExist(convertTreeString(tree));
+    return treeTopologyExist(getTopology(tree));
 }
 
 CandidateSet::iterator CandidateSet::getCandidateTree(string topology) {
     for (CandidateSet::reverse_iterator rit = rbegin(); rit != rend(); rit++) {
-        if (rit->second.topology == topology)
+        if (rit->second.code.topology == topology)
             return --(rit.base());
     }
     return end();
@@ -391,7 +394,7 @@ void CandidateSet::removeCandidateTree(string topology) {
     treeItPair = equal_range(treeScore);
     CandidateSet::iterator it;
     for (it = treeItPair.first; it != treeItPair.second; ++it) {
-        if (it->second.topology == topology) {
+        if (it->second.code.topology == topology) {
             erase(it);
             removed = true;
             break;
@@ -402,7 +405,7 @@ void CandidateSet::removeCandidateTree(string topology) {
 
 
 void CandidateSet::removeWorstTree() {
-    topologies.erase(begin()->second.topology);
+    topologies.erase(begin()->second.code.topology);
     erase(begin());
 }
 
@@ -500,7 +503,9 @@ void CandidateSet::printTrees(string suffix) {
     outLHs.precision(15);
     for (reverse_iterator rit = rbegin(); rit != rend(); rit++) {
         outLHs << rit->first << endl;
-        outTrees << rit->second.topology << endl;
+        MTree tree;
+        rit->second.code.decode(&tree);
+        tree.printTree(outTrees, WT_TAXON_ID | WT_SORT_TAXA | WT_NEWLINE);
     }
     outTrees.close();
     outLHs.close();
@@ -41,11 +41,10 @@ struct CandidateTree {
 	string tree;
 
 	/**
-	 * tree topology WITHOUT branch lengths
-	 * and WITH TAXON ID (instead of taxon names)
-	 * for sorting purpose
+	 * tree code WITHOUT branch lengths, rooted at taxon ID 0,
+	 * its topology string identifies the tree in the candidate set
 	 */
-	string topology;
+	TreeCode code;
 
 	/**
 	 * log-likelihood or parsimony score
@@ -120,12 +119,14 @@ public:
      * 	    The new tree string (with branch lengths)
      *  @param score
      * 	    The score (ML or parsimony) of \a tree
+     *  @param tree
+     *      the tree of newTree if it is in memory, which is then encoded without parsing newTree
      *  @return
      *      Relative position of the new tree to the current best tree.
      *      Return -1 if the tree topology already existed
      *      Return -2 if the candidate set is not updated
      */
-    int update(string newTree, double newScore);
+    int update(string newTree, double newScore, MTree *tree = NULL);
 
     /**
      *  Get the \a numBestScores best scores in the candidate set
@@ -182,7 +183,7 @@ public:
      * 	Check if tree topology \a topo already exists
      *
      * 	@param topo
-     * 		Newick string of the tree topology
+     * 		topology code returned by getTopology()
      */
     bool treeTopologyExist(string topo);
 
@@ -208,21 +209,31 @@ public:
     string convertTreeString(const string tree, int format = WT_TAXON_ID | WT_SORT_TAXA);
 
     /**
-     * 	Return a unique topology (sorted by taxon names, rooted at taxon with alphabetically smallest name)
+     * 	Return a unique topology code (TreeCode::topology, rooted at taxon ID 0)
      * 	without branch lengths
      *
      * 	@param tree
-     * 		The newick tree string, from which the topology string will be generated
+     * 		The newick tree string, from which the topology code will be generated
      * 	@return
-     * 		Newick string of the tree topology
+     * 		code of the tree topology
      */
     string getTopology(string tree);
+
+    /**
+     * 	Compute the code of a tree topology rooted at taxon ID 0, without branch lengths
+     *
+     * 	@param tree
+     * 		a tree whose leaves are numbered by taxon IDs, its root is kept
+     * 	@param[out] code
+     * 		code of the tree topology
+     */
+    void getTreeCode(MTree *tree, TreeCode &code);
     
     /**
      * return the score of \a topology
      *
      * @param topology
-     * 		Newick topology
+     * 		topology code returned by getTopology()
      * @return
      * 		Score of the topology
      */
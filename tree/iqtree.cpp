@@ -107,7 +107,7 @@ void IQTree::saveUFBoot(Checkpoint *checkpoint) {
             checkpoint->addListElement();
             stringstream ss;
             ss.precision(10);
-            ss << boot_counts[id] << " " << boot_logl[id] << " " << boot_orig_logl[id] << " " << boot_trees[id];
+            ss << boot_counts[id] << " " << boot_logl[id] << " " << boot_orig_logl[id] << " " << boot_trees[id].pack();
             checkpoint->put("", ss.str());
         }
         checkpoint->endList();
@@ -120,7 +120,7 @@ void IQTree::saveUFBoot(Checkpoint *checkpoint) {
             checkpoint->addListElement();
             stringstream ss;
             ss.precision(10);
-            ss << boot_counts[id] << " " << boot_logl[id] << " " << boot_orig_logl[id] << " " << boot_trees[id];
+            ss << boot_counts[id] << " " << boot_logl[id] << " " << boot_orig_logl[id] << " " << boot_trees[id].pack();
             checkpoint->put("", ss.str());
         }
         checkpoint->endList();
@@ -163,12 +163,34 @@ void IQTree::restoreUFBoot(Checkpoint *checkpoint) {
         checkpoint->getString("", str);
         ASSERT(!str.empty());
         stringstream ss(str);
-        ss >> boot_counts[id] >> boot_logl[id] >> boot_orig_logl[id] >> boot_trees[id];
+        string tree_str;
+        ss >> boot_counts[id] >> boot_logl[id] >> boot_orig_logl[id] >> tree_str;
+        restoreUFBootTree(tree_str, boot_trees[id]);
     }
     checkpoint->endList();
     checkpoint->endStruct();
 }
 
+void IQTree::restoreUFBootTree(const string &tree_str, TreeCode &code) {
+    if (tree_str.empty()) {
+        code = TreeCode();
+        return;
+    }
+    if (code.unpack(tree_str))
+        return;
+    // Newick string of an older checkpoint, rooted as by setRootNode()
+    MTree tree;
+    bool is_rooted = rooted;
+    tree.readNewick(tree_str.c_str(), tree_str.c_str() + tree_str.length(), is_rooted, &aln->getSeqNames());
+    if (!tree.rooted) {
+        string root_name = params->root ? params->root : aln->getSeqName(0);
+        root_name = root_name.substr(0, root_name.find(','));
+        tree.root = tree.findLeafName(root_name);
+        ASSERT(tree.root);
+    }
+    code.encode(&tree, tree_str.find(':') != string::npos);
+}
+
 void IQTree::restoreCheckpoint() {
     PhyloTree::restoreCheckpoint();
     stop_rule.restoreCheckpoint();
@@ -190,7 +212,9 @@ void IQTree::restoreCheckpoint() {
             string str;
             checkpoint->getString("", str);
             stringstream ss(str);
-            ss >> boot_counts[id] >> boot_logl[id] >> boot_orig_logl[id] >> boot_trees[id];
+            string tree_str;
+            ss >> boot_counts[id] >> boot_logl[id] >> boot_orig_logl[id] >> tree_str;
+            restoreUFBootTree(tree_str, boot_trees[id]);
         }
         checkpoint->endList();
         int boot_splits_size = 0;
@@ -339,7 +363,7 @@ void IQTree::initSettings(Params &params) {
         cout << "Generating " << params.gbo_replicates << " samples for ultrafast "
              << RESAMPLE_NAME << " (seed: " << params.ran_seed << ")..." << endl;
         // allocate memory for boot_samples
-        boot_samples.resize(params.gbo_replicates);
+        boot_samples.init(getAlnNPattern(), params.gbo_replicates);
         sample_start = 0;
         sample_end = boot_samples.size();
 
@@ -360,15 +384,11 @@ void IQTree::initSettings(Params &params) {
 #else
         size_t nptn = get_safe_upper_limit(orig_nptn);
 #endif
-        BootValType *mem = aligned_alloc<BootValType>(nptn * (size_t)(params.gbo_replicates));
-        memset(mem, 0, nptn * (size_t)(params.gbo_replicates) * sizeof(BootValType));
-        for (i = 0; i < params.gbo_replicates; i++)
-        	boot_samples[i] = mem + i*nptn;
 
         if (boot_trees.empty()) {
             boot_logl.resize(params.gbo_replicates, -DBL_MAX);
             boot_orig_logl.resize(params.gbo_replicates, -DBL_MAX);
-            boot_trees.resize(params.gbo_replicates, "");
+            boot_trees.resize(params.gbo_replicates);
             boot_counts.resize(params.gbo_replicates, 0);
         } else {
             cout << "CHECKPOINT: " << boot_trees.size() << " UFBoot trees and " << boot_splits.size() << " UFBootSplits restored" << endl;
@@ -385,7 +405,7 @@ void IQTree::initSettings(Params &params) {
     			IntVector this_sample;
     			bootstrap_alignment->createBootstrapAlignment(aln, &this_sample, params.bootstrap_spec);
     			for (size_t j = 0; j < orig_nptn; j++)
-    				boot_samples[i][j] = this_sample[j];
+    				boot_samples.setCount(i, j, this_sample[j]);
     			if(!isSuperTree())
     				bootstrap_alignment->printPhylip(bootaln_name.c_str(), true);
     			else
@@ -395,7 +415,7 @@ void IQTree::initSettings(Params &params) {
     			IntVector this_sample;
         		aln->createBootstrapAlignment(this_sample, params.bootstrap_spec);
     			for (size_t j = 0; j < orig_nptn; j++)
-    				boot_samples[i][j] = this_sample[j];
+    				boot_samples.setCount(i, j, this_sample[j]);
         	}
         }
         verbose_mode = saved_mode;
@@ -417,7 +437,7 @@ void IQTree::initSettings(Params &params) {
 			for (size_t i = 0; i < params.gbo_replicates; i++) {
 				boot_samples_int[i].resize(nptn, 0);
     			for (size_t j = 0; j < orig_nptn; j++)
-    				boot_samples_int[i][j] = boot_samples[i][j];
+    				boot_samples_int[i][j] = boot_samples.getCount(i, j);
 	       	}
 		}
 
@@ -442,10 +462,9 @@ IQTree::~IQTree() {
     boot_splits.clear();
     //if (boot_splits) delete boot_splits;
 
-    if (!boot_samples.empty()) {
-    	aligned_free(boot_samples[0]); // free memory
-        boot_samples.clear();
-    }
+    boot_samples.clear();
+
+    deleteWorkers();
 }
 
 extern const char *aa_model_names_rax[];
@@ -656,9 +675,9 @@ void IQTree::computeInitialTree(LikelihoodKernel kernel) {
     }
 }
 
-int IQTree::addTreeToCandidateSet(string treeString, double score, bool updateStopRule, int sourceProcID) {
+int IQTree::addTreeToCandidateSet(string treeString, double score, bool updateStopRule, int sourceProcID, MTree *tree) {
     double curBestScore = candidateTrees.getBestScore();
-    int pos = candidateTrees.update(treeString, score);
+    int pos = candidateTrees.update(treeString, score, tree);
     if (updateStopRule) {
         stop_rule.setCurIt(stop_rule.getCurIt() + 1);
         if (score > curBestScore) {
@@ -784,7 +803,7 @@ void IQTree::initCandidateTreeSet(int nParTrees, int nNNITrees) {
 //            } else {
 //                curScore = -DBL_MAX;
 //            }
-            addTreeToCandidateSet(randTree, -DBL_MAX, false, MPIHelper::getInstance().getProcessID());
+            addTreeToCandidateSet(randTree, -DBL_MAX, false, MPIHelper::getInstance().getProcessID(), this);
         }
     }
 
@@ -802,18 +821,32 @@ void IQTree::initCandidateTreeSet(int nParTrees, int nNNITrees) {
         cout << "Computing log-likelihood of " << initTreeStrings.size() - init_size << " initial trees ... ";
     startTime = getRealTime();
 
-    for (vector<string>::iterator it = initTreeStrings.begin(); it != initTreeStrings.end(); ++it) {
-        string treeString;
-        double score;
-        readTreeString(*it);
-        if (it-initTreeStrings.begin() >= init_size)
-            treeString = optimizeBranches(params->brlen_num_traversal);
-        else {
-            computeLogL();
-            treeString = getTreeString();
+    if (isParallelTreeEval() && initTreeStrings.size() > 1) {
+        // trees given before keep their branch lengths
+        StrVector fixed_trees(initTreeStrings.begin(), initTreeStrings.begin() + min(init_size, (int)initTreeStrings.size()));
+        StrVector new_trees(initTreeStrings.begin() + fixed_trees.size(), initTreeStrings.end());
+        DoubleVector scores;
+        StrVector out_trees;
+        evaluateTreesParallel(fixed_trees, 0, scores, out_trees);
+        for (int i = 0; i < out_trees.size(); i++)
+            candidateTrees.update(out_trees[i], scores[i]);
+        evaluateTreesParallel(new_trees, params->brlen_num_traversal, scores, out_trees);
+        for (int i = 0; i < out_trees.size(); i++)
+            candidateTrees.update(out_trees[i], scores[i]);
+    } else {
+        for (vector<string>::iterator it = initTreeStrings.begin(); it != initTreeStrings.end(); ++it) {
+            string treeString;
+            double score;
+            readTreeString(*it);
+            if (it-initTreeStrings.begin() >= init_size)
+                treeString = optimizeBranches(params->brlen_num_traversal);
+            else {
+                computeLogL();
+                treeString = getTreeString();
+            }
+            score = getCurScore();
+            candidateTrees.update(treeString, score, this);
         }
-        score = getCurScore();
-        candidateTrees.update(treeString,score);
     }
 
     if (Params::getInstance().writeDistImdTrees)
@@ -849,7 +882,7 @@ void IQTree::initCandidateTreeSet(int nParTrees, int nNNITrees) {
 //        cout << "curScore: " << curScore << "  Tree before NNI: " << getTreeString() << endl;
         doNNISearch();
         string treeString = getTreeString();
-        addTreeToCandidateSet(treeString, curScore, true, MPIHelper::getInstance().getProcessID());
+        addTreeToCandidateSet(treeString, curScore, true, MPIHelper::getInstance().getProcessID(), this);
         if (Params::getInstance().writeDistImdTrees)
             intermediateTrees.update(treeString, curScore);
     }
@@ -867,7 +900,7 @@ void IQTree::initCandidateTreeSet(int nParTrees, int nNNITrees) {
             tree = optimizeModelParameters();
 //            cout << "Tree after brlen opt: " << tree << endl;
             cout << "Tree " << distance(bestInitTrees.begin(), it)+1 << " / LogL: " << getCurScore() << endl;
-            candidateTrees.update(tree, getCurScore());
+            candidateTrees.update(tree, getCurScore(), this);
         }
         cout << getRealTime() - startTime << " seconds" << endl;
     }
@@ -2278,7 +2311,7 @@ double IQTree::doTreeSearch() {
         pair<int, int> nniInfos; // <num_NNIs, num_steps>
         nniInfos = doNNISearch();
         curTree = getTreeString();
-        int pos = addTreeToCandidateSet(curTree, curScore, true, MPIHelper::getInstance().getProcessID());
+        int pos = addTreeToCandidateSet(curTree, curScore, true, MPIHelper::getInstance().getProcessID(), this);
         if (pos != -2 && pos != -1 && (Params::getInstance().fixStableSplits || Params::getInstance().adaptPertubation))
             candidateTrees.computeSplitOccurences(Params::getInstance().stableSplitThreshold);
 
@@ -2708,7 +2741,7 @@ void IQTree::refineBootTrees() {
 
         // load the current ufboot tree
         // 2019-02-06: fix crash with -sp and -bnni
-        boot_tree->PhyloTree::readTreeString(boot_trees[sample]);
+        boot_tree->PhyloTree::readTreeCode(boot_trees[sample]);
         
         if (boot_tree->isSuperTree() && params->partition_type == BRLEN_OPTIMIZE) {
             if (((PhyloSuperTree*)boot_tree)->size() > 1) {
@@ -2738,12 +2771,8 @@ void IQTree::refineBootTrees() {
             cout << "UFBoot tree " << sample+1 << ": " << boot_logl[sample] << " -> " << boot_tree->getCurScore() << endl;
         }
 
-		stringstream ostr;
-        if (params->print_ufboot_trees == 2)
-            boot_tree->printTree(ostr, WT_TAXON_ID | WT_SORT_TAXA | WT_BR_LEN | WT_BR_LEN_SHORT);
-        else
-            boot_tree->printTree(ostr, WT_TAXON_ID | WT_SORT_TAXA);
-		boot_trees[sample] = ostr.str();
+        boot_tree->setRootNode(params->root);
+        boot_trees[sample].encode(boot_tree, params->print_ufboot_trees == 2);
 		boot_logl[sample] = boot_tree->curScore;
 
 
@@ -3218,7 +3247,7 @@ void IQTree::pllInitUFBootData(){
                 if(!pllUFBootDataPtr->boot_samples[i]) outError("Not enough dynamic memory!");
                 for(int j = 0; j < pllAlignment->sequenceLength; j++){
                     pllUFBootDataPtr->boot_samples[i][j] =
-                        boot_samples[i][pll2iqtree_pattern_index[j]];
+                        boot_samples.getCount(i, pll2iqtree_pattern_index[j]);
                 }
             }
 
@@ -3369,6 +3398,10 @@ void IQTree::setDelete(int _delete) {
 }
 
 void IQTree::evaluateNNIs(Branches &nniBranches, vector<NNIMove>  &positiveNNIs) {
+    if (nniBranches.size() > 1 && isParallelNNI()) {
+        evaluateNNIsParallel(nniBranches, positiveNNIs);
+        return;
+    }
     for (Branches::iterator it = nniBranches.begin(); it != nniBranches.end(); it++) {
         NNIMove nni = getBestNNIForBran((PhyloNode*) it->second.first, (PhyloNode*) it->second.second, NULL);
         if (nni.newloglh > curScore) {
@@ -3383,6 +3416,333 @@ void IQTree::evaluateNNIs(Branches &nniBranches, vector<NNIMove>  &positiveNNIs)
     }
 }
 
+bool IQTree::isParallelNNI() {
+#ifdef _OPENMP
+    // UFBoot saves the tree of every evaluated NNI, and stored transition matrices are shared
+    // by all trees of the model, so both stay sequential
+    return params->nni_parallel && params->num_threads > 1 && !isSuperTree() && !isMixlen() &&
+        save_all_trees != 2 && !model_factory->store_trans_matrix;
+#else
+    return false;
+#endif
+}
+
+/**
+    clear the partial likelihoods of the subtree below node (away from dad) that include a changed branch
+    @param changed changed[i] is TRUE if the length of branch ID i has changed
+    @param[out] below below[i] is TRUE if the subtree below node ID i has a changed branch
+    @return TRUE if the subtree below node has a changed branch
+*/
+static bool clearChangedPartialLhBelow(PhyloNode *node, PhyloNode *dad, BoolVector &changed, BoolVector &below) {
+    bool res = false;
+    FOR_NEIGHBOR_IT(node, dad, it) {
+        // the partial likelihood of the neighbor does not include the branch to it
+        if (clearChangedPartialLhBelow((PhyloNode*)(*it)->node, node, changed, below)) {
+            ((PhyloNeighbor*)*it)->clearPartialLh();
+            res = true;
+        }
+        if (changed[(*it)->id])
+            res = true;
+    }
+    below[node->id] = res;
+    return res;
+}
+
+/**
+    clear the partial likelihoods pointing from the subtree below node towards dad that include a
+    changed branch, see clearChangedPartialLhBelow
+    @param above TRUE if the tree beyond dad (away from node) has a changed branch
+*/
+static void clearChangedPartialLhAbove(PhyloNode *node, PhyloNode *dad, bool above, BoolVector &changed, BoolVector &below) {
+    // subtree sizes do not change with branch lengths
+    if (dad && above)
+        ((PhyloNeighbor*)node->findNeighbor(dad))->clearPartialLh();
+    bool dad_changed = dad && changed[node->findNeighbor(dad)->id];
+    FOR_NEIGHBOR_IT(node, dad, it) {
+        bool child_above = above || dad_changed;
+        FOR_NEIGHBOR_IT(node, dad, it2)
+            if (it2 != it && (below[(*it2)->node->id] || changed[(*it2)->id]))
+                child_above = true;
+        clearChangedPartialLhAbove((PhyloNode*)(*it)->node, node, child_above, changed, below);
+    }
+}
+
+/**
+    turn a worker tree holding an earlier version of a tree into the tree by the NNIs and branch lengths
+    applied to it since, clearing only the partial likelihoods of the worker that depend on them
+    @param node_by_id nodes of the tree indexed by node ID
+    @param[out] worker_nodes nodes of the worker tree indexed by node ID
+    @return FALSE if the changes are not NNIs on disjoint branches, the worker tree must be copied again
+*/
+static bool updateNNIWorker(PhyloTree *tree, PhyloTree *worker, NodeVector &node_by_id, NodeVector &worker_nodes) {
+    if (!worker->root || worker->nodeNum != tree->nodeNum || worker->leafNum != tree->leafNum)
+        return false;
+    NodeVector nodes;
+    worker->getAllNodesInSubtree(worker->root->neighbors[0]->node, NULL, nodes);
+    worker_nodes.assign(node_by_id.size(), NULL);
+    for (NodeVector::iterator it = nodes.begin(); it != nodes.end(); it++) {
+        int id = (*it)->id;
+        if (id >= node_by_id.size() || !node_by_id[id] || worker_nodes[id] || node_by_id[id]->degree() != (*it)->degree())
+            return false;
+        worker_nodes[id] = *it;
+    }
+    if (nodes.size() != node_by_id.size() - count(node_by_id.begin(), node_by_id.end(), (Node*)NULL))
+        return false;
+
+    // a neighbor that differs is swapped with the neighbor of an adjacent node, as done by the NNI.
+    // The outer nodes of the NNI branch differ as well but are updated by the NNI
+    for (int id = 0; id < node_by_id.size(); id++) {
+        Node *node = node_by_id[id];
+        if (!node || node->degree() != 3)
+            continue;
+        Node *wnode = worker_nodes[id];
+        for (int i = 0; i < 3; i++) {
+            int wanted = node->neighbors[i]->node->id;
+            int found = wnode->neighbors[i]->node->id;
+            if (wanted == found)
+                continue;
+            bool swapped = false;
+            for (int m = 0; m < 3 && !swapped; m++) {
+                Node *node2 = node->neighbors[m]->node;
+                if (m == i || node2->degree() != 3 || wnode->neighbors[m]->node->id != node2->id)
+                    continue;
+                Node *wnode2 = worker_nodes[node2->id];
+                for (int j = 0; j < 3 && !swapped; j++)
+                    if (node2->neighbors[j]->node->id == found && wnode2->neighbors[j]->node->id == wanted) {
+                        NNIMove move;
+                        move.node1 = (PhyloNode*)wnode;
+                        move.node2 = (PhyloNode*)wnode2;
+                        move.node1Nei_it = wnode->neighbors.begin() + i;
+                        move.node2Nei_it = wnode2->neighbors.begin() + j;
+                        worker->doNNI(move);
+                        swapped = true;
+                    }
+            }
+        }
+    }
+
+    // copy the branch lengths that changed, after checking that the topology is the same now
+    BoolVector changed(max(tree->branchNum, worker->branchNum), false);
+    for (int id = 0; id < node_by_id.size(); id++) {
+        Node *node = node_by_id[id];
+        if (!node)
+            continue;
+        Node *wnode = worker_nodes[id];
+        for (int i = 0; i < node->degree(); i++) {
+            Neighbor *nei = node->neighbors[i], *wnei = wnode->neighbors[i];
+            if (wnei->node->id != nei->node->id || wnei->id != nei->id || nei->id >= changed.size())
+                return false;
+            if (wnei->length != nei->length) {
+                wnei->length = nei->length;
+                changed[nei->id] = true;
+            }
+        }
+    }
+    worker->root = worker_nodes[tree->root->id];
+    BoolVector below(node_by_id.size(), false);
+    clearChangedPartialLhBelow((PhyloNode*)worker->root, NULL, changed, below);
+    clearChangedPartialLhAbove((PhyloNode*)worker->root, NULL, false, changed, below);
+    return true;
+}
+
+void IQTree::syncNNIWorker(int thread_id, NodeVector &worker_nodes) {
+    PhyloTree *worker = workers[thread_id];
+    NodeVector nodes;
+    getAllNodesInSubtree(root->neighbors[0]->node, NULL, nodes);
+    int max_id = 0;
+    for (NodeVector::iterator it = nodes.begin(); it != nodes.end(); it++)
+        max_id = max(max_id, (*it)->id);
+
+    // a worker kept from the previous call only needs the NNIs and branch lengths applied since
+    if (worker_synced[thread_id]) {
+        NodeVector node_by_id(max_id+1, NULL);
+        for (NodeVector::iterator it = nodes.begin(); it != nodes.end(); it++)
+            node_by_id[(*it)->id] = *it;
+        if (updateNNIWorker(this, worker, node_by_id, worker_nodes)) {
+            worker->setCurScore(curScore);
+            return;
+        }
+    }
+
+    if (worker->root)
+        worker->freeNode();
+    worker->root = NULL;
+    worker_nodes.assign(max_id+1, NULL);
+    for (NodeVector::iterator it = nodes.begin(); it != nodes.end(); it++)
+        worker_nodes[(*it)->id] = worker->newNode((*it)->id, (*it)->name.c_str());
+    for (NodeVector::iterator it = nodes.begin(); it != nodes.end(); it++) {
+        Node *node = worker_nodes[(*it)->id];
+        for (NeighborVec::iterator nei = (*it)->neighbors.begin(); nei != (*it)->neighbors.end(); nei++) {
+            node->addNeighbor(worker_nodes[(*nei)->node->id], (*nei)->length, (*nei)->id);
+            ((PhyloNeighbor*)node->neighbors.back())->direction = ((PhyloNeighbor*)*nei)->direction;
+        }
+    }
+    worker->root = worker_nodes[root->id];
+    worker->leafNum = leafNum;
+    worker->nodeNum = nodeNum;
+    worker->branchNum = branchNum;
+    worker->setCurScore(curScore);
+
+    setupWorker(worker);
+    worker->initializeAllPartialLh();
+    worker_synced[thread_id] = 1;
+}
+
+void IQTree::testBranches(NodeVector &nodes1, NodeVector &nodes2, double best_score, double *pattern_lh,
+        int reps, int lbp_reps, int *rell_ptn_freq, vector<BranchSupport> &supports) {
+    // branches resampling their own replicates are tested one after another, as supports would
+    // otherwise depend on the thread testing the branch
+    if (!isParallelNNI() || nodes1.size() < 2 || !rell_ptn_freq) {
+        PhyloTree::testBranches(nodes1, nodes2, best_score, pattern_lh, reps, lbp_reps, rell_ptn_freq, supports);
+        return;
+    }
+#ifdef _OPENMP
+    supports.resize(nodes1.size());
+    int num_workers = min(params->num_threads, (int)nodes1.size());
+    createWorkers(num_workers, true);
+#pragma omp parallel num_threads(num_workers)
+    {
+        PhyloTree *worker = workers[omp_get_thread_num()];
+        NodeVector worker_nodes;
+        syncNNIWorker(omp_get_thread_num(), worker_nodes);
+#pragma omp for schedule(dynamic)
+        for (int i = 0; i < nodes1.size(); i++) {
+            BranchSupport &sup = supports[i];
+            sup.sh_alrt = worker->testOneBranch(best_score, pattern_lh, reps, lbp_reps,
+                (PhyloNode*)worker_nodes[nodes1[i]->id], (PhyloNode*)worker_nodes[nodes2[i]->id],
+                sup.lbp, sup.alrt, sup.abayes, rell_ptn_freq, &sup.nni_lh);
+        }
+    }
+#endif
+}
+
+bool IQTree::isParallelTreeEval() {
+#ifdef _OPENMP
+    return params->tree_parallel && params->num_threads > 1 && !isSuperTree() && !isMixlen() &&
+        !params->pll && !model_factory->store_trans_matrix;
+#else
+    return false;
+#endif
+}
+
+void IQTree::createWorkers(int num_workers, bool keep_trees) {
+    if (!workers.empty() && workers[0]->aln != aln)
+        deleteWorkers();
+    if (!keep_trees)
+        worker_synced.assign(workers.size(), 0);
+    while (workers.size() < num_workers) {
+        PhyloTree *worker = new PhyloTree(aln);
+        worker->setParams(params);
+        worker->optimize_by_newton = optimize_by_newton;
+        if (!constraintTree.empty())
+            worker->constraintTree.readConstraint(constraintTree);
+        workers.push_back(worker);
+        worker_synced.push_back(0);
+    }
+}
+
+void IQTree::clearAllPartialLH(bool make_null) {
+    PhyloTree::clearAllPartialLH(make_null);
+    // the model or the tree changed, the worker trees are copied again
+    worker_synced.assign(workers.size(), 0);
+}
+
+void IQTree::setupWorker(PhyloTree *worker) {
+    worker->rooted = rooted;
+    // single-threaded kernel, the threads work on different branches or trees
+    worker->setLikelihoodKernel(sse);
+    worker->setNumThreads(1);
+    if (worker->getModelFactory() != model_factory)
+        worker->setModelFactory(model_factory);
+    // model parameters might have changed since the worker was used last
+    worker->ptn_freq_computed = false;
+}
+
+void IQTree::evaluateTreesParallel(StrVector &trees, int max_traversal, DoubleVector &scores, StrVector &out_trees) {
+    scores.resize(trees.size());
+    out_trees.resize(trees.size());
+    if (trees.empty())
+        return;
+#ifdef _OPENMP
+    int num_workers = min(params->num_threads, (int)trees.size());
+    createWorkers(num_workers);
+#pragma omp parallel num_threads(num_workers)
+    {
+        PhyloTree *worker = workers[omp_get_thread_num()];
+        setupWorker(worker);
+#pragma omp for schedule(dynamic)
+        for (int i = 0; i < trees.size(); i++) {
+            worker->readTreeString(trees[i]);
+            if (max_traversal > 0)
+                scores[i] = worker->optimizeAllBranches(max_traversal, params->loglh_epsilon, PLL_NEWZPERCYCLE);
+            else
+                scores[i] = worker->computeLikelihood();
+            out_trees[i] = worker->getTreeString();
+        }
+    }
+#endif
+}
+
+void IQTree::deleteWorkers() {
+    for (vector<PhyloTree*>::iterator it = workers.begin(); it != workers.end(); it++) {
+        // model and rate are owned by this tree
+        (*it)->setModelFactory(NULL);
+        delete (*it);
+    }
+    workers.clear();
+    worker_synced.clear();
+}
+
+void IQTree::evaluateNNIsParallel(Branches &nniBranches, vector<NNIMove> &positiveNNIs) {
+#ifdef _OPENMP
+    int num_workers = min(params->num_threads, (int)nniBranches.size());
+    createWorkers(num_workers, true);
+
+    vector<Branch> branches;
+    for (Branches::iterator it = nniBranches.begin(); it != nniBranches.end(); it++)
+        branches.push_back(it->second);
+    vector<NNIMove> nniMoves(branches.size());
+
+    NodeVector nodes;
+    getAllNodesInSubtree(root->neighbors[0]->node, NULL, nodes);
+    NodeVector node_by_id(nodeNum, NULL);
+    for (NodeVector::iterator it = nodes.begin(); it != nodes.end(); it++) {
+        if ((*it)->id >= node_by_id.size())
+            node_by_id.resize((*it)->id+1, NULL);
+        node_by_id[(*it)->id] = *it;
+    }
+
+#pragma omp parallel num_threads(num_workers)
+    {
+        PhyloTree *worker = workers[omp_get_thread_num()];
+        NodeVector worker_nodes;
+        syncNNIWorker(omp_get_thread_num(), worker_nodes);
+#pragma omp for schedule(dynamic)
+        for (int i = 0; i < branches.size(); i++) {
+            NNIMove nni = worker->getBestNNIForBran((PhyloNode*)worker_nodes[branches[i].first->id],
+                (PhyloNode*)worker_nodes[branches[i].second->id], NULL);
+            // refer to the nodes of this tree, whose neighbors have the same order
+            NNIMove &res = nniMoves[i];
+            res = nni;
+            res.node1 = (PhyloNode*)node_by_id[nni.node1->id];
+            res.node2 = (PhyloNode*)node_by_id[nni.node2->id];
+            res.node1Nei_it = res.node1->neighbors.begin() + (nni.node1Nei_it - nni.node1->neighbors.begin());
+            res.node2Nei_it = res.node2->neighbors.begin() + (nni.node2Nei_it - nni.node2->neighbors.begin());
+        }
+    }
+
+    for (vector<NNIMove>::iterator it = nniMoves.begin(); it != nniMoves.end(); it++)
+        if (it->newloglh > curScore)
+            positiveNNIs.push_back(*it);
+
+    // synchronize tree during optimization step
+    if (MPIHelper::getInstance().isMaster() && candidateset_changed.size() > 0
+        && MPIHelper::getInstance().gotMessage()) {
+        syncCurrentTree();
+    }
+#endif
+}
+
 //Branches IQTree::getReducedListOfNNIBranches(Branches &previousNNIBranches) {
 //    Branches resBranches;
 //    for (Branches::iterator it = previousNNIBranches.begin(); it != previousNNIBranches.end(); it++) {
@@ -3507,20 +3867,8 @@ void IQTree::saveCurrentTree(double cur_logl) {
 
     int nptn = getAlnNPattern();
 
-#ifdef BOOT_VAL_FLOAT
-    int maxnptn = get_safe_upper_limit_float(nptn);
-    BootValType *pattern_lh = aligned_alloc<BootValType>(maxnptn);
-    memset(pattern_lh, 0, maxnptn*sizeof(BootValType));
-    double *pattern_lh_orig = aligned_alloc<double>(nptn);
-    computePatternLikelihood(pattern_lh_orig, &cur_logl);
-    for (int i = 0; i < nptn; i++)
-    	pattern_lh[i] = (float)pattern_lh_orig[i];
-#else
-    int maxnptn = get_safe_upper_limit(nptn);
-    BootValType *pattern_lh = aligned_alloc<BootValType>(maxnptn);
-    memset(pattern_lh, 0, maxnptn*sizeof(BootValType));
+    double *pattern_lh = aligned_alloc<double>(nptn);
     computePatternLikelihood(pattern_lh, &cur_logl);
-#endif
 
 
     if (boot_samples.empty()) {
@@ -3530,14 +3878,14 @@ void IQTree::saveCurrentTree(double cur_logl) {
 //        int ptn;
 //        int updated = 0;
 //        int nsamples = boot_samples.size();
-        ostringstream ostr;
-        string tree_str;
         setRootNode(params->root);
-        if (params->print_ufboot_trees == 2)
-            printTree(ostr, WT_TAXON_ID + WT_SORT_TAXA + WT_BR_LEN + WT_BR_LEN_SHORT);
-        else
-            printTree(ostr, WT_TAXON_ID + WT_SORT_TAXA);
-        tree_str = ostr.str();
+
+        // RELL log-likelihoods of all replicates as one matrix-vector product
+        DoubleVector rell_logl(boot_samples.size());
+        boot_samples.computeRELL(pattern_lh, sample_start, sample_end, &rell_logl[0]);
+
+        // replicates whose tree becomes the current tree, encoded only if there is any
+        vector<char> improved(boot_samples.size(), 0);
 
     #ifdef _OPENMP
         int rand_seed = random_int(1000);
@@ -3550,16 +3898,7 @@ void IQTree::saveCurrentTree(double cur_logl) {
         int *rstream = randstream;
     #endif
         for (int sample = sample_start; sample < sample_end; sample++) {
-            double rell = 0.0;
-
-            {
-            	// SSE optimized version of the above loop
-				BootValType *boot_sample = boot_samples[sample];
-
-				BootValType res = (this->*dotProduct)(pattern_lh, boot_sample, nptn);
-
-				rell = res;
-            }
+            double rell = rell_logl[sample];
 
             bool better = rell > boot_logl[sample] + params->ufboot_epsilon;
             if (!better && rell > boot_logl[sample] - params->ufboot_epsilon) {
@@ -3573,54 +3912,54 @@ void IQTree::saveCurrentTree(double cur_logl) {
                 }
                 boot_logl[sample] = max(boot_logl[sample], rell);
                 boot_orig_logl[sample] = cur_logl;
-                boot_trees[sample] = tree_str;
+                improved[sample] = 1;
             }
         }
     #ifdef _OPENMP
         finish_random(rstream);
         }
     #endif
+        if (find(improved.begin(), improved.end(), 1) != improved.end()) {
+            TreeCode code;
+            code.encode(this, params->print_ufboot_trees == 2);
+            for (int sample = sample_start; sample < sample_end; sample++)
+                if (improved[sample])
+                    boot_trees[sample] = code;
+        }
     }
     if (Params::getInstance().print_tree_lh) {
         out_treelh << cur_logl;
         double prob;
-#ifdef BOOT_VAL_FLOAT
-        aln->multinomialProb(pattern_lh_orig, prob);
-#else
         aln->multinomialProb(pattern_lh, prob);
-#endif
         out_treelh << "\t" << prob << endl;
 
         IntVector pattern_index;
         aln->getSitePatternIndex(pattern_index);
         out_sitelh << "Site_Lh   ";
         for (int i = 0; i < getAlnNSite(); i++)
-            out_sitelh << " " << pattern_lh[pattern_index[i]];
+            out_sitelh << " " << (BootValType)pattern_lh[pattern_index[i]];
         out_sitelh << endl;
     }
 
-    if (!boot_samples.empty()) {
-#ifdef BOOT_VAL_FLOAT
-    	aligned_free(pattern_lh_orig);
-#endif
-    	aligned_free(pattern_lh);
-    } else {
-#ifdef BOOT_VAL_FLOAT
-    	aligned_free(pattern_lh);
-#endif
-    }
+    aligned_free(pattern_lh);
 
 }
 
 void IQTree::saveNNITrees(PhyloNode *node, PhyloNode *dad) {
     if (!node) {
-        node = (PhyloNode*) root;
+        bool nni5 = params->nni5;
+        params->nni5 = true; // always optimize 5 branches as for SH-aLRT
+        saveNNITrees((PhyloNode*) root, NULL);
+        params->nni5 = nni5;
+        return;
     }
     if (dad && !node->isLeaf() && !dad->isLeaf()) {
         double *pat_lh1 = new double[aln->getNPattern()];
         double *pat_lh2 = new double[aln->getNPattern()];
         double lh1, lh2;
         computeNNIPatternLh(curScore, lh1, pat_lh1, lh2, pat_lh2, node, dad);
+        if (max(lh1, lh2) > curScore + TOL_LIKELIHOOD)
+            cout << "Alternative NNI shows better log-likelihood " << max(lh1, lh2) << " > " << curScore << endl;
         delete[] pat_lh2;
         delete[] pat_lh1;
     }
@@ -3726,6 +4065,24 @@ void IQTree::summarizeBootstrap(Params &params, MTreeSet &trees) {
 
 }
 
+/**
+    round the branch lengths of a UFBoot tree to the 6 significant digits of the Newick strings
+    the trees were stored as before, their codes keep single-precision lengths
+*/
+static void roundUFBootLengths(MTree *tree) {
+    NodeVector nodes1, nodes2;
+    tree->getBranches(nodes1, nodes2);
+    for (int i = 0; i < nodes1.size(); i++) {
+        stringstream ss;
+        ss.precision(6);
+        ss << nodes1[i]->findNeighbor(nodes2[i])->length;
+        double length;
+        ss >> length;
+        nodes1[i]->findNeighbor(nodes2[i])->length = length;
+        nodes2[i]->findNeighbor(nodes1[i])->length = length;
+    }
+}
+
 void IQTree::writeUFBootTrees(Params &params) {
     MTreeSet trees;
 //    IntVector tree_weights;
@@ -3745,6 +4102,8 @@ void IQTree::writeUFBootTrees(Params &params) {
             // reinsert removed seqs into each tree
             trees[i]->insertTaxa(removed_seqs, twin_seqs);
         }
+        if (params.print_ufboot_trees == 2)
+            roundUFBootLengths(trees[i]);
         // now print to file
         for (j = 0; j < trees.tree_weights[i]; j++)
             if (params.print_ufboot_trees == 1)
@@ -3790,9 +4149,9 @@ void IQTree::pllConvertUFBootData2IQTree(){
 //        treels_logl.push_back(pllUFBootDataPtr->treels_logl[i]);
 
     //boot_trees
-    boot_trees.clear();
+    boot_trees.resize(params->gbo_replicates);
     for(int i = 0; i < params->gbo_replicates; i++)
-        boot_trees.push_back(pllUFBootDataPtr->boot_trees[i]);
+        restoreUFBootTree(pllUFBootDataPtr->boot_trees[i], boot_trees[i]);
 
 }
 
@@ -32,6 +32,7 @@
 #include "mtreeset.h"
 #include "node.h"
 #include "candidateset.h"
+#include "bootsamplematrix.h"
 #include "utils/pllnni.h"
 
 typedef std::map< string, double > mapString2Double;
@@ -126,6 +127,13 @@ public:
     */
     void restoreUFBoot(Checkpoint *checkpoint);
 
+    /**
+        restore a UFBoot tree from its checkpoint entry
+        @param tree_str packed tree code, or Newick string with taxon IDs (older checkpoints, PLL)
+        @param[out] code tree code
+    */
+    void restoreUFBootTree(const string &tree_str, TreeCode &code);
+
     /**
      * setup all necessary parameters  (declared as virtual needed for phylosupertree)
      */
@@ -449,6 +457,77 @@ public:
      */
     void evaluateNNIs(Branches &nniBranches, vector<NNIMove> &outNNIMoves);
 
+    /**
+     * @return TRUE if NNIs of different branches can be evaluated concurrently (-nni-par)
+     */
+    bool isParallelNNI();
+
+    /**
+     * @brief Evaluate NNIs of different branches concurrently, each thread working on its own
+     * copy of the tree with its own partial likelihood, nni_partial_lh and nni_scale_num memory
+     *
+     * @param nniBranches [IN] branches the branches on which NNIs will be evaluated
+     * @return list positive NNIs, in the same order as evaluateNNIs
+     */
+    void evaluateNNIsParallel(Branches &nniBranches, vector<NNIMove> &outNNIMoves);
+
+    /**
+     * copy the topology and branch lengths of this tree into a worker tree of evaluateNNIsParallel,
+     * keeping node IDs and the order of neighbors. A worker still holding this tree from the previous
+     * call only gets the NNIs and branch lengths applied since, keeping its other partial likelihoods
+     * @param thread_id thread of the worker tree
+     * @param[out] worker_nodes nodes of the worker tree indexed by node ID
+     */
+    void syncNNIWorker(int thread_id, NodeVector &worker_nodes);
+
+    /**
+     * compute the supports of different internal branches concurrently (-nni-par), each thread
+     * evaluating the NNIs of its branches on its own worker tree
+     */
+    virtual void testBranches(NodeVector &nodes1, NodeVector &nodes2, double best_score, double *pattern_lh,
+            int reps, int lbp_reps, int *rell_ptn_freq, vector<BranchSupport> &supports);
+
+    /**
+     * @return TRUE if initial and user trees are evaluated concurrently (-tree-par)
+     */
+    bool isParallelTreeEval();
+
+    /**
+     * make sure there are num_workers worker trees sharing the alignment, model and rates of this tree
+     * @param keep_trees TRUE to keep the trees of the workers for syncNNIWorker, FALSE if they are replaced
+     */
+    void createWorkers(int num_workers, bool keep_trees = false);
+
+    /**
+     * @return worker tree of a thread, see createWorkers
+     */
+    PhyloTree *getWorker(int thread_id) { return workers[thread_id]; }
+
+    /**
+     * let a worker tree compute likelihoods under the current model of this tree with a single-threaded
+     * kernel, to be called by its thread before a tree is read into the worker
+     */
+    void setupWorker(PhyloTree *worker);
+
+    /**
+     * compute the log-likelihoods of several trees concurrently, each thread reading the trees into
+     * its own worker tree with its own partial likelihood memory
+     * @param trees tree strings with taxon IDs, as written by getTreeString()
+     * @param max_traversal number of traversals to optimize the branch lengths, 0 to keep them
+     * @param[out] scores log-likelihoods of the trees
+     * @param[out] out_trees tree strings with the optimized branch lengths
+     */
+    void evaluateTreesParallel(StrVector &trees, int max_traversal, DoubleVector &scores, StrVector &out_trees);
+
+    /** free the worker trees */
+    void deleteWorkers();
+
+    /**
+     * clear all partial likelihoods, the worker trees will be copied again by syncNNIWorker
+     * @param make_null true to make all partial_lh become NULL
+     */
+    virtual void clearAllPartialLH(bool make_null = false);
+
     double optimizeNNIBranches(Branches &nniBranches);
 
     /**
@@ -616,6 +695,16 @@ protected:
     */
     SplitIntMap initTabuSplits;
 
+    /**
+     *  copies of the tree to evaluate NNIs or trees concurrently, one per thread
+     */
+    vector<PhyloTree*> workers;
+
+    /**
+     *  worker_synced[i] is 1 if workers[i] holds this tree with partial likelihoods under the current model
+     */
+    IntVector worker_synced;
+
     /**
             criterion to assess important quartet
      */
@@ -678,11 +767,13 @@ public:
      *      the score of the new tree
      *  @param updateStopRule
      *      Whether or not to update the stop rule
+     *  @param tree
+     *      the tree of treeString if it is in memory (usually this), to encode it without parsing
      *  @return relative position of the new tree to the current best.
      *      -1 if duplicated
      *      -2 if the candidate set is not updated
      */
-    int addTreeToCandidateSet(string treeString, double score, bool updateStopRule, int sourceProcID);
+    int addTreeToCandidateSet(string treeString, double score, bool updateStopRule, int sourceProcID, MTree *tree = NULL);
 
     /**
         MPI: synchronize candidate trees between all processes
@@ -762,8 +853,8 @@ public:
     /** log-likelihood threshold (l_min) */
     double logl_cutoff;
 
-    /** vector of bootstrap alignments generated */
-    vector<BootValType* > boot_samples;
+    /** pattern counts of bootstrap alignments generated */
+    BootSampleMatrix boot_samples;
 
     /** starting sample for UFBoot, used for MPI */
     int sample_start;
@@ -771,8 +862,8 @@ public:
     /** end sample for UFBoot, used for MPI */
     int sample_end;
 
-    /** newick string of corresponding bootstrap trees */
-    StrVector boot_trees;
+    /** compact codes of corresponding bootstrap trees, with branch lengths for -wbtl option */
+    vector<TreeCode> boot_trees;
 
     /** bootstrap tree strings with branch lengths, for -wbtl option */
 //    StrVector boot_trees_brlen;
@@ -25,13 +25,19 @@
 const int MEM_LOCKED = 1;
 const int MEM_SPECIAL = 2;
 
-void MemSlotVector::init(PhyloTree *tree, int num_slot) {
+/** bit of PhyloNeighbor::partial_lh_computed: a 32-bit slot keeps a copy of partial_lh */
+const int LH32_SAVED = 4;
+
+void MemSlotVector::init(PhyloTree *tree, int num_slot, int num_lh32_slot) {
     if (Params::getInstance().lh_mem_save != LM_MEM_SAVE)
         return;
     reserve(num_slot+2);
     resize(num_slot);
-    size_t lh_size = tree->getPartialLhSize();
-    size_t scale_size = tree->getScaleNumSize();
+    lh_size = tree->getPartialLhSize();
+    scale_size = tree->getScaleNumSize();
+    lh32.resize(num_lh32_slot*lh_size);
+    scale32.resize(num_lh32_slot*scale_size);
+    lh32_nei.resize(num_lh32_slot);
     reset();
     for (iterator it = begin(); it != end(); it++) {
         it->partial_lh = tree->central_partial_lh + lh_size*(it-begin());
@@ -45,9 +51,51 @@ void MemSlotVector::reset() {
     for (iterator it = begin(); it != end(); it++) {
         it->status = 0;
         it->nei = NULL;
+        it->priority = 0.0;
     }
     nei_id_map.clear();
+    evicted_neis.clear();
     free_count = 0;
+    clock = 0.0;
+    fill(lh32_nei.begin(), lh32_nei.end(), (PhyloNeighbor*)NULL);
+    lh32_id_map.clear();
+    lh32_next = 0;
+    lh32_save_id = -1;
+}
+
+void MemSlotVector::resetStats() {
+    num_hits = num_misses = num_recomputes = num_evictions = num_lh32_restores = 0;
+}
+
+void MemSlotVector::setPriority(iterator it) {
+    // a subtree with k taxa needs (k-1) partial_lh vectors to be rebuilt in the worst case
+    it->priority = clock + max(it->nei->size, 1);
+}
+
+void MemSlotVector::touch(PhyloNeighbor *nei) {
+    if (Params::getInstance().lh_mem_save != LM_MEM_SAVE)
+        return;
+    if (nei->node->isLeaf())
+        return;
+    num_hits++;
+    iterator it = findNei(nei);
+    if ((it->status & MEM_SPECIAL) == 0)
+        setPriority(it);
+}
+
+void MemSlotVector::printStats(ostream &out) {
+    if (Params::getInstance().lh_mem_save != LM_MEM_SAVE)
+        return;
+    int64_t total = num_hits + num_misses;
+    out << "Memory slots: " << size() << " partial_lh vectors, "
+        << num_hits << " hits, " << num_misses << " misses ("
+        << num_recomputes << " recomputed after eviction), "
+        << num_evictions << " evictions";
+    if (num_lh32_restores > 0 || !lh32_nei.empty())
+        out << ", " << num_lh32_restores << " restored from 32-bit copies";
+    if (total > 0)
+        out << ", hit rate " << (num_hits * 100.0 / total) << "%";
+    out << endl;
 }
 
 
@@ -64,6 +112,7 @@ void MemSlotVector::addNei(PhyloNeighbor *nei, iterator it) {
     nei->scale_num = it->scale_num;
     it->nei = nei;
     nei_id_map[nei] = it-begin();
+    setPriority(it);
 }
 
 
@@ -75,6 +124,7 @@ void MemSlotVector::addSpecialNei(PhyloNeighbor *nei) {
     ms.nei = nei;
     ms.partial_lh = nei->partial_lh;
     ms.scale_num = nei->scale_num;
+    ms.priority = 0.0;
     push_back(ms);
     nei_id_map[nei] = size()-1;
 }
@@ -134,6 +184,10 @@ int MemSlotVector::allocate(PhyloNeighbor *nei) {
     if (Params::getInstance().lh_mem_save != LM_MEM_SAVE)
         return -1;
 
+    num_misses++;
+    if (!evicted_neis.empty() && evicted_neis.erase(nei))
+        num_recomputes++;
+
     // first find a free slot
     if (free_count < size() && (at(free_count).status & MEM_SPECIAL) == 0) {
         iterator it = begin() + free_count;
@@ -143,25 +197,27 @@ int MemSlotVector::allocate(PhyloNeighbor *nei) {
         return it-begin();
     }
 
-    int min_size = INT_MAX;
+    double min_priority = DBL_MAX;
     iterator best = end();
 
-
-    // no free slot found, find an unlocked slot with minimal size
+    // no free slot found, find an unlocked slot that is cheapest to recompute
+    // and least recently used (lowest GreedyDual priority)
     for (iterator it = begin(); it != end(); it++)
-        if ((it->status & MEM_LOCKED) == 0 && (it->status & MEM_SPECIAL) == 0 && min_size > it->nei->size) {
+        if ((it->status & MEM_LOCKED) == 0 && (it->status & MEM_SPECIAL) == 0 && min_priority > it->priority) {
             best = it;
-            min_size = it->nei->size;
-            // 2 is the minimum size
-            if (min_size == 2)
-                break;
+            min_priority = it->priority;
         }
 
     if (best == end())
         return -1;
 
+    // age all remaining slots by raising the clock to the evicted priority
+    clock = min_priority;
+    num_evictions++;
+    evicted_neis.insert(best->nei);
+
     // clear mem assigned to it->nei
-    best->nei->clearPartialLh();
+    evict(best, nei);
 
     // assign mem to nei
     addNei(nei, best);
@@ -173,16 +229,111 @@ void MemSlotVector::update(PhyloNeighbor *nei) {
     if (Params::getInstance().lh_mem_save != LM_MEM_SAVE)
         return;
 
+    num_misses++;
+    if (!evicted_neis.empty() && evicted_neis.erase(nei))
+        num_recomputes++;
+
     iterator it = findNei(nei);
 //    if (it->status & MEM_SPECIAL)
 //        return;
     if (it->nei != nei) {
         // clear mem assigned to it->nei
-        it->nei->clearPartialLh();
+        evict(it, nei);
 
         // assign mem to nei
         addNei(nei, it);
+    } else if ((it->status & MEM_SPECIAL) == 0)
+        setPriority(it);
+}
+
+void MemSlotVector::evict(iterator it, PhyloNeighbor *nei) {
+    PhyloNeighbor *old_nei = it->nei;
+    bool computed = (old_nei->partial_lh_computed & 1) != 0;
+    int id = findLh32(old_nei);
+    old_nei->clearPartialLh();
+    if (lh32_nei.empty() || !computed)
+        return;
+    if (lh32_save_id >= 0) {
+        // a copy never handed over to a traversal is never saved
+        lh32_id_map.erase(lh32_nei[lh32_save_id]);
+        lh32_nei[lh32_save_id] = NULL;
+        lh32_save_id = -1;
+    }
+    if (id < 0) {
+        // reuse the slot of an older copy, otherwise the next slot in turn,
+        // but never the one that nei is going to be restored from
+        int keep = findLh32(nei);
+        auto own = lh32_id_map.find(old_nei);
+        if (own != lh32_id_map.end()) {
+            id = own->second;
+        } else {
+            id = lh32_next;
+            if (id == keep)
+                id = (id + 1) % lh32_nei.size();
+            if (id == keep)
+                return;
+            lh32_next = (id + 1) % lh32_nei.size();
+            if (lh32_nei[id])
+                lh32_id_map.erase(lh32_nei[id]);
+            lh32_nei[id] = old_nei;
+            lh32_id_map[old_nei] = id;
+        }
+        lh32_save_id = id;
+        lh32_save_lh = it->partial_lh;
+        lh32_save_scale = it->scale_num;
+    }
+    old_nei->partial_lh_computed = LH32_SAVED;
+}
+
+void MemSlotVector::freeLh32() {
+    vector<uint32_t>().swap(lh32);
+    vector<UBYTE>().swap(scale32);
+    vector<PhyloNeighbor*>().swap(lh32_nei);
+    lh32_id_map.clear();
+    lh32_next = 0;
+    lh32_save_id = -1;
+}
+
+int MemSlotVector::findLh32(PhyloNeighbor *nei) {
+    if (lh32_nei.empty() || (nei->partial_lh_computed & LH32_SAVED) == 0)
+        return -1;
+    auto it = lh32_id_map.find(nei);
+    if (it == lh32_id_map.end())
+        return -1;
+    return it->second;
+}
+
+void MemSlotVector::addLh32Save(TraversalInfo &info) {
+    if (lh32_save_id < 0)
+        return;
+    info.lh32_save = lh32_save_id;
+    info.lh32_save_lh = lh32_save_lh;
+    info.lh32_save_scale = lh32_save_scale;
+    lh32_save_id = -1;
+}
+
+void MemSlotVector::saveLh32(int id, double *partial_lh, UBYTE *scale_num, size_t lh_lower, size_t lh_upper,
+    size_t scale_lower, size_t scale_upper)
+{
+    uint32_t *dest = &lh32[id*lh_size];
+    for (size_t i = lh_lower; i < lh_upper; i++) {
+        uint64_t bits;
+        memcpy(&bits, &partial_lh[i], sizeof(bits));
+        // round to nearest, a carry into the exponent is still the nearest value
+        dest[i] = (uint32_t)((bits + 0x80000000ULL) >> 32);
+    }
+    memcpy(&scale32[id*scale_size + scale_lower], scale_num + scale_lower, scale_upper - scale_lower);
+}
+
+void MemSlotVector::restoreLh32(int id, double *partial_lh, UBYTE *scale_num, size_t lh_lower, size_t lh_upper,
+    size_t scale_lower, size_t scale_upper)
+{
+    uint32_t *src = &lh32[id*lh_size];
+    for (size_t i = lh_lower; i < lh_upper; i++) {
+        uint64_t bits = (uint64_t)src[i] << 32;
+        memcpy(&partial_lh[i], &bits, sizeof(bits));
     }
+    memcpy(scale_num + scale_lower, &scale32[id*scale_size + scale_lower], scale_upper - scale_lower);
 }
 
 /*
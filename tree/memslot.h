@@ -26,6 +26,8 @@
 #error "Please #include phylotree.h before including this header file" 
 #endif
 
+class TraversalInfo;
+
 /**
     one memory slot, used for memory saving technique
 */
@@ -36,6 +38,9 @@ struct MemSlot {
     UBYTE *scale_num; // scale_num assigned to this slot
 
     PhyloNeighbor *saved_nei;
+
+    /** eviction priority: recency clock at last use plus recomputation cost of the subtree */
+    double priority;
 };
 
 /**
@@ -44,8 +49,13 @@ struct MemSlot {
 class MemSlotVector : public vector<MemSlot> {
 public:
 
-    /** initialize with a specified number of slots */
-    void init(PhyloTree *tree, int num_slot);
+    MemSlotVector() : lh32_next(0), lh32_save_id(-1) { resetStats(); }
+
+    /**
+        initialize with a specified number of slots
+        @param num_lh32_slot number of 32-bit slots keeping copies of evicted partial_lh (-lh32)
+    */
+    void init(PhyloTree *tree, int num_slot, int num_lh32_slot = 0);
 
     /** 
         lock the memory assigned to nei
@@ -93,8 +103,75 @@ public:
     /** restore neighbor, after calling replace */
     void restore(PhyloNeighbor *new_nei, PhyloNeighbor *old_nei);
 
+    /**
+        record a cache hit: partial_lh of nei is still valid and is reused
+        @param nei neighbor whose partial_lh is reused
+    */
+    void touch(PhyloNeighbor *nei);
+
+    /** print hit/miss/recompute statistics */
+    void printStats(ostream &out);
+
+    /** zero the hit/miss/recompute statistics, reset() keeps them across reinitializations */
+    void resetStats();
+
+    /** number of times a computed partial_lh was reused */
+    int64_t num_hits;
+
+    /** number of times a partial_lh had to be computed */
+    int64_t num_misses;
+
+    /** number of misses for partial_lh that were previously computed and then evicted */
+    int64_t num_recomputes;
+
+    /** number of partial_lh evicted to make room for another one */
+    int64_t num_evictions;
+
+    /**
+        @return 32-bit slot keeping a valid copy of the partial_lh of nei, -1 if none
+    */
+    int findLh32(PhyloNeighbor *nei);
+
+    /**
+        hand the copy of the partial_lh evicted by the last allocate() or update() over to info,
+        it is saved when info is computed, before its partial_lh overwrites the evicted one
+    */
+    void addLh32Save(TraversalInfo &info);
+
+    /**
+        save entries [lh_lower, lh_upper) of partial_lh and [scale_lower, scale_upper) of scale_num
+        into a 32-bit slot, keeping the upper 32 bits of every double (sign, exponent and 20 bits of mantissa)
+    */
+    void saveLh32(int id, double *partial_lh, UBYTE *scale_num, size_t lh_lower, size_t lh_upper,
+        size_t scale_lower, size_t scale_upper);
+
+    /**
+        restore entries of partial_lh and scale_num from a 32-bit slot, the inverse of saveLh32()
+    */
+    void restoreLh32(int id, double *partial_lh, UBYTE *scale_num, size_t lh_lower, size_t lh_upper,
+        size_t scale_lower, size_t scale_upper);
+
+    /** release the 32-bit slots, partial_lh evicted from now on are recomputed in double */
+    void freeLh32();
+
+    /** number of partial_lh restored from 32-bit slots instead of being recomputed */
+    int64_t num_lh32_restores;
+
 protected:
 
+    /**
+        take the slot away from its neighbor, keeping a 32-bit copy of its partial_lh if there are 32-bit slots
+        @param it the slot
+        @param nei neighbor getting the slot
+    */
+    void evict(iterator it, PhyloNeighbor *nei);
+
+    /**
+        set the eviction priority of a slot (GreedyDual-Size policy):
+        clock + recomputation cost, where cost is the subtree size below the neighbor
+    */
+    void setPriority(iterator it);
+
 
     /** 
         map from neighbor to slot ID for fast lookup
@@ -105,6 +182,33 @@ protected:
     /** counter of free slot ID */
     int free_count;
 
+    /** inflation clock, set to the priority of the last evicted slot */
+    double clock;
+
+    /** neighbors whose partial_lh was evicted and not yet recomputed */
+    unordered_set<PhyloNeighbor*> evicted_neis;
+
+    /** 32-bit slots: upper halves of partial_lh and scale_num */
+    vector<uint32_t> lh32;
+    vector<UBYTE> scale32;
+
+    /** number of entries of partial_lh and scale_num per slot */
+    size_t lh_size, scale_size;
+
+    /** neighbor owning each 32-bit slot */
+    vector<PhyloNeighbor*> lh32_nei;
+
+    /** map from neighbor to its 32-bit slot */
+    unordered_map<PhyloNeighbor*, int> lh32_id_map;
+
+    /** next 32-bit slot to be reused, in round-robin order */
+    int lh32_next;
+
+    /** copy of the partial_lh evicted by the last allocate() or update(), -1 if none */
+    int lh32_save_id;
+    double *lh32_save_lh;
+    UBYTE *lh32_save_scale;
+
 };
 
 
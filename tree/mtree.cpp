@@ -69,19 +69,13 @@ MTree::MTree(MTree &tree) {
 }
 
 MTree::MTree(string& treeString, vector<string>& taxaNames, bool isRooted) {
-    stringstream str;
-    str << treeString;
-    str.seekg(0, ios::beg);
-    readTree(str, isRooted);
+    readNewick(treeString.c_str(), treeString.c_str() + treeString.length(), isRooted);
     assignIDs(taxaNames);
     assignLeafID();
 }
 
 MTree::MTree(string& treeString, bool isRooted) {
-    stringstream str;
-    str << treeString;
-    str.seekg(0, ios::beg);
-    readTree(str, isRooted);
+    readNewick(treeString.c_str(), treeString.c_str() + treeString.length(), isRooted);
     assignLeafID();
 }
 
@@ -661,14 +655,46 @@ void MTree::readTreeString(string tree_string, bool is_rooted) {
 
 void MTree::readTree(istream &in, bool &is_rooted)
 {
-    in_line = 1;
-    in_column = 1;
+    // copy the tree up to its semi-colon into a buffer, skipping semi-colons in comments and quoted names
+    in_buffer.clear();
+    streambuf *buf = in.rdbuf();
+    const int eof = streambuf::traits_type::eof();
+    char quote = 0, last = 0;
+    bool comment = false;
+    int c;
+    while ((c = buf->sbumpc()) != eof) {
+        in_buffer += (char)c;
+        if (quote) {
+            if (c == quote)
+                quote = 0;
+        } else if (comment) {
+            if (c == ']')
+                comment = false;
+        } else if (c == '[') {
+            comment = true;
+        } else if ((c == '\'' || c == '"') && (last == '(' || last == ',' || last == ')')) {
+            quote = c;
+        } else if (c == ';') {
+            break;
+        } else if (!controlchar(c))
+            last = c;
+    }
+    if (c == eof)
+        in.setstate(ios::eofbit);
+    readNewick(in_buffer.data(), in_buffer.data() + in_buffer.size(), is_rooted);
+}
+
+void MTree::readNewick(const char *begin, const char *end, bool &is_rooted, StrVector *leaf_names)
+{
+    in_begin = in_pos = begin;
+    in_end = end;
+    in_eof = false;
     in_comment = "";
     try {
         char ch;
-        ch = readNextChar(in);
+        ch = readNextChar();
         if (ch != '(') {
-        	cout << in.rdbuf() << endl;
+        	cout << string(in_pos, in_end) << endl;
             throw "Tree file does not start with an opening-bracket '('";
         }
 
@@ -676,7 +702,7 @@ void MTree::readTree(istream &in, bool &is_rooted)
 
         DoubleVector branch_len;
         Node *node;
-        parseFile(in, ch, node, branch_len);
+        parseFile(ch, node, branch_len, leaf_names);
         // 2018-01-05: assuming rooted tree if root node has two children
         if (is_rooted || !branch_len.empty() || node->degree() == 2) {
             if (branch_len.empty())
@@ -699,19 +725,19 @@ void MTree::readTree(istream &in, bool &is_rooted)
         // make sure that root is a leaf
         ASSERT(root->isLeaf());
 
-        if (in.eof() || ch != ';')
+        if (in_eof || ch != ';')
             throw "Tree file must be ended with a semi-colon ';'";
     } catch (bad_alloc) {
         outError(ERR_NO_MEMORY);
     } catch (const char *str) {
-        outError(str, reportInputInfo());
+        outError(str, reportNewickInfo());
     } catch (string str) {
-        outError(str.c_str(), reportInputInfo());
+        outError(str.c_str(), reportNewickInfo());
     } catch (ios::failure) {
-        outError(ERR_READ_INPUT, reportInputInfo());
+        outError(ERR_READ_INPUT, reportNewickInfo());
     } catch (...) {
         // anything else
-        outError(ERR_READ_ANY, reportInputInfo());
+        outError(ERR_READ_ANY, reportNewickInfo());
     }
 
     nodeNum = leafNum;
@@ -745,40 +771,27 @@ void MTree::initializeTree(Node *node, Node* dad)
     }
 }
 
-void MTree::parseBranchLength(string &lenstr, DoubleVector &branch_len) {
-//    branch_len.push_back(convert_double(lenstr.c_str()));
-    double len = convert_double(lenstr.c_str());
+void MTree::parseBranchLength(const char *lenstr, int len, DoubleVector &branch_len) {
+    char *endptr;
+    double d = strtod(lenstr, &endptr);
+    if (len == 0 || endptr != lenstr + len || fabs(d) == HUGE_VALF) {
+        string err = "Expecting floating-point number, but found \"";
+        err.append(lenstr, len);
+        err += "\" instead";
+        throw err;
+    }
     if (in_comment.empty()) {
-        branch_len.push_back(len);
+        branch_len.push_back(d);
         return;
     }
     convert_double_vec(in_comment.c_str(), branch_len, BRANCH_LENGTH_SEPARATOR);
-//    char* str = (char*)in_comment.c_str() + 1;
-//    int pos;
-//    for (int i = 1; str[0] == 'L'; i++) {
-//        str++;
-//        int id = convert_int(str, pos);
-//        if (id != i)
-//            throw "Wrong ID in " + string(str);
-//        if (str[pos] != '=')
-//            throw "= is expected in " + string(str);
-//        str += pos+1;
-//        double val = convert_double(str, pos);
-//        branch_len.push_back(val);
-//        if (str[pos] == ',') {
-//            str += pos+1;
-//            continue;
-//        } else
-//            break;
-//    }
 }
 
 
-void MTree::parseFile(istream &infile, char &ch, Node* &root, DoubleVector &branch_len)
+void MTree::parseFile(char &ch, Node* &root, DoubleVector &branch_len, StrVector *leaf_names)
 {
     Node *node;
     int maxlen = 1000;
-    string seqname;
     int seqlen;
     DoubleVector brlen;
     branch_len.clear();
@@ -786,22 +799,19 @@ void MTree::parseFile(istream &infile, char &ch, Node* &root, DoubleVector &bran
     root = newNode();
 
     if (ch == '(') {
-        // internal node
-        ch = readNextChar(infile);
-        while (ch != ')' && !infile.eof())
+        // internal node, with two children and the parent for bifurcating trees
+        root->neighbors.reserve(3);
+        ch = readNextChar();
+        while (ch != ')' && !in_eof)
         {
             node = NULL;
-            parseFile(infile, ch, node, brlen);
-            //if (brlen == -1.0)
-            //throw "Found branch with no length.";
-            //if (brlen < 0.0)
-            //throw ERR_NEG_BRANCH;
+            parseFile(ch, node, brlen, leaf_names);
             root->addNeighbor(node, brlen);
             node->addNeighbor(root, brlen);
-            if (infile.eof())
+            if (in_eof)
                 throw "Expecting ')', but end of file instead";
             if (ch == ',')
-                ch = readNextChar(infile);
+                ch = readNextChar();
             else if (ch != ')') {
                 string err = "Expecting ')', but found '";
                 err += ch;
@@ -809,75 +819,86 @@ void MTree::parseFile(istream &infile, char &ch, Node* &root, DoubleVector &bran
                 throw err;
             }
         }
-        if (!infile.eof()) ch = readNextChar(infile);
+        if (!in_eof) ch = readNextChar();
     }
-    // now read the node name
+    // now read the node name, ch is the last character read from the buffer
     seqlen = 0;
     char end_ch = 0;
     if (ch == '\'' || ch == '"') end_ch = ch;
-    seqname = "";
+    const char *seqname = in_pos - 1;
 
-    while (!infile.eof() && seqlen < maxlen)
+    while (!in_eof && seqlen < maxlen)
     {
         if (end_ch == 0) {
             if (is_newick_token(ch) || controlchar(ch)) break;
         }
-        seqname += ch;
         seqlen++;
-//        seqname[seqlen++] = ch;
-        ch = infile.get();
-        in_column++;
+        ch = getNextChar();
         if (end_ch != 0 && ch == end_ch) {
-            seqname += ch;
             seqlen++;
-//            seqname[seqlen++] = ch;
             break;
         }
     }
-    if ((controlchar(ch) || ch == '[' || ch == end_ch) && !infile.eof())
-        ch = readNextChar(infile, ch);
+    if ((controlchar(ch) || ch == '[' || ch == end_ch) && !in_eof)
+        ch = readNextChar(ch);
     if (seqlen == maxlen)
         throw "Too long name ( > 1000)";
-    if (root->isLeaf())
-        renameString(seqname);
-//    seqname[seqlen] = 0;
     if (seqlen == 0 && root->isLeaf())
         throw "Redundant double-bracket ‘((…))’ with closing bracket ending at";
-    if (seqlen > 0)
-        root->name.append(seqname);
-    if (root->isLeaf()) {
-        // is a leaf, assign its ID
-        root->id = leafNum;
+    if (root->isLeaf() && leaf_names) {
+        // taxon ID printed by IQ-TREE itself
+        int id = 0, i;
+        for (i = 0; i < seqlen && seqname[i] >= '0' && seqname[i] <= '9'; i++)
+            id = id*10 + (seqname[i] - '0');
+        if (i == 0 || i < seqlen) {
+            // not a plain number, e.g. quoted: convert like assignLeafNames did
+            string name(seqname, seqlen);
+            renameString(name);
+            id = atoi(name.c_str());
+        }
+        if (id < 0 || id >= leaf_names->size())
+            throw "Taxon ID expected, but found " + string(seqname, seqlen);
+        root->id = id;
+        root->name = (*leaf_names)[id];
         if (leafNum == 0)
             MTree::root = root;
         leafNum++;
+    } else {
+        if (seqlen > 0) {
+            root->name.append(seqname, seqlen);
+            if (root->isLeaf())
+                renameString(root->name);
+        }
+        if (root->isLeaf()) {
+            // is a leaf, assign its ID
+            root->id = leafNum;
+            if (leafNum == 0)
+                MTree::root = root;
+            leafNum++;
+        }
     }
 
-    if (ch == ';' || infile.eof())
+    if (ch == ';' || in_eof)
         return;
     if (ch == ':')
     {
-        string saved_comment = in_comment;
-        ch = readNextChar(infile);
+        string saved_comment;
+        saved_comment.swap(in_comment);
+        ch = readNextChar();
         if (in_comment.empty())
-            in_comment = saved_comment;
+            in_comment.swap(saved_comment);
         seqlen = 0;
-        seqname = "";
-        while (!is_newick_token(ch) && !controlchar(ch) && !infile.eof() && seqlen < maxlen)
+        const char *lenstr = in_pos - 1;
+        while (!is_newick_token(ch) && !controlchar(ch) && !in_eof && seqlen < maxlen)
         {
-//            seqname[seqlen] = ch;
-            seqname += ch;
             seqlen++;
-            ch = infile.get();
-            in_column++;
+            ch = getNextChar();
         }
-        if ((controlchar(ch) || ch == '[') && !infile.eof())
-            ch = readNextChar(infile, ch);
-        if (seqlen == maxlen || infile.eof())
+        if ((controlchar(ch) || ch == '[') && !in_eof)
+            ch = readNextChar(ch);
+        if (seqlen == maxlen || in_eof)
             throw "branch length format error.";
-//        seqname[seqlen] = 0;
-        parseBranchLength(seqname, branch_len);
-//        convert_double_vec(seqname.c_str(), branch_len, BRANCH_LENGTH_SEPARATOR);
+        parseBranchLength(lenstr, seqlen, branch_len);
     }
 }
 
@@ -1489,54 +1510,26 @@ int MTree::freeNode(Node *node, Node *dad)
     return num_nodes;
 }
 
-char MTree::readNextChar(istream &in, char current_ch) {
+char MTree::readNextChar(char current_ch) {
     char ch;
     if (current_ch == '[')
         ch = current_ch;
-    else {
-        in.get(ch);
-        in_column++;
-        if (ch == 10) {
-            in_line++;
-            in_column = 1;
-        }
-    }
-    while (controlchar(ch) && !in.eof()) {
-        in.get(ch);
-        in_column++;
-        if (ch == 10) {
-            in_line++;
-            in_column = 1;
-        }
-    }
-    in_comment = "";
+    else
+        ch = getNextChar();
+    while (controlchar(ch) && !in_eof)
+        ch = getNextChar();
+    in_comment.clear();
     // ignore comment
-    while (ch=='[' && !in.eof()) {
-        while (ch!=']' && !in.eof()) {
-            in.get(ch);
+    while (ch=='[' && !in_eof) {
+        while (ch!=']' && !in_eof) {
+            ch = getNextChar();
             if (ch != ']')
                 in_comment += ch;
-            in_column++;
-            if (ch == 10) {
-                in_line++;
-                in_column = 1;
-            }
         }
         if (ch != ']') throw "Comments not ended with ]";
-        in_column++;
-        in.get(ch);
-        if (ch == 10) {
-            in_line++;
-            in_column = 1;
-        }
-        while (controlchar(ch) && !in.eof()) {
-            in_column++;
-            in.get(ch);
-            if (ch == 10) {
-                in_line++;
-                in_column = 1;
-            }
-        }
+        ch = getNextChar();
+        while (controlchar(ch) && !in_eof)
+            ch = getNextChar();
     }
     return ch;
 }
@@ -1547,6 +1540,19 @@ string MTree::reportInputInfo() {
     return str;
 }
 
+string MTree::reportNewickInfo() {
+    in_line = 1;
+    in_column = 1;
+    for (const char *pos = in_begin; pos < in_pos; pos++) {
+        in_column++;
+        if (*pos == 10) {
+            in_line++;
+            in_column = 1;
+        }
+    }
+    return reportInputInfo();
+}
+
 
 typedef map<int, Neighbor*> IntNeighborMap;
 
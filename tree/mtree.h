@@ -299,29 +299,37 @@ public:
     virtual void readTree(istream &in, bool &is_rooted);
 
     /**
-            read the tree from a newick string
-            @param tree_string the tree string.
+            @return text of the last tree read by readTree(istream&), up to and including its semi-colon
+     */
+    const string &getTreeText() const { return in_buffer; }
+
+    /**
+            read the tree in newick format directly from a character buffer
+            @param begin the first character of the tree
+            @param end the end of the buffer
             @param is_rooted (IN/OUT) true if tree is rooted
+            @param leaf_names if not NULL, leaf labels are taxon IDs (as printed with WT_TAXON_ID)
+                   and leaves are named after this list
      */
-    //virtual void readTreeString(string tree_string, bool is_rooted);
+    void readNewick(const char *begin, const char *end, bool &is_rooted, StrVector *leaf_names = NULL);
 
     /**
-            parse the tree from the input file in newick format
-            @param infile the input file
+            parse the (sub)tree at the current position of the input buffer
             @param ch (IN/OUT) current char
             @param root (IN/OUT) the root of the (sub)tree
             @param branch_len (OUT) branch length associated to the current root
-		
+            @param leaf_names see readNewick
      */
-    void parseFile(istream &infile, char &ch, Node* &root, DoubleVector &branch_len);
+    void parseFile(char &ch, Node* &root, DoubleVector &branch_len, StrVector *leaf_names);
 
     /**
         parse the string containing branch length(s)
         by default, this will parse just one length
-        @param lenstr string containing branch length(s)
+        @param lenstr string containing branch length(s), not necessarily 0-terminated
+        @param len number of characters of lenstr
         @param[out] branch_len output branch length(s)
     */
-    virtual void parseBranchLength(string &lenstr, DoubleVector &branch_len);
+    virtual void parseBranchLength(const char *lenstr, int len, DoubleVector &branch_len);
 
     /**
             initialize tree, set node structure
@@ -880,6 +888,21 @@ protected:
     */
     string in_comment;
 
+    /**
+        the newick buffer being parsed: its beginning, the next character and its end
+    */
+    const char *in_begin, *in_pos, *in_end;
+
+    /**
+        TRUE if the parser tried to read beyond in_end
+    */
+    bool in_eof;
+
+    /**
+        copy of a tree read from a stream, reused for the next tree
+    */
+    string in_buffer;
+
     /**
      * special character for drawing tree figure
      * 0: vertical line
@@ -899,15 +922,30 @@ protected:
     void checkValidTree(bool& stop, Node *node = NULL, Node *dad = NULL);
 
     /**
-            read the next character from a NEWICK file. Ignore comments [...]
-            @param in input stream
-            @param current_ch current character in the stream
-            @return next character read from input stream
+            @return the next character of the newick buffer, 0 at its end
      */
-    char readNextChar(istream &in, char current_ch = 0);
+    inline char getNextChar() {
+        if (in_pos < in_end)
+            return *in_pos++;
+        in_eof = true;
+        return 0;
+    }
+
+    /**
+            read the next character from the NEWICK buffer. Ignore comments [...]
+            @param current_ch current character in the buffer
+            @return next character read from the buffer
+     */
+    char readNextChar(char current_ch = 0);
 
     string reportInputInfo();
 
+    /**
+            set in_line and in_column to the current position of the newick buffer
+            @return see reportInputInfo()
+     */
+    string reportNewickInfo();
+
     /**
      * Convert node IDs of a pair of nodes to a string in form "id1-id2"
      * where id1 is smaller than id2. This is done to create a key for the map data structure
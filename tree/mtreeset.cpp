@@ -134,6 +134,21 @@ void MTreeSet::init(StrVector &treels, bool &is_rooted) {
 	//tree_weights.resize(size(), 1);
 }
 
+void MTreeSet::init(vector<TreeCode> &codes, bool &is_rooted) {
+	int count = 0;
+	for (vector<TreeCode>::iterator it = codes.begin(); it != codes.end(); it++)
+    if (!it->empty())
+	{
+		count++;
+		MTree *tree = newTree();
+		it->decode(tree);
+		push_back(tree);
+		tree_weights.push_back(1);
+	}
+	if (verbose_mode >= VB_MED)
+		cout << count << " tree(s) converted" << endl;
+}
+
 void MTreeSet::init(vector<string> &trees, vector<string> &taxonNames, bool &is_rooted) {
 	int count = 0;
 	for (vector<string>::iterator it = trees.begin(); it != trees.end(); it++) {
@@ -504,6 +519,16 @@ MTreeSet::~MTreeSet()
 }
 
 
+/**
+	@return number of split IDs in ids that are set in the bitmap marks
+*/
+static inline int countMarkedSplits(IntVector &ids, uint64_t *marks) {
+	int count = 0;
+	for (IntVector::iterator it = ids.begin(); it != ids.end(); it++)
+		count += (marks[*it >> 6] >> (*it & 63)) & 1;
+	return count;
+}
+
 void MTreeSet::computeRFDist(int *rfdist, int mode, double weight_threshold) {
 	// exit if less than 2 trees
 	if (size() < 2)
@@ -515,57 +540,112 @@ void MTreeSet::computeRFDist(int *rfdist, int mode, double weight_threshold) {
 #endif
 	cout << "Computing Robinson-Foulds distance..." << endl;
 
+	int ntrees = size();
 	vector<string> taxname(front()->leafNum);
-	vector<SplitIntMap*> hs_vec;
-	vector<SplitGraph*> sg_vec;
-
 	front()->getTaxaName(taxname);
 
+	// global dictionary assigning an ID to each distinct split of all trees, such that a tree
+	// becomes a sorted ID array. Trivial splits are shared by all trees and thus left out.
+	SplitIntMap split_ids;
+	vector<Split*> splits;
+	// IDs of all splits and of splits with weight >= weight_threshold of every tree
+	vector<IntVector> all_ids(ntrees), heavy_ids(ntrees);
+	bool all_heavy = true;
 
-	// converting trees into split system then stored in SplitIntMap for efficiency
-	for (iterator it = begin(); it != end(); it++) {
-		SplitGraph *sg = new SplitGraph();
-		SplitIntMap *hs = new SplitIntMap();
-
-		(*it)->convertSplits(taxname, *sg);
-		// make sure that taxon 0 is included
-		for (SplitGraph::iterator sit = sg->begin(); sit != sg->end(); sit++) {
+	int id = 0;
+	for (iterator it = begin(); it != end(); it++, id++) {
+		SplitGraph sg;
+		(*it)->convertSplits(taxname, sg);
+		vector<pair<int,bool> > tree_ids;
+		for (SplitGraph::iterator sit = sg.begin(); sit != sg.end(); sit++) {
+			if ((*sit)->trivial() >= 0)
+				continue;
+			// make sure that taxon 0 is included
 			if (!(*sit)->containTaxon(0)) (*sit)->invert();
-			hs->insertSplit((*sit), 1);
+			int split_id;
+			if (!split_ids.findSplit(*sit, split_id)) {
+				split_id = splits.size();
+				splits.push_back(new Split(**sit));
+				split_ids.insertSplit(splits.back(), split_id);
+			}
+			tree_ids.push_back(make_pair(split_id, (*sit)->getWeight() >= weight_threshold));
+		}
+		// a split occurring twice in a tree keeps the weight of its first occurrence
+		stable_sort(tree_ids.begin(), tree_ids.end(),
+			[](const pair<int,bool> &a, const pair<int,bool> &b) { return a.first < b.first; });
+		for (vector<pair<int,bool> >::iterator tit = tree_ids.begin(); tit != tree_ids.end(); tit++) {
+			if (!all_ids[id].empty() && all_ids[id].back() == tit->first)
+				continue;
+			all_ids[id].push_back(tit->first);
+			if (tit->second)
+				heavy_ids[id].push_back(tit->first);
+			else
+				all_heavy = false;
 		}
-		hs_vec.push_back(hs);
-		sg_vec.push_back(sg);
 	}
-
-	// now start the RF computation
-	int id = 0;
-	for (vector<SplitIntMap*>::iterator hsit = hs_vec.begin(); hsit+1 != hs_vec.end(); hsit++, id++) {
-		vector<SplitIntMap*>::iterator end_it = hs_vec.end();
-		if (mode == RF_ADJACENT_PAIR) end_it = hsit+2;
-		int id2 = id+1;
-		for (vector<SplitIntMap*>::iterator hsit2 = hsit+1; hsit2 != end_it; hsit2++, id2++) {
-			int diff_splits = 0;
-			SplitIntMap::iterator spit;
-			for (spit = (*hsit2)->begin(); spit != (*hsit2)->end(); spit++) {
-				if (spit->first->getWeight() >= weight_threshold && !(*hsit)->findSplit(spit->first)) diff_splits++;
-			}
-			for (spit = (*hsit)->begin(); spit != (*hsit)->end(); spit++) {
-				if (spit->first->getWeight() >= weight_threshold && !(*hsit2)->findSplit(spit->first)) diff_splits++;
-			}
-			//int rf_val = (*hsit)->size() + (*hsit2)->size() - 2*common_splits;
-			int rf_val = diff_splits;
-			if (mode == RF_ADJACENT_PAIR) 
-				rfdist[id] = rf_val;
-			else {
-				rfdist[id*size() + id2] = rfdist[id2*size() + id] = rf_val;
+	if (verbose_mode >= VB_MED)
+		cout << splits.size() << " distinct non-trivial splits" << endl;
+
+	// the distance of trees i and j is the number of heavy splits of j missing in i plus the
+	// other way around. Tree i is put into a bitmap to count the splits of each other tree in it.
+	int nwords = (splits.size() + 63) / 64;
+	vector<int> missing;
+	if (!all_heavy)
+		missing.resize(mode == RF_ADJACENT_PAIR ? 2*ntrees : ntrees*ntrees, 0);
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+	{
+		uint64_t *marks = new uint64_t[nwords];
+		memset(marks, 0, sizeof(uint64_t)*nwords);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+		for (int i = 0; i < ntrees; i++) {
+			int first = i+1, last = ntrees;
+			if (mode == RF_ADJACENT_PAIR)
+				last = min(i+2, ntrees);
+			if (!all_heavy)
+				first = (mode == RF_ADJACENT_PAIR) ? max(i-1, 0) : 0;
+			if (first >= last)
+				continue;
+			for (IntVector::iterator it = all_ids[i].begin(); it != all_ids[i].end(); it++)
+				marks[*it >> 6] |= (uint64_t)1 << (*it & 63);
+			for (int j = first; j < last; j++) {
+				if (j == i)
+					continue;
+				if (all_heavy) {
+					int common = countMarkedSplits(all_ids[j], marks);
+					int rf_val = all_ids[i].size() + all_ids[j].size() - 2*common;
+					if (mode == RF_ADJACENT_PAIR)
+						rfdist[i] = rf_val;
+					else
+						rfdist[i*ntrees + j] = rfdist[j*ntrees + i] = rf_val;
+				} else {
+					int rf_val = heavy_ids[j].size() - countMarkedSplits(heavy_ids[j], marks);
+					if (mode == RF_ADJACENT_PAIR)
+						missing[2*min(i,j) + (j < i)] = rf_val;
+					else
+						missing[i*ntrees + j] = rf_val;
+				}
 			}
+			for (IntVector::iterator it = all_ids[i].begin(); it != all_ids[i].end(); it++)
+				marks[*it >> 6] = 0;
 		}
+		delete [] marks;
 	}
-	// delete memory 
-	for (id = size()-1; id >= 0; id--) {
-		delete hs_vec[id];
-		delete sg_vec[id];
+
+	if (!all_heavy) {
+		for (int i = 0; i+1 < ntrees; i++)
+			if (mode == RF_ADJACENT_PAIR)
+				rfdist[i] = missing[2*i] + missing[2*i+1];
+			else
+				for (int j = i+1; j < ntrees; j++)
+					rfdist[i*ntrees + j] = rfdist[j*ntrees + i] = missing[i*ntrees + j] + missing[j*ntrees + i];
 	}
+
+	for (vector<Split*>::reverse_iterator it = splits.rbegin(); it != splits.rend(); it++)
+		delete *it;
 }
 
 
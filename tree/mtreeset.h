@@ -21,6 +21,7 @@
 #define MTREESET_H
 
 #include "mtree.h"
+#include "treecode.h"
 #include "pda/splitgraph.h"
 #include "alignment/alignment.h"
 
@@ -60,6 +61,13 @@ public:
 
 	void init(StrVector &treels, bool &is_rooted);
 
+	/**
+		initialize from encoded trees, leaves are named by taxon IDs
+		@param codes tree codes, empty codes are skipped
+		@param is_rooted true if tree is rooted
+	*/
+	void init(vector<TreeCode> &codes, bool &is_rooted);
+
 	/**
 	 *  Add trees from \a trees to the tree set
 	 *
@@ -24,9 +24,85 @@
 //#include <sys/time.h>
 //#include <time.h>
 #include <cmath>
+#include <string.h>
 
 //#define INFINITY 1000000000
 
+/*********************************************
+        class NodeArena
+ *********************************************/
+
+/** objects are rounded up to multiples of this size */
+const size_t NODE_ARENA_GRANULE = 16;
+
+/** number of size classes, larger objects bypass the free lists */
+const size_t NODE_ARENA_CLASSES = 32;
+
+/** maximal memory kept in the free lists of a thread */
+const size_t NODE_ARENA_MAX_MEM = 64 << 20;
+
+/**
+    TRUE once the free lists of this thread are destroyed. Kept outside of NodeArenaFreeLists:
+    being trivially destructible, it can still be read by nodes freed during thread or static teardown
+*/
+static thread_local bool node_arena_closed = false;
+
+struct NodeArenaFreeLists {
+    void *head[NODE_ARENA_CLASSES];
+    size_t mem;
+
+    NodeArenaFreeLists() {
+        memset(head, 0, sizeof(head));
+        mem = 0;
+    }
+
+    ~NodeArenaFreeLists() {
+        for (size_t cls = 0; cls < NODE_ARENA_CLASSES; cls++)
+            while (head[cls]) {
+                void *next = *(void**)head[cls];
+                ::operator delete(head[cls]);
+                head[cls] = next;
+            }
+        mem = 0;
+        // nodes allocated or freed during exit after this thread's lists are gone use the heap
+        node_arena_closed = true;
+    }
+};
+
+static thread_local NodeArenaFreeLists node_arena;
+
+void *NodeArena::allocate(size_t size) {
+    size_t cls = (size + NODE_ARENA_GRANULE - 1) / NODE_ARENA_GRANULE;
+    if (cls >= NODE_ARENA_CLASSES || node_arena_closed)
+        return ::operator new(size);
+    NodeArenaFreeLists &lists = node_arena;
+    void *ptr = lists.head[cls];
+    if (ptr) {
+        lists.head[cls] = *(void**)ptr;
+        lists.mem -= cls * NODE_ARENA_GRANULE;
+        return ptr;
+    }
+    return ::operator new(cls * NODE_ARENA_GRANULE);
+}
+
+void NodeArena::release(void *ptr, size_t size) {
+    if (!ptr)
+        return;
+    size_t cls = (size + NODE_ARENA_GRANULE - 1) / NODE_ARENA_GRANULE;
+    if (cls >= NODE_ARENA_CLASSES || node_arena_closed) {
+        ::operator delete(ptr);
+        return;
+    }
+    NodeArenaFreeLists &lists = node_arena;
+    if (lists.mem + cls * NODE_ARENA_GRANULE > NODE_ARENA_MAX_MEM) {
+        ::operator delete(ptr);
+        return;
+    }
+    *(void**)ptr = lists.head[cls];
+    lists.head[cls] = ptr;
+    lists.mem += cls * NODE_ARENA_GRANULE;
+}
+
 /*********************************************
         class Node
  *********************************************/
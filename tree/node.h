@@ -44,6 +44,27 @@ using namespace std;
 
 class Node;
 
+/**
+    Allocator of Node and Neighbor objects. Freed objects are kept in free lists per object size
+    and thread and handed out again, such that re-reading a tree of the same shape reuses the
+    memory of the tree just freed instead of going through the general-purpose allocator
+ */
+class NodeArena {
+public:
+    /**
+        @param size object size in bytes
+        @return memory for an object
+     */
+    static void *allocate(size_t size);
+
+    /**
+        put the memory of an object back into the free list of its size
+        @param ptr memory returned by allocate()
+        @param size object size in bytes
+     */
+    static void release(void *ptr, size_t size);
+};
+
 /**
     Neighbor list of a node in the tree
  */
@@ -51,6 +72,14 @@ class Neighbor {
 
 public:
 
+    static void *operator new(size_t size) {
+        return NodeArena::allocate(size);
+    }
+
+    static void operator delete(void *ptr, size_t size) {
+        NodeArena::release(ptr, size);
+    }
+
     /**
         the other end of the branch
      */
@@ -205,6 +234,15 @@ A Node in the tree
  */
 class Node {
 public:
+
+    static void *operator new(size_t size) {
+        return NodeArena::allocate(size);
+    }
+
+    static void operator delete(void *ptr, size_t size) {
+        NodeArena::release(ptr, size);
+    }
+
     /**
         node id.
      */
@@ -0,0 +1,121 @@
+/*
+ * partiallhcache.cpp
+ *
+ *  Process-wide cache of partial likelihood vectors of subtrees
+ */
+
+#include "partiallhcache.h"
+#include <string.h>
+
+/** bookkeeping memory per entry on top of the vectors */
+const size_t PARTIAL_LH_CACHE_ENTRY_OVERHEAD = 128;
+
+PartialLhCache &PartialLhCache::getInstance() {
+    static PartialLhCache instance;
+    return instance;
+}
+
+PartialLhCache::PartialLhCache() {
+    mem_limit = 0;
+    mem_used = 0;
+    lookups = hits = evictions = 0;
+#ifdef _OPENMP
+    omp_init_lock(&mutex);
+#endif
+}
+
+PartialLhCache::~PartialLhCache() {
+#ifdef _OPENMP
+    omp_destroy_lock(&mutex);
+#endif
+}
+
+void PartialLhCache::lock() {
+#ifdef _OPENMP
+    omp_set_lock(&mutex);
+#endif
+}
+
+void PartialLhCache::unlock() {
+#ifdef _OPENMP
+    omp_unset_lock(&mutex);
+#endif
+}
+
+size_t PartialLhCache::entryMem(size_t lh_size, size_t scale_size) {
+    return lh_size*sizeof(double) + scale_size*sizeof(UBYTE) + PARTIAL_LH_CACHE_ENTRY_OVERHEAD;
+}
+
+void PartialLhCache::setMemoryLimit(size_t limit) {
+    lock();
+    mem_limit = limit;
+    while (mem_used > mem_limit && !entries.empty()) {
+        Entry &entry = entries.back();
+        mem_used -= entryMem(entry.partial_lh.size(), entry.scale_num.size());
+        index.erase(entry.key);
+        entries.pop_back();
+        evictions++;
+    }
+    unlock();
+}
+
+bool PartialLhCache::find(const PartialLhKey &key, size_t lh_size, size_t scale_size, double *partial_lh, UBYTE *scale_num) {
+    if (!mem_limit)
+        return false;
+    bool found = false;
+    lock();
+    lookups++;
+    auto it = index.find(key);
+    if (it != index.end() && it->second->partial_lh.size() == lh_size && it->second->scale_num.size() == scale_size) {
+        entries.splice(entries.begin(), entries, it->second);
+        Entry &entry = entries.front();
+        memcpy(partial_lh, &entry.partial_lh[0], lh_size*sizeof(double));
+        memcpy(scale_num, &entry.scale_num[0], scale_size*sizeof(UBYTE));
+        hits++;
+        found = true;
+    }
+    unlock();
+    return found;
+}
+
+void PartialLhCache::insert(const PartialLhKey &key, size_t lh_size, size_t scale_size, double *partial_lh, UBYTE *scale_num) {
+    size_t entry_mem = entryMem(lh_size, scale_size);
+    if (entry_mem > mem_limit)
+        return;
+    lock();
+    if (index.find(key) == index.end()) {
+        bool recycled = false;
+        while (mem_used + entry_mem > mem_limit) {
+            Entry &last = entries.back();
+            mem_used -= entryMem(last.partial_lh.size(), last.scale_num.size());
+            index.erase(last.key);
+            evictions++;
+            if (mem_used + entry_mem <= mem_limit && last.partial_lh.size() == lh_size && last.scale_num.size() == scale_size) {
+                // recycle the vectors of the least recently used entry
+                entries.splice(entries.begin(), entries, --entries.end());
+                recycled = true;
+                break;
+            }
+            entries.pop_back();
+        }
+        if (!recycled)
+            entries.push_front(Entry());
+        Entry &entry = entries.front();
+        entry.key = key;
+        entry.partial_lh.assign(partial_lh, partial_lh + lh_size);
+        entry.scale_num.assign(scale_num, scale_num + scale_size);
+        index[key] = entries.begin();
+        mem_used += entry_mem;
+    }
+    unlock();
+}
+
+void PartialLhCache::report(ostream &out) {
+    if (!lookups)
+        return;
+    out << "Partial likelihood cache: " << hits << " hits of " << lookups << " lookups ("
+        << (100*hits)/lookups << "%), " << (mem_used >> 10) << " KB used";
+    if (evictions)
+        out << ", " << evictions << " evicted";
+    out << endl;
+}
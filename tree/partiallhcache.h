@@ -0,0 +1,110 @@
+/*
+ * partiallhcache.h
+ *
+ *  Process-wide cache of partial likelihood vectors of subtrees
+ */
+
+#ifndef PARTIALLHCACHE_H
+#define PARTIALLHCACHE_H
+
+#include <list>
+#include "phylonode.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/**
+    128-bit content hash of a rooted subtree: taxa, topology, branch lengths and model parameters
+*/
+struct PartialLhKey {
+    uint64_t h1, h2;
+
+    bool operator==(const PartialLhKey &other) const {
+        return h1 == other.h1 && h2 == other.h2;
+    }
+};
+
+struct PartialLhKeyHash {
+    size_t operator()(const PartialLhKey &key) const {
+        return (size_t)key.h1;
+    }
+};
+
+/**
+    Cache of partial likelihood vectors shared by all candidate trees of the process.
+    Entries are addressed by the content of the subtree below a branch, such that clades shared
+    between candidate trees with the same branch lengths and model parameters are computed only once.
+    The least recently used entries are evicted once the memory limit is exceeded.
+*/
+class PartialLhCache {
+public:
+
+    /** @return the cache of this process */
+    static PartialLhCache &getInstance();
+
+    /**
+        set the memory limit
+        @param limit memory limit in bytes, 0 to disable the cache
+    */
+    void setMemoryLimit(size_t limit);
+
+    /** @return TRUE if the cache is enabled */
+    bool isEnabled() { return mem_limit > 0; }
+
+    /**
+        look up the partial likelihood vector of a subtree
+        @param key subtree key
+        @param lh_size number of entries of partial_lh
+        @param scale_size number of entries of scale_num
+        @param[out] partial_lh partial likelihoods
+        @param[out] scale_num scaling numbers
+        @return TRUE if found
+    */
+    bool find(const PartialLhKey &key, size_t lh_size, size_t scale_size, double *partial_lh, UBYTE *scale_num);
+
+    /**
+        store the partial likelihood vector of a subtree
+    */
+    void insert(const PartialLhKey &key, size_t lh_size, size_t scale_size, double *partial_lh, UBYTE *scale_num);
+
+    /**
+        print the hit rate
+    */
+    void report(ostream &out);
+
+private:
+
+    PartialLhCache();
+
+    ~PartialLhCache();
+
+    struct Entry {
+        PartialLhKey key;
+        vector<double> partial_lh;
+        vector<UBYTE> scale_num;
+    };
+
+    typedef list<Entry> EntryList;
+
+    /** @return memory occupied by an entry */
+    size_t entryMem(size_t lh_size, size_t scale_size);
+
+    void lock();
+
+    void unlock();
+
+    /** entries from the most to the least recently used */
+    EntryList entries;
+
+    unordered_map<PartialLhKey, EntryList::iterator, PartialLhKeyHash> index;
+
+    size_t mem_limit, mem_used;
+
+    uint64_t lookups, hits, evictions;
+
+#ifdef _OPENMP
+    omp_lock_t mutex;
+#endif
+};
+
+#endif
@@ -1436,6 +1436,18 @@ inline UINT fast_popcount(Vec8ui &x) {
 
 }
 
+#if MAX_VECTOR_SIZE >= 512 && INSTRSET >= 9
+inline UINT fast_popcount(Vec16ui &x) {
+#ifdef __AVX512VPOPCNTDQ__
+    return _mm512_reduce_add_epi64(_mm512_popcnt_epi64(x));
+#else
+    MEM_ALIGN_BEGIN uint64_t vec[8] MEM_ALIGN_END;
+    x.store(vec);
+    return __builtin_popcountll(vec[0]) + __builtin_popcountll(vec[1]) + __builtin_popcountll(vec[2]) + __builtin_popcountll(vec[3]) +
+        __builtin_popcountll(vec[4]) + __builtin_popcountll(vec[5]) + __builtin_popcountll(vec[6]) + __builtin_popcountll(vec[7]);
+#endif
+}
+#endif
 
 inline void horizontal_popcount(Vec4ui &x) {
     MEM_ALIGN_BEGIN UINT vec[4] MEM_ALIGN_END;
@@ -1838,5 +1850,54 @@ int PhyloTree::computeParsimonyBranchFastSIMD(PhyloNeighbor *dad_branch, PhyloNo
     return score;
 }
 
+template<class VectorClass>
+int PhyloTree::computeParsimonyInsertFastSIMD(PhyloNeighbor *leaf_branch, PhyloNeighbor *dad_branch, PhyloNeighbor *node_branch, int lower_bound) {
+    int site;
+    int nstates = aln->getMaxNumStates();
+
+    const int NUM_BITS = VectorClass::size() * UINT_BITS;
+    int nsites = (aln->num_parsimony_sites + NUM_BITS - 1)/NUM_BITS;
+    int entry_size = nstates * VectorClass::size();
+
+    int scoreid = nsites*entry_size;
+    UINT score = leaf_branch->partial_pars[scoreid] + dad_branch->partial_pars[scoreid] + node_branch->partial_pars[scoreid];
+    VectorClass *x = (VectorClass*)dad_branch->partial_pars;
+    VectorClass *y = (VectorClass*)node_branch->partial_pars;
+    VectorClass *l = (VectorClass*)leaf_branch->partial_pars;
+
+    switch (nstates) {
+    case 4:
+        for (site = 0; site < nsites; site++, x += 4, y += 4, l += 4) {
+            // Fitch step at the new internal node, then on the branch to the leaf
+            VectorClass z0 = x[0] & y[0], z1 = x[1] & y[1], z2 = x[2] & y[2], z3 = x[3] & y[3];
+            VectorClass w = ~(z0 | z1 | z2 | z3);
+            z0 |= w & (x[0] | y[0]);
+            z1 |= w & (x[1] | y[1]);
+            z2 |= w & (x[2] | y[2]);
+            z3 |= w & (x[3] | y[3]);
+            VectorClass v = ~((z0 & l[0]) | (z1 & l[1]) | (z2 & l[2]) | (z3 & l[3]));
+            score += fast_popcount(w) + fast_popcount(v);
+            if (score >= (UINT)lower_bound)
+                break;
+        }
+        break;
+    default:
+        for (site = 0; site < nsites; site++, x += nstates, y += nstates, l += nstates) {
+            int i;
+            VectorClass w = 0, v = 0;
+            for (i = 0; i < nstates; i++)
+                w |= x[i] & y[i];
+            w = ~w;
+            for (i = 0; i < nstates; i++)
+                v |= ((x[i] & y[i]) | (w & (x[i] | y[i]))) & l[i];
+            v = ~v;
+            score += fast_popcount(w) + fast_popcount(v);
+            if (score >= (UINT)lower_bound)
+                break;
+        }
+        break;
+    }
+    return score;
+}
 
 #endif /* PHYLOKERNEL_H_ */
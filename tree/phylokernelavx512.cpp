@@ -27,6 +27,12 @@
 #error "You must compile this file with AVX512 enabled!"
 #endif
 
+void PhyloTree::setParsimonyKernelAVX512() {
+    computeParsimonyBranchPointer = &PhyloTree::computeParsimonyBranchFastSIMD<Vec16ui>;
+    computePartialParsimonyPointer = &PhyloTree::computePartialParsimonyFastSIMD<Vec16ui>;
+    computeParsimonyInsertPointer = &PhyloTree::computeParsimonyInsertFastSIMD<Vec16ui>;
+}
+
 void PhyloTree::setDotProductAVX512() {
 #ifdef BOOT_VAL_FLOAT
 		dotProduct = &PhyloTree::dotProductSIMD<float, Vec16f>;
@@ -39,7 +45,7 @@ void PhyloTree::setDotProductAVX512() {
 void PhyloTree::setLikelihoodKernelAVX512() {
     vector_size = 8;
     bool site_model = model_factory && model_factory->model->isSiteSpecificModel();
-//    setParsimonyKernelAVX();
+    setParsimonyKernelAVX512();
     computeLikelihoodDervMixlenPointer = NULL;
 
     if (site_model && safe_numeric) {
@@ -1102,6 +1102,42 @@ inline void computeBounds(int threads, size_t elements, vector<size_t> &limits)
             outError("Too many threads may slow down analysis [-nt option]. Reduce threads or use -nt AUTO to automatically determine it");
     }
 }
+
+/** number of pattern tiles per thread for dynamic scheduling of likelihood kernels */
+#define PATTERN_TILES_PER_THREAD 8
+
+/**
+    split patterns into tiles which are scheduled dynamically over threads:
+    a thread that finishes its tile early picks up the next one instead of idling
+    at the barrier. Each tile runs the whole post-order traversal before the next tile.
+    Tiles are further bounded such that the partial_lh of one node and its two children
+    fit into Params::lh_tile_cache KB, so a child vector is still in cache when its dad is computed.
+    @param threads number of threads
+    @param elements number of patterns
+    @param block number of doubles per pattern in a partial_lh vector (nstates * ncat_mix)
+    @param[out] limits tile boundaries, each a multiple of VectorClass::size()
+*/
+template<class VectorClass>
+inline void computeTileBounds(int threads, size_t elements, size_t block, vector<size_t> &limits) {
+    elements = ((elements+VectorClass::size()-1)/VectorClass::size())*VectorClass::size();
+    size_t num_vec = elements/VectorClass::size();
+    // single thread without tiling: one tile, identical to the static split
+    size_t num_tiles = (threads > 1) ? (size_t)threads*PATTERN_TILES_PER_THREAD : 1;
+    size_t cache_size = (size_t)Params::getInstance().lh_tile_cache * 1024;
+    if (cache_size > 0) {
+        size_t max_tile_vec = cache_size / (3 * block * sizeof(double) * VectorClass::size());
+        if (max_tile_vec < 1)
+            max_tile_vec = 1;
+        num_tiles = max(num_tiles, (num_vec+max_tile_vec-1)/max_tile_vec);
+    }
+    if (num_tiles > num_vec)
+        num_tiles = max(num_vec, (size_t)1);
+    limits.reserve(num_tiles+1);
+    limits.push_back(0);
+    for (size_t tile = 1; tile < num_tiles; tile++)
+        limits.push_back((num_vec*tile/num_tiles)*VectorClass::size());
+    limits.push_back(elements);
+}
 #endif
 
 #ifdef KERNEL_FIX_STATES
@@ -1209,6 +1245,8 @@ void PhyloTree::computeTraversalInfo(PhyloNode *node, PhyloNode *dad, bool compu
             VectorClass *buffer_tmp = (VectorClass*)buffer;
 #endif
             for (int i = 0; i < num_info; i++) {
+                if (traversal_info[i].lh32_restore >= 0)
+                    continue;
             #ifdef KERNEL_FIX_STATES
                 computePartialInfo<VectorClass, nstates>(traversal_info[i], buffer_tmp);
             #else
@@ -1224,14 +1262,20 @@ void PhyloTree::computeTraversalInfo(PhyloNode *node, PhyloNode *dad, bool compu
         vector<size_t> limits;
         size_t orig_nptn = ((aln->size()+VectorClass::size()-1)/VectorClass::size())*VectorClass::size();
         size_t nptn = ((orig_nptn+model_factory->unobserved_ptns.size()+VectorClass::size()-1)/VectorClass::size())*VectorClass::size();
-        computeBounds<VectorClass>(num_threads, nptn, limits);
+        computeTileBounds<VectorClass>(num_threads, nptn, block, limits);
+        int num_tiles = limits.size()-1;
 
         #ifdef _OPENMP
-        #pragma omp parallel for schedule(static, 1) num_threads(num_threads)
+        #pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
         #endif
-        for (int thread_id = 0; thread_id < num_threads; thread_id++) {
+        for (int tile = 0; tile < num_tiles; tile++) {
+#ifdef _OPENMP
+            int thread_id = omp_get_thread_num();
+#else
+            int thread_id = 0;
+#endif
             for (vector<TraversalInfo>::iterator it = traversal_info.begin(); it != traversal_info.end(); it++)
-                computePartialLikelihood(*it, limits[thread_id], limits[thread_id+1], thread_id);
+                computePartialLikelihood(*it, limits[tile], limits[tile+1], thread_id);
         }
         traversal_info.clear();
     }
@@ -2191,7 +2235,8 @@ void PhyloTree::computeLikelihoodDervGenericSIMD(PhyloNeighbor *dad_branch, Phyl
 
     double *buffer_partial_lh_ptr = buffer_partial_lh;
     vector<size_t> limits;
-    computeBounds<VectorClass>(num_threads, nptn, limits);
+    computeTileBounds<VectorClass>(num_threads, nptn, block, limits);
+    int num_tiles = limits.size()-1;
 
 	ASSERT(theta_all);
 
@@ -2276,12 +2321,17 @@ void PhyloTree::computeLikelihoodDervGenericSIMD(PhyloNeighbor *dad_branch, Phyl
 //    double tree_lh = node_branch->lh_scale_factor + dad_branch->lh_scale_factor;
 
 #ifdef _OPENMP
-#pragma omp parallel for schedule(static, 1) private(ptn, i, c) num_threads(num_threads)
+#pragma omp parallel for schedule(dynamic, 1) private(ptn, i, c) num_threads(num_threads)
+#endif
+    for (int tile = 0; tile < num_tiles; tile++) {
+#ifdef _OPENMP
+        int thread_id = omp_get_thread_num();
+#else
+        int thread_id = 0;
 #endif
-    for (int thread_id = 0; thread_id < num_threads; thread_id++) {
         VectorClass my_df(0.0), my_ddf(0.0), vc_prob_const(0.0), vc_df_const(0.0), vc_ddf_const(0.0);
-        size_t ptn_lower = limits[thread_id];
-        size_t ptn_upper = limits[thread_id+1];
+        size_t ptn_lower = limits[tile];
+        size_t ptn_upper = limits[tile+1];
 
         if (!theta_computed)
         #ifdef KERNEL_FIX_STATES
@@ -2618,7 +2668,8 @@ double PhyloTree::computeLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_branch,
     VectorClass all_prob_const(0.0);
 
     vector<size_t> limits;
-    computeBounds<VectorClass>(num_threads, nptn, limits);
+    computeTileBounds<VectorClass>(num_threads, nptn, block, limits);
+    int num_tiles = limits.size()-1;
 
     if (dad->isLeaf()) {
     	// special treatment for TIP-INTERNAL NODE case
@@ -2670,14 +2721,19 @@ double PhyloTree::computeLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_branch,
 
     	// now do the real computation
 #ifdef _OPENMP
-#pragma omp parallel for private(ptn, i, c) schedule(static, 1) num_threads(num_threads)
+#pragma omp parallel for private(ptn, i, c) schedule(dynamic, 1) num_threads(num_threads)
+#endif
+        for (int tile = 0; tile < num_tiles; tile++) {
+#ifdef _OPENMP
+            int thread_id = omp_get_thread_num();
+#else
+            int thread_id = 0;
 #endif
-        for (int thread_id = 0; thread_id < num_threads; thread_id++) {
 
             VectorClass vc_tree_lh(0.0), vc_prob_const(0.0);
 
-            size_t ptn_lower = limits[thread_id];
-            size_t ptn_upper = limits[thread_id+1];
+            size_t ptn_lower = limits[tile];
+            size_t ptn_upper = limits[tile+1];
 
             // reset memory for _pattern_lh_cat
             memset(_pattern_lh_cat + ptn_lower*ncat_mix, 0, sizeof(double)*(ptn_upper-ptn_lower)*ncat_mix);
@@ -2820,12 +2876,17 @@ double PhyloTree::computeLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_branch,
     	//-------- both dad and node are internal nodes -----------/
 
 #ifdef _OPENMP
-#pragma omp parallel for private(ptn, i, c) schedule(static, 1) num_threads(num_threads)
+#pragma omp parallel for private(ptn, i, c) schedule(dynamic, 1) num_threads(num_threads)
+#endif
+        for (int tile = 0; tile < num_tiles; tile++) {
+#ifdef _OPENMP
+            int thread_id = omp_get_thread_num();
+#else
+            int thread_id = 0;
 #endif
-        for (int thread_id = 0; thread_id < num_threads; thread_id++) {
 
-            size_t ptn_lower = limits[thread_id];
-            size_t ptn_upper = limits[thread_id+1];
+            size_t ptn_lower = limits[tile];
+            size_t ptn_upper = limits[tile+1];
 
             VectorClass vc_tree_lh(0.0), vc_prob_const(0.0);
 
@@ -3261,7 +3322,8 @@ void PhyloTree::computeLikelihoodDervMixlenGenericSIMD(PhyloNeighbor *dad_branch
 
     double *buffer_partial_lh_ptr = buffer_partial_lh;
     vector<size_t> limits;
-    computeBounds<VectorClass>(num_threads, nptn, limits);
+    computeTileBounds<VectorClass>(num_threads, nptn, block, limits);
+    int num_tiles = limits.size()-1;
 
 	ASSERT(theta_all);
 
@@ -3311,12 +3373,17 @@ void PhyloTree::computeLikelihoodDervMixlenGenericSIMD(PhyloNeighbor *dad_branch
 //    double tree_lh = node_branch->lh_scale_factor + dad_branch->lh_scale_factor;
 
 #ifdef _OPENMP
-#pragma omp parallel for schedule(static, 1) private(ptn, i, c) num_threads(num_threads)
+#pragma omp parallel for schedule(dynamic, 1) private(ptn, i, c) num_threads(num_threads)
+#endif
+    for (int tile = 0; tile < num_tiles; tile++) {
+#ifdef _OPENMP
+        int thread_id = omp_get_thread_num();
+#else
+        int thread_id = 0;
 #endif
-    for (int thread_id = 0; thread_id < num_threads; thread_id++) {
         VectorClass my_df(0.0), my_ddf(0.0), vc_prob_const(0.0), vc_df_const(0.0), vc_ddf_const(0.0);
-        size_t ptn_lower = limits[thread_id];
-        size_t ptn_upper = limits[thread_id+1];
+        size_t ptn_lower = limits[tile];
+        size_t ptn_upper = limits[tile+1];
 
         if (!theta_computed)
         #ifdef KERNEL_FIX_STATES
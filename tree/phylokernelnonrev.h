@@ -508,7 +508,8 @@ void PhyloTree::computeNonrevLikelihoodDervGenericSIMD(PhyloNeighbor *dad_branch
     VectorClass all_prob_const(0.0), all_df_const(0.0), all_ddf_const(0.0);
 
     vector<size_t> limits;
-    computeBounds<VectorClass>(num_threads, nptn, limits);
+    computeTileBounds<VectorClass>(num_threads, nptn, block, limits);
+    int num_tiles = limits.size()-1;
 //    double *buffer_partial_lh_ptr = buffer_partial_lh;
 
     if (dad->isLeaf()) {
@@ -553,12 +554,17 @@ void PhyloTree::computeNonrevLikelihoodDervGenericSIMD(PhyloNeighbor *dad_branch
 
     	// now do the real computation
 #ifdef _OPENMP
-#pragma omp parallel for private(ptn, i, c) schedule(static,1) num_threads(num_threads)
+#pragma omp parallel for private(ptn, i, c) schedule(dynamic, 1) num_threads(num_threads)
+#endif
+        for (int tile = 0; tile < num_tiles; tile++) {
+#ifdef _OPENMP
+            int thread_id = omp_get_thread_num();
+#else
+            int thread_id = 0;
 #endif
-        for (int thread_id = 0; thread_id < num_threads; thread_id++) {
             VectorClass my_df(0.0), my_ddf(0.0), vc_prob_const(0.0), vc_df_const(0.0), vc_ddf_const(0.0);
-            size_t ptn_lower = limits[thread_id];
-            size_t ptn_upper = limits[thread_id+1];
+            size_t ptn_lower = limits[tile];
+            size_t ptn_upper = limits[tile+1];
             // first compute partial_lh
             for (vector<TraversalInfo>::iterator it = traversal_info.begin(); it != traversal_info.end(); it++)
                 computePartialLikelihood(*it, ptn_lower, ptn_upper, thread_id);
@@ -655,12 +661,17 @@ void PhyloTree::computeNonrevLikelihoodDervGenericSIMD(PhyloNeighbor *dad_branch
 
     	// both dad and node are internal nodes
 #ifdef _OPENMP
-#pragma omp parallel for private(ptn, i, c) schedule(static,1) num_threads(num_threads)
+#pragma omp parallel for private(ptn, i, c) schedule(dynamic, 1) num_threads(num_threads)
+#endif
+        for (int tile = 0; tile < num_tiles; tile++) {
+#ifdef _OPENMP
+            int thread_id = omp_get_thread_num();
+#else
+            int thread_id = 0;
 #endif
-        for (int thread_id = 0; thread_id < num_threads; thread_id++) {
             VectorClass my_df(0.0), my_ddf(0.0), vc_prob_const(0.0), vc_df_const(0.0), vc_ddf_const(0.0);
-            size_t ptn_lower = limits[thread_id];
-            size_t ptn_upper = limits[thread_id+1];
+            size_t ptn_lower = limits[tile];
+            size_t ptn_upper = limits[tile+1];
             // first compute partial_lh
             for (vector<TraversalInfo>::iterator it = traversal_info.begin(); it != traversal_info.end(); it++)
                 computePartialLikelihood(*it, ptn_lower, ptn_upper, thread_id);
@@ -802,7 +813,8 @@ double PhyloTree::computeNonrevLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_br
     bool isASC = model_factory->unobserved_ptns.size() > 0;
 
     vector<size_t> limits;
-    computeBounds<VectorClass>(num_threads, nptn, limits);
+    computeTileBounds<VectorClass>(num_threads, nptn, block, limits);
+    int num_tiles = limits.size()-1;
 
 //    double *trans_mat = new double[block*nstates];
     double *trans_mat = buffer_partial_lh;
@@ -868,12 +880,17 @@ double PhyloTree::computeNonrevLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_br
 
     	// now do the real computation
 #ifdef _OPENMP
-#pragma omp parallel for private(ptn, i, c) schedule(static,1) num_threads(num_threads)
+#pragma omp parallel for private(ptn, i, c) schedule(dynamic, 1) num_threads(num_threads)
+#endif
+        for (int tile = 0; tile < num_tiles; tile++) {
+#ifdef _OPENMP
+            int thread_id = omp_get_thread_num();
+#else
+            int thread_id = 0;
 #endif
-        for (int thread_id = 0; thread_id < num_threads; thread_id++) {
             VectorClass vc_tree_lh(0.0), vc_prob_const(0.0);
-            size_t ptn_lower = limits[thread_id];
-            size_t ptn_upper = limits[thread_id+1];
+            size_t ptn_lower = limits[tile];
+            size_t ptn_upper = limits[tile+1];
             // first compute partial_lh
             for (vector<TraversalInfo>::iterator it = traversal_info.begin(); it != traversal_info.end(); it++)
                 computePartialLikelihood(*it, ptn_lower, ptn_upper, thread_id);
@@ -979,12 +996,17 @@ double PhyloTree::computeNonrevLikelihoodBranchGenericSIMD(PhyloNeighbor *dad_br
 
     	// both dad and node are internal nodes
 #ifdef _OPENMP
-#pragma omp parallel for private(ptn, i, c) schedule(static,1) num_threads(num_threads)
+#pragma omp parallel for private(ptn, i, c) schedule(dynamic, 1) num_threads(num_threads)
+#endif
+        for (int tile = 0; tile < num_tiles; tile++) {
+#ifdef _OPENMP
+            int thread_id = omp_get_thread_num();
+#else
+            int thread_id = 0;
 #endif
-        for (int thread_id = 0; thread_id < num_threads; thread_id++) {
             VectorClass vc_tree_lh(0.0), vc_prob_const(0.0);
-            size_t ptn_lower = limits[thread_id];
-            size_t ptn_upper = limits[thread_id+1];
+            size_t ptn_lower = limits[tile];
+            size_t ptn_upper = limits[tile+1];
             // first compute partial_lh
             for (vector<TraversalInfo>::iterator it = traversal_info.begin(); it != traversal_info.end(); it++)
                 computePartialLikelihood(*it, ptn_lower, ptn_upper, thread_id);
@@ -28,6 +28,7 @@
 void PhyloTree::setParsimonyKernelSSE() {
 	computeParsimonyBranchPointer = &PhyloTree::computeParsimonyBranchFastSIMD<Vec4ui>;
     computePartialParsimonyPointer = &PhyloTree::computePartialParsimonyFastSIMD<Vec4ui>;
+    computeParsimonyInsertPointer = &PhyloTree::computeParsimonyInsertFastSIMD<Vec4ui>;
 }
 
 void PhyloTree::setDotProductSSE() {
@@ -127,7 +127,8 @@ public:
 private:
 
     /**
-        true if the partial likelihood was computed
+        bit 1: the partial likelihood was computed, bit 2: partial_pars was computed,
+        bit 4: a 32-bit copy of the partial likelihood is kept (-lh32)
      */
     int partial_lh_computed;
 
@@ -232,6 +232,7 @@ void PhyloSuperTree::readTreeString(const string &tree_string) {
 		(*it)->readTree(str, rooted);
         (*it)->assignLeafNames();
 //		(*it)->setAlignment((*it)->aln);
+        (*it)->armPartialLhCache();
 	}
 	linkTrees();
 //	if (isSuperTree()) {
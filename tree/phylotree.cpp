@@ -103,6 +103,7 @@ void PhyloTree::init() {
     setNumThreads(1);
     num_threads = 0;
     max_lh_slots = 0;
+    max_lh32_slots = 0;
     save_all_trees = 0;
     nodeBranchDists = NULL;
     // FOR: upper bounds
@@ -125,6 +126,9 @@ void PhyloTree::init() {
     num_partial_lh_computations = 0;
     vector_size = 0;
     safe_numeric = false;
+    partial_lh_cache_armed = false;
+    partial_lh_cache_active = false;
+    leaf_hashes_aln = NULL;
 }
 
 PhyloTree::PhyloTree(Alignment *aln) : MTree(), CheckpointFactory() {
@@ -348,6 +352,7 @@ void PhyloTree::copyPhyloTreeMixlen(PhyloTree *tree, int mix) {
 
 void PhyloTree::setAlignment(Alignment *alignment) {
     aln = alignment;
+    leaf_hashes_aln = NULL;
     bool err = false;
     int nseq = aln->getNSeq();
     for (int seq = 0; seq < nseq; seq++) {
@@ -425,13 +430,21 @@ void PhyloTree::setRootNode(const char *my_root, bool multi_taxa) {
 //}
 
 void PhyloTree::readTreeString(const string &tree_string) {
-	stringstream str(tree_string);
 	freeNode();
     
     // bug fix 2016-04-14: in case taxon name happens to be ID
-	MTree::readTree(str, rooted);
-    
-    assignLeafNames();
+    // leaves are labelled by taxon IDs and named after the alignment while parsing
+	MTree::readNewick(tree_string.c_str(), tree_string.c_str() + tree_string.length(), rooted, &aln->getSeqNames());
+	finishReadTree();
+}
+
+void PhyloTree::readTreeCode(const TreeCode &code) {
+	freeNode();
+	code.decode(this, &aln->getSeqNames());
+	finishReadTree();
+}
+
+void PhyloTree::finishReadTree() {
 	setRootNode(Params::getInstance().root);
 
 	if (isSuperTree()) {
@@ -445,6 +458,7 @@ void PhyloTree::readTreeString(const string &tree_string) {
         buildNodeSplit();
     }
     current_it = current_it_back = NULL;
+    armPartialLhCache();
 }
 
 void PhyloTree::readTreeStringSeqName(const string &tree_string) {
@@ -469,6 +483,7 @@ void PhyloTree::readTreeStringSeqName(const string &tree_string) {
         buildNodeSplit();
     }
     current_it = current_it_back = NULL;
+    armPartialLhCache();
 }
 
 int PhyloTree::wrapperFixNegativeBranch(bool force_change) {
@@ -713,13 +728,14 @@ void PhyloTree::initializeAllPartialPars(int &index, PhyloNode *node, PhyloNode
     FOR_NEIGHBOR_IT(node, dad, it)initializeAllPartialPars(index, (PhyloNode*) (*it)->node, node);
 }
 
-#define SIMD_BITS 256
+// up to 512-bit vectors of the AVX-512 parsimony kernel
+#define SIMD_BITS 512
 
 size_t PhyloTree::getBitsBlockSize() {
     // reserve the last entry for parsimony score
 //    return (aln->num_states * aln->size() + UINT_BITS - 1) / UINT_BITS + 1;
     size_t len = aln->getMaxNumStates() * ((max(aln->size(), (size_t)aln->num_variant_sites) + SIMD_BITS - 1) / UINT_BITS) + 4;
-    len = ((len+7)/8)*8;
+    len = ((len+15)/16)*16;
     return len;
 }
 
@@ -807,7 +823,7 @@ void PhyloTree::initializeAllPartialLh() {
         ptn_invar = aligned_alloc<double>(mem_size);
     initializeAllPartialLh(index, indexlh);
     if (params->lh_mem_save == LM_MEM_SAVE)
-        mem_slots.init(this, max_lh_slots);
+        mem_slots.init(this, max_lh_slots, max_lh32_slots);
         
     ASSERT(index == (nodeNum - 1) * 2);
     if (params->lh_mem_save == LM_PER_NODE) {
@@ -888,17 +904,19 @@ uint64_t PhyloTree::getMemoryRequired(size_t ncategory, bool full_mem) {
     else
         mem_size = aln->num_states * (aln->STATE_UNKNOWN+1) * sizeof(double);
 
-    // memory for UFBoot
+    // memory for UFBoot, pattern counts mostly fit into one byte
     if (params->gbo_replicates)
-        mem_size += params->gbo_replicates*nptn*sizeof(BootValType);
+        mem_size += params->gbo_replicates*nptn;
 
     // memory for model
     if (model)
     	mem_size += model->getMemoryRequired();
 
     int64_t lh_scale_size = block_size * sizeof(double) + scale_block_size * sizeof(UBYTE);
+    int64_t lh32_scale_size = block_size * sizeof(uint32_t) + scale_block_size * sizeof(UBYTE);
 
     max_lh_slots = leafNum-2;
+    max_lh32_slots = 0;
 
     if (!full_mem && params->lh_mem_save == LM_MEM_SAVE) {
         int64_t min_lh_slots = log2(leafNum)+LH_MIN_CONST;
@@ -908,6 +926,8 @@ uint64_t PhyloTree::getMemoryRequired(size_t ncategory, bool full_mem) {
             max_lh_slots = floor(params->max_mem_size*(leafNum-2));
         } else {
             int64_t rest_mem = params->max_mem_size - mem_size;
+            if (params->lh32)
+                rest_mem -= (leafNum-2) * lh32_scale_size;
             
             // include 2 blocks for nni_partial_lh
             max_lh_slots = rest_mem / lh_scale_size - 2;
@@ -920,6 +940,10 @@ uint64_t PhyloTree::getMemoryRequired(size_t ncategory, bool full_mem) {
             cout << "WARNING: Too low -mem, automatically increased to " << (mem_size + (min_lh_slots+2)*lh_scale_size)/1048576.0 << " MB" << endl;
             max_lh_slots = min_lh_slots;
         }
+        if (params->lh32 && max_lh_slots < leafNum-2) {
+            max_lh32_slots = leafNum-2;
+            mem_size += max_lh32_slots * lh32_scale_size;
+        }
     }
 
     // also count MEM for nni_partial_lh
@@ -953,6 +977,22 @@ void PhyloTree::getMemoryRequired(uint64_t &partial_lh_entries, uint64_t &scale_
     partial_pars_entries = (leafNum - 1) * 4 * pars_block_size;
 }
 
+void PhyloTree::printMemSlotStats(ostream &out) {
+    if (params->lh_mem_save != LM_MEM_SAVE)
+        return;
+    mem_slots.printStats(out);
+}
+
+void PhyloTree::resetMemSlotStats() {
+    mem_slots.resetStats();
+}
+
+void PhyloTree::freeLh32Slots() {
+    max_lh32_slots = 0;
+    mem_slots.freeLh32();
+    clearAllPartialLH();
+}
+
 void PhyloTree::initializeAllPartialLh(int &index, int &indexlh, PhyloNode *node, PhyloNode *dad) {
     uint64_t pars_block_size = getBitsBlockSize();
     // +num_states for ascertainment bias correction
@@ -1198,6 +1238,9 @@ int PhyloTree::getNumLhCat(SiteLoglType wsl) {
         return getRate()->getNDiscreteRate();
     case WSL_MIXTURE:
         return getModel()->getNMixtures();
+    default:
+        ASSERT(0 && "Unhandled SiteLoglType");
+        return 0;
     }
 }
 
@@ -4316,32 +4359,53 @@ void PhyloTree::computeNNIPatternLh(double cur_lh, double &lh2, double *pattern_
 	NNIMove nniMoves[2];
 	nniMoves[0].ptnlh = pattern_lh2;
 	nniMoves[1].ptnlh = pattern_lh3;
-	bool nni5 = params->nni5;
-	params->nni5 = true; // always optimize 5 branches for accurate SH-aLRT
 	nniMoves[0].node1 = nniMoves[1].node1 = NULL;
 	nniMoves[0].node2 = nniMoves[1].node2 = NULL;
 	getBestNNIForBran(node1, node2, nniMoves);
-	params->nni5 = nni5;
 	lh2 = nniMoves[0].newloglh;
 	lh3 = nniMoves[1].newloglh;
-	if (max(lh2,lh3) > cur_lh + TOL_LIKELIHOOD)
-		cout << "Alternative NNI shows better log-likelihood " << max(lh2,lh3) << " > " << cur_lh << endl;
 }
 
 void PhyloTree::resampleLh(double **pat_lh, double *lh_new, int *rstream) {
     //int nsite = getAlnNSite();
+    int *boot_freq = aligned_alloc<int>(getAlnNPattern());
+    aln->createBootstrapAlignment(boot_freq, params->bootstrap_spec, rstream);
+    computeRELL(pat_lh, lh_new, boot_freq);
+    aligned_free(boot_freq);
+}
+
+void PhyloTree::computeRELL(double **pat_lh, double *lh_new, int *boot_freq) {
     int nptn = getAlnNPattern();
     memset(lh_new, 0, sizeof(double) * 3);
     int i;
-    int *boot_freq = aligned_alloc<int>(getAlnNPattern());
-    aln->createBootstrapAlignment(boot_freq, params->bootstrap_spec, rstream);
     for (i = 0; i < nptn; i++) {
 
         lh_new[0] += boot_freq[i] * pat_lh[0][i];
         lh_new[1] += boot_freq[i] * pat_lh[1][i];
         lh_new[2] += boot_freq[i] * pat_lh[2][i];
     }
-    aligned_free(boot_freq);
+}
+
+void PhyloTree::generateRELLReplicates(int times, IntVector &ptn_freq) {
+    ptn_freq.clear();
+#ifdef _OPENMP
+    size_t nptn = getAlnNPattern();
+    if (times <= 0)
+        return;
+    // above a tenth of the RAM every branch draws its own replicates again
+    if (times * nptn * sizeof(int) > getMemorySize() / 10) {
+        cout << "NOTE: RELL replicates need " << (times * nptn * sizeof(int)) / 1048576 << " MB, more than 1/10 of the RAM, "
+            << "branches are tested one after another with their own replicates" << endl;
+        return;
+    }
+    ptn_freq.resize(times * nptn);
+    // one random stream, so that the supports do not depend on the number of threads
+    int *rstream;
+    init_random(params->ran_seed, false, &rstream);
+    for (int i = 0; i < times; i++)
+        aln->createBootstrapAlignment(&ptn_freq[i * nptn], params->bootstrap_spec, rstream);
+    finish_random(rstream);
+#endif
 }
 
 /*********************************************************/
@@ -4518,7 +4582,8 @@ double Statistics_To_Probabilities(double in)
 // Implementation of testBranch follows Guindon et al. (2010)
 
 double PhyloTree::testOneBranch(double best_score, double *pattern_lh, int reps, int lbp_reps,
-        PhyloNode *node1, PhyloNode *node2, double &lbp_support, double &aLRT_support, double &aBayes_support) {
+        PhyloNode *node1, PhyloNode *node2, double &lbp_support, double &aLRT_support, double &aBayes_support,
+        int *rell_ptn_freq, double *nni_lh) {
     const int NUM_NNI = 3;
     double lh[NUM_NNI];
     double *pat_lh[NUM_NNI];
@@ -4531,6 +4596,8 @@ double PhyloTree::testOneBranch(double best_score, double *pattern_lh, int reps,
     save_all_trees = 0;
     computeNNIPatternLh(best_score, lh[1], pat_lh[1], lh[2], pat_lh[2], node1, node2);
     save_all_trees = tmp;
+    if (nni_lh)
+        *nni_lh = max(lh[1], lh[2]);
     double aLRT;
     if (lh[1] > lh[2])
         aLRT = (lh[0] - lh[1]);
@@ -4556,19 +4623,23 @@ double PhyloTree::testOneBranch(double best_score, double *pattern_lh, int reps,
         outWarning("Branch where both NNIs violate constraint tree will show 100% SH-aLRT support");
     } else
 #ifdef _OPENMP
-#pragma omp parallel
+#pragma omp parallel if (!omp_in_parallel())
     {
-        int *rstream;
-        init_random(params->ran_seed + omp_get_thread_num(), false, &rstream);
+        int *rstream = NULL;
+        if (!rell_ptn_freq)
+            init_random(params->ran_seed + omp_get_thread_num(), false, &rstream);
 #pragma omp for reduction(+: lbp_support_int, SH_aLRT_support)
 #endif
     for (int i = 0; i < times; i++) {
         double lh_new[NUM_NNI];
         // resampling estimated log-likelihood (RELL)
+        if (rell_ptn_freq)
+            computeRELL(pat_lh, lh_new, rell_ptn_freq + (size_t)i * nptn);
+        else
 #ifdef _OPENMP
-        resampleLh(pat_lh, lh_new, rstream);
+            resampleLh(pat_lh, lh_new, rstream);
 #else
-        resampleLh(pat_lh, lh_new, randstream);
+            resampleLh(pat_lh, lh_new, randstream);
 #endif
         if (lh_new[0] > lh_new[1] && lh_new[0] > lh_new[2])
             lbp_support_int++;
@@ -4599,7 +4670,8 @@ double PhyloTree::testOneBranch(double best_score, double *pattern_lh, int reps,
             SH_aLRT_support++;
     }
 #ifdef _OPENMP
-    finish_random(rstream);
+    if (rstream)
+        finish_random(rstream);
     }
 #endif
     delete[] pat_lh[2];
@@ -4615,6 +4687,26 @@ double PhyloTree::testOneBranch(double best_score, double *pattern_lh, int reps,
         return 0.0;
 }
 
+/** collect the internal branches below node, each given by its lower node and the node above */
+static void getInternalBranchesBelow(Node *node, Node *dad, NodeVector &nodes, NodeVector &dads) {
+    if (dad && !node->isLeaf() && !dad->isLeaf()) {
+        nodes.push_back(node);
+        dads.push_back(dad);
+    }
+    FOR_NEIGHBOR_IT(node, dad, it)
+        getInternalBranchesBelow((*it)->node, node, nodes, dads);
+}
+
+void PhyloTree::testBranches(NodeVector &nodes1, NodeVector &nodes2, double best_score, double *pattern_lh,
+        int reps, int lbp_reps, int *rell_ptn_freq, vector<BranchSupport> &supports) {
+    supports.resize(nodes1.size());
+    for (int i = 0; i < nodes1.size(); i++) {
+        BranchSupport &sup = supports[i];
+        sup.sh_alrt = testOneBranch(best_score, pattern_lh, reps, lbp_reps, (PhyloNode*)nodes1[i], (PhyloNode*)nodes2[i],
+            sup.lbp, sup.alrt, sup.abayes, rell_ptn_freq, &sup.nni_lh);
+    }
+}
+
 int PhyloTree::testAllBranches(int threshold, double best_score, double *pattern_lh, int reps, int lbp_reps, bool aLRT_test, bool aBayes_test,
         PhyloNode *node, PhyloNode *dad) {
     int num_low_support = 0;
@@ -4631,10 +4723,25 @@ int PhyloTree::testAllBranches(int threshold, double best_score, double *pattern
 			save_all_trees = tmp;
         }
     }
-    if (dad && !node->isLeaf() && !dad->isLeaf()) {
-        double lbp_support, aLRT_support, aBayes_support;
-        double SH_aLRT_support = (testOneBranch(best_score, pattern_lh, reps, lbp_reps,
-            node, dad, lbp_support, aLRT_support, aBayes_support) * 100);
+    NodeVector nodes, dads;
+    getInternalBranchesBelow(node, dad, nodes, dads);
+
+    // all branches are tested on the same RELL replicates
+    IntVector rell_ptn_freq;
+    generateRELLReplicates(max(reps, lbp_reps), rell_ptn_freq);
+    vector<BranchSupport> supports;
+    bool nni5 = params->nni5;
+    params->nni5 = true; // always optimize 5 branches for accurate SH-aLRT
+    testBranches(nodes, dads, best_score, pattern_lh, reps, lbp_reps,
+        rell_ptn_freq.empty() ? NULL : &rell_ptn_freq[0], supports);
+    params->nni5 = nni5;
+
+    for (int i = 0; i < nodes.size(); i++) {
+        node = (PhyloNode*)nodes[i];
+        dad = (PhyloNode*)dads[i];
+        if (supports[i].nni_lh > best_score + TOL_LIKELIHOOD)
+            cout << "Alternative NNI shows better log-likelihood " << supports[i].nni_lh << " > " << best_score << endl;
+        double SH_aLRT_support = supports[i].sh_alrt * 100;
         ostringstream ss;
         ss.precision(3);
         ss << node->name;
@@ -4643,22 +4750,19 @@ int PhyloTree::testAllBranches(int threshold, double best_score, double *pattern
         if (reps)
             ss << SH_aLRT_support;
         if (lbp_reps)
-            ss << "/" << lbp_support * 100;
+            ss << "/" << supports[i].lbp * 100;
         if (aLRT_test)
-            ss << "/" << aLRT_support;
+            ss << "/" << supports[i].alrt;
         if (aBayes_test)
-            ss << "/" << aBayes_support;
+            ss << "/" << supports[i].abayes;
         node->name = ss.str();
         if (SH_aLRT_support < threshold)
-            num_low_support = 1;
+            num_low_support++;
         if (((PhyloNeighbor*) node->findNeighbor(dad))->partial_pars) {
 			((PhyloNeighbor*) node->findNeighbor(dad))->partial_pars[0] = round(SH_aLRT_support);
 			((PhyloNeighbor*) dad->findNeighbor(node))->partial_pars[0] = round(SH_aLRT_support);
         }
     }
-    FOR_NEIGHBOR_IT(node, dad, it)
-        num_low_support += testAllBranches(threshold, best_score, pattern_lh, reps, lbp_reps, aLRT_test, aBayes_test, (PhyloNode*) (*it)->node, node);
-
     return num_low_support;
 }
 
@@ -5146,9 +5250,18 @@ bool PhyloTree::computeTraversalInfo(PhyloNeighbor *dad_branch, PhyloNode *dad,
     PhyloNode *node = (PhyloNode*)dad_branch->node;
 
     if ((dad_branch->partial_lh_computed & 1) || node->isLeaf()) {
+        if (params->lh_mem_save == LM_MEM_SAVE)
+            mem_slots.touch(dad_branch);
         return mem_slots.lock(dad_branch);
     }
 
+    if (partial_lh_cache_active && lookupPartialLhCache(dad_branch, dad))
+        return mem_slots.lock(dad_branch);
+
+    // -lh32: partial_lh is restored from its 32-bit copy, the subtree is not visited
+    int lh32_restore = mem_slots.findLh32(dad_branch);
+    if (lh32_restore >= 0)
+        mem_slots.num_lh32_restores++;
 
     size_t num_leaves = 0;
     bool locked[node->degree()];
@@ -5167,7 +5280,7 @@ bool PhyloTree::computeTraversalInfo(PhyloNeighbor *dad_branch, PhyloNode *dad,
 
 
     // recursive
-    for (it = neivec.begin(); it != neivec.end(); it++)
+    for (it = neivec.begin(); it != neivec.end() && lh32_restore < 0; it++)
         if ((*it)->node != dad) {
             locked[it - neivec.begin()] = computeTraversalInfo((PhyloNeighbor*)(*it), node, buffer);
             if ((*it)->node->isLeaf())
@@ -5178,6 +5291,7 @@ bool PhyloTree::computeTraversalInfo(PhyloNeighbor *dad_branch, PhyloNode *dad,
     // prepare information for this branch
     TraversalInfo info(dad_branch, dad);
     info.echildren = info.partial_lh_leaves = NULL;
+    info.lh32_restore = lh32_restore;
 
     // re-orient partial_lh
     reorientPartialLh(dad_branch, dad);
@@ -5217,6 +5331,7 @@ bool PhyloTree::computeTraversalInfo(PhyloNeighbor *dad_branch, PhyloNode *dad,
         }
     } else
         mem_slots.update(dad_branch);
+    mem_slots.addLh32Save(info);
 
         if (verbose_mode >= VB_MED && params->lh_mem_save == LM_MEM_SAVE) {
             int slot_id = mem_slots.findNei(dad_branch) - mem_slots.begin();
@@ -5232,7 +5347,7 @@ bool PhyloTree::computeTraversalInfo(PhyloNeighbor *dad_branch, PhyloNode *dad,
             }
     }
 
-    if (!model->isSiteSpecificModel()) {
+    if (!model->isSiteSpecificModel() && lh32_restore < 0) {
         //------- normal model -----
         info.echildren = buffer;
         size_t block = nstates * ((model_factory->fused_mix_rate) ? site_rate->getNRate() : site_rate->getNRate()*model->getNMixtures());
@@ -5247,6 +5362,149 @@ bool PhyloTree::computeTraversalInfo(PhyloNeighbor *dad_branch, PhyloNode *dad,
     return mem_slots.lock(dad_branch);
 }
 
+/****************************************************************************
+        reuse of partial likelihoods across candidate trees
+ ****************************************************************************/
+
+/** finalizer of splitmix64 */
+static inline uint64_t mixHash(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/** fold the bit patterns of a vector of doubles into a key */
+static void hashDoubles(PartialLhKey &key, const double *values, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        uint64_t bits;
+        memcpy(&bits, &values[i], sizeof(bits));
+        key.h1 = mixHash(key.h1 ^ bits);
+        key.h2 = mixHash(key.h2 + bits + 0x632be59bd9b4e019ULL);
+    }
+}
+
+void PhyloTree::beginPartialLhCache(PhyloNeighbor *dad_branch, PhyloNode *dad) {
+    partial_lh_cache_armed = false;
+    if (!PartialLhCache::getInstance().isEnabled() || !params || isSuperTree())
+        return;
+    // only the reversible kernel with partial_lh per branch or per node
+    if (params->lh_mem_save == LM_MEM_SAVE || params->kernel_nonrev || !model->isReversible() ||
+        model->isSiteSpecificModel() || !model->getEigenvalues())
+        return;
+
+    if (leaf_hashes_aln != aln || leaf_hashes.size() != aln->getNSeq()) {
+        // leaves are identified by their sequences rather than their IDs
+        size_t nseq = aln->getNSeq();
+        leaf_hashes.resize(nseq);
+        for (size_t seq = 0; seq < nseq; seq++)
+            leaf_hashes[seq].h1 = leaf_hashes[seq].h2 = aln->size();
+        for (Alignment::iterator pit = aln->begin(); pit != aln->end(); pit++)
+            for (size_t seq = 0; seq < nseq; seq++) {
+                uint64_t state = (*pit)[seq];
+                leaf_hashes[seq].h1 = (leaf_hashes[seq].h1 ^ state) * 0x100000001b3ULL;
+                leaf_hashes[seq].h2 = (leaf_hashes[seq].h2 + state) * 0xc6a4a7935bd1e995ULL;
+            }
+        for (size_t seq = 0; seq < nseq; seq++) {
+            leaf_hashes[seq].h1 = mixHash(leaf_hashes[seq].h1);
+            leaf_hashes[seq].h2 = mixHash(leaf_hashes[seq].h2 ^ 0x2545f4914f6cdd1dULL);
+        }
+        leaf_hashes_aln = aln;
+    }
+
+    partial_lh_model_key = computeModelKey();
+    partial_lh_cache_keys.clear();
+    PhyloNode *node = (PhyloNode*)dad_branch->node;
+    computeSubtreeKey(dad_branch, dad);
+    computeSubtreeKey((PhyloNeighbor*)node->findNeighbor(dad), node);
+    partial_lh_cache_active = true;
+}
+
+void PhyloTree::endPartialLhCache() {
+    if (!partial_lh_cache_active)
+        return;
+    PartialLhCache &cache = PartialLhCache::getInstance();
+    size_t lh_size = getPartialLhSize();
+    size_t scale_size = getScaleNumSize();
+    for (auto it = partial_lh_cache_pending.begin(); it != partial_lh_cache_pending.end(); it++)
+        if (((*it)->partial_lh_computed & 1) && (*it)->partial_lh)
+            cache.insert(partial_lh_cache_keys[*it], lh_size, scale_size, (*it)->partial_lh, (*it)->scale_num);
+    partial_lh_cache_pending.clear();
+    partial_lh_cache_keys.clear();
+    partial_lh_cache_active = false;
+}
+
+PartialLhKey PhyloTree::computeSubtreeKey(PhyloNeighbor *dad_branch, PhyloNode *dad) {
+    PhyloNode *node = (PhyloNode*)dad_branch->node;
+    PartialLhKey key;
+    if (node->isLeaf()) {
+        if (node->id < leaf_hashes.size())
+            return leaf_hashes[node->id];
+        // root of a rooted tree
+        key.h1 = mixHash(node->id);
+        key.h2 = mixHash(~(uint64_t)node->id);
+        return key;
+    }
+    // order-independent combination of the children and their branch lengths
+    PartialLhKey sum = {0, 0};
+    int mixlen = getMixlen();
+    FOR_NEIGHBOR_IT(node, dad, it) {
+        PartialLhKey child = computeSubtreeKey((PhyloNeighbor*)(*it), node);
+        uint64_t len = 0;
+        for (int c = 0; c < mixlen; c++) {
+            double length = (*it)->getLength(c);
+            uint64_t bits;
+            memcpy(&bits, &length, sizeof(bits));
+            len = mixHash(len ^ bits);
+        }
+        sum.h1 += mixHash(child.h1 ^ len);
+        sum.h2 += mixHash(child.h2 + len);
+    }
+    key.h1 = mixHash(sum.h1 ^ partial_lh_model_key.h1);
+    key.h2 = mixHash(sum.h2 + partial_lh_model_key.h2);
+    partial_lh_cache_keys[dad_branch] = key;
+    return key;
+}
+
+PartialLhKey PhyloTree::computeModelKey() {
+    PartialLhKey key = {0, 0};
+    size_t nstates = model->num_states;
+    size_t nmix = model->getNMixtures();
+    size_t ncat = site_rate->getNRate();
+    double info[] = {(double)nstates, (double)nmix, (double)ncat, (double)getPartialLhSize(), (double)getScaleNumSize(),
+        (double)model_factory->unobserved_ptns.size(), (double)model_factory->fused_mix_rate, (double)safe_numeric,
+        site_rate->getPInvar()};
+    hashDoubles(key, info, sizeof(info)/sizeof(double));
+    hashDoubles(key, model->getEigenvalues(), nstates*nmix);
+    hashDoubles(key, model->getEigenvectors(), nstates*nstates*nmix);
+    hashDoubles(key, model->getInverseEigenvectors(), nstates*nstates*nmix);
+    for (size_t m = 0; m < nmix; m++) {
+        double weight = model->getMixtureWeight(m);
+        hashDoubles(key, &weight, 1);
+    }
+    for (size_t c = 0; c < ncat; c++) {
+        double rate[] = {site_rate->getRate(c), site_rate->getProp(c)};
+        hashDoubles(key, rate, 2);
+    }
+    return key;
+}
+
+bool PhyloTree::lookupPartialLhCache(PhyloNeighbor *dad_branch, PhyloNode *dad) {
+    auto key = partial_lh_cache_keys.find(dad_branch);
+    if (key == partial_lh_cache_keys.end())
+        return false;
+    reorientPartialLh(dad_branch, dad);
+    if (!dad_branch->partial_lh || !dad_branch->scale_num)
+        return false;
+    if (PartialLhCache::getInstance().find(key->second, getPartialLhSize(), getScaleNumSize(),
+        dad_branch->partial_lh, dad_branch->scale_num)) {
+        dad_branch->partial_lh_computed |= 1;
+        return true;
+    }
+    partial_lh_cache_pending.push_back(dad_branch);
+    return false;
+}
+
 void PhyloTree::writeSiteLh(ostream &out, SiteLoglType wsl, int partid) {
     // error checking
     if (!getModel()->isMixture()) {
@@ -34,6 +34,7 @@
 //#define EIGEN_TUNE_FOR_CPU_CACHE_SIZE (8*512*512)
 //#include <Eigen/Core>
 #include "mtree.h"
+#include "treecode.h"
 #include "alignment/alignment.h"
 #include "model/modelsubst.h"
 #include "model/modelfactory.h"
@@ -45,6 +46,7 @@
 #include "utils/checkpoint.h"
 #include "constrainttree.h"
 #include "memslot.h"
+#include "partiallhcache.h"
 
 #define BOOT_VAL_FLOAT
 #define BootValType float
@@ -246,6 +248,17 @@ struct SwapNNIParam {
     double *nni2_ptnlh;
 };
 
+/**
+ * support values of an internal branch computed by testOneBranch
+ */
+struct BranchSupport {
+    double sh_alrt;
+    double lbp;
+    double alrt;
+    double abayes;
+    double nni_lh; // best log-likelihood of the two alternative NNIs
+};
+
 
 struct LeafFreq {
     int leaf_id;
@@ -326,9 +339,21 @@ public:
     double *echildren;
     double *partial_lh_leaves;
 
+    /** 32-bit slot to keep the evicted content of partial_lh in before computing it, -1 if none */
+    int lh32_save;
+    double *lh32_save_lh;
+    UBYTE *lh32_save_scale;
+
+    /** 32-bit slot to restore partial_lh from instead of computing it, -1 if none */
+    int lh32_restore;
+
     TraversalInfo(PhyloNeighbor *dad_branch, PhyloNode *dad) {
         this->dad = dad;
         this->dad_branch = dad_branch;
+        lh32_save = -1;
+        lh32_save_lh = NULL;
+        lh32_save_scale = NULL;
+        lh32_restore = -1;
     }
 };
 
@@ -648,6 +673,37 @@ public:
     template<class VectorClass>
     int computeParsimonyBranchFastSIMD(PhyloNeighbor *dad_branch, PhyloNode *dad, int *branch_subst = NULL);
 
+    typedef int (PhyloTree::*ComputeParsimonyInsertType)(PhyloNeighbor *, PhyloNeighbor *, PhyloNeighbor *, int);
+    ComputeParsimonyInsertType computeParsimonyInsertPointer;
+
+    /**
+            compute tree parsimony score after inserting a leaf in the middle of a branch, in one pass
+            over the partial parsimony of both directions of the branch, without changing the tree
+            @param leaf_branch the branch from the new internal node to the leaf
+            @param dad_branch the branch leading to one side of the target branch
+            @param node_branch the reverse of dad_branch
+            @param lower_bound the computation stops once the score reaches this bound
+            @return parsimony score of the tree with the leaf inserted, at least lower_bound if stopped
+     */
+    int computeParsimonyInsert(PhyloNeighbor *leaf_branch, PhyloNeighbor *dad_branch, PhyloNeighbor *node_branch, int lower_bound = INT_MAX);
+    int computeParsimonyInsertFast(PhyloNeighbor *leaf_branch, PhyloNeighbor *dad_branch, PhyloNeighbor *node_branch, int lower_bound);
+    template<class VectorClass>
+    int computeParsimonyInsertFastSIMD(PhyloNeighbor *leaf_branch, PhyloNeighbor *dad_branch, PhyloNeighbor *node_branch, int lower_bound);
+
+    /**
+            find the branch where inserting a leaf gives the lowest parsimony score;
+            the branches are scored in parallel
+            @param leaf_branch the branch from the new internal node to the leaf
+            @param nodes1, nodes2 the candidate branches
+            @param[out] best_score parsimony score after inserting the leaf into the best branch
+            @return index of the best branch, the first one in case of ties
+     */
+    int findBestInsertionMPFast(PhyloNeighbor *leaf_branch, NodeVector &nodes1, NodeVector &nodes2, int &best_score);
+
+    /** @return TRUE for trees with a Sankoff parsimony kernel (ParsTree) */
+    virtual bool isParsimonyTree() {
+        return false;
+    }
 
 //    void printParsimonyStates(PhyloNeighbor *dad_branch = NULL, PhyloNode *dad = NULL);
 
@@ -660,6 +716,8 @@ public:
 
     virtual void setParsimonyKernelSSE();
 
+    void setParsimonyKernelAVX512();
+
     /****************************************************************************
             likelihood function
      ****************************************************************************/
@@ -1116,6 +1174,13 @@ public:
      */
     virtual void readTreeString(const string &tree_string);
 
+    /**
+            Read the tree from its compact code, the same as readTreeString()
+            of the Newick string printed with WT_TAXON_ID + WT_SORT_TAXA
+            @param code tree code with taxon IDs of the alignment
+     */
+    void readTreeCode(const TreeCode &code);
+
     /**
             Read the tree saved with Taxon names and branch lengths.
             @param tree_string tree string to read from
@@ -1400,6 +1465,45 @@ public:
 
     vector<TraversalInfo> traversal_info;
 
+    /****************************************************************************
+            reuse of partial likelihoods across candidate trees
+     ****************************************************************************/
+
+    /**
+        look up partial likelihoods of unchanged subtrees in PartialLhCache at the next
+        likelihood evaluation, called after the tree topology was replaced
+    */
+    void armPartialLhCache() { partial_lh_cache_armed = true; }
+
+    /**
+        start looking up partial likelihoods in PartialLhCache for the traversal of a branch
+        @param dad_branch branch of the traversal
+        @param dad its dad node
+    */
+    void beginPartialLhCache(PhyloNeighbor *dad_branch, PhyloNode *dad);
+
+    /**
+        store the partial likelihoods computed by the traversal in PartialLhCache
+    */
+    void endPartialLhCache();
+
+    /**
+        compute the content hashes of the subtrees below all branches directed away from dad
+        @return hash of the subtree below dad_branch
+    */
+    PartialLhKey computeSubtreeKey(PhyloNeighbor *dad_branch, PhyloNode *dad);
+
+    /**
+        @return hash of the model parameters that partial likelihoods depend on
+    */
+    PartialLhKey computeModelKey();
+
+    /**
+        copy the partial likelihoods of dad_branch from PartialLhCache
+        @return TRUE if found, otherwise dad_branch is stored after the traversal
+    */
+    bool lookupPartialLhCache(PhyloNeighbor *dad_branch, PhyloNode *dad);
+
 
     /****************************************************************************
             Nearest Neighbor Interchange by maximum likelihood
@@ -1668,6 +1772,11 @@ public:
             Approximate Likelihood Ratio Test with SH-like interpretation
      ****************************************************************************/
 
+    /**
+            compute the (pattern) log-likelihoods of the two NNIs around branch (node1, node2).
+            The caller switches on params->nni5 for accurate SH-aLRT, once before testing branches
+            concurrently
+     */
     void computeNNIPatternLh(double cur_lh,
             double &lh2, double *pattern_lh2,
             double &lh3, double *pattern_lh3,
@@ -1678,13 +1787,38 @@ public:
      */
     void resampleLh(double **pat_lh, double *lh_new, int *rstream);
 
+    /**
+            RELL log-likelihoods of the three topologies for the pattern frequencies of one replicate
+     */
+    void computeRELL(double **pat_lh, double *lh_new, int *boot_freq);
+
+    /**
+            draw the pattern frequencies of the RELL replicates once for all branches,
+            from one random stream seeded by ran_seed whatever the number of threads
+            @param times number of replicates
+            @param[out] ptn_freq times x nptn pattern frequencies, empty if they take too much memory
+                   or without OpenMP, where every branch draws its own replicates from randstream
+     */
+    void generateRELLReplicates(int times, IntVector &ptn_freq);
+
     /**
             Test one branch of the tree with aLRT SH-like interpretation
+            @param rell_ptn_freq pattern frequencies of the RELL replicates shared by all branches,
+                   NULL to resample them for this branch
+            @param[out] nni_lh best log-likelihood of the two alternative NNIs, if not NULL
      */
     double testOneBranch(double best_score, double *pattern_lh, 
             int reps, int lbp_reps,
             PhyloNode *node1, PhyloNode *node2, 
-            double &lbp_support, double &aLRT_support, double &aBayes_support);
+            double &lbp_support, double &aLRT_support, double &aBayes_support,
+            int *rell_ptn_freq = NULL, double *nni_lh = NULL);
+
+    /**
+            compute the supports of the internal branches (nodes1[i], nodes2[i]) one after another
+            @param[out] supports support values of the branches
+     */
+    virtual void testBranches(NodeVector &nodes1, NodeVector &nodes2, double best_score, double *pattern_lh,
+            int reps, int lbp_reps, int *rell_ptn_freq, vector<BranchSupport> &supports);
 
     /**
             Test all branches of the tree with aLRT SH-like interpretation
@@ -1890,6 +2024,23 @@ public:
 
     void getMemoryRequired(uint64_t &partial_lh_entries, uint64_t &scale_num_entries, uint64_t &partial_pars_entries);
 
+    /**
+     * print hit/miss/recompute statistics of the memory saving mode (-mem option)
+     * @param out output stream
+     */
+    void printMemSlotStats(ostream &out);
+
+    /**
+     * zero the statistics of the memory saving mode, called once at the start of an analysis
+     */
+    void resetMemSlotStats();
+
+    /**
+        stop keeping 32-bit copies of evicted partial_lh (-lh32) and clear all partial_lh,
+        so that the following computations only use partial likelihoods in double precision
+    */
+    void freeLh32Slots();
+
     /****** following variables are for ultra-fast bootstrap *******/
     /** 2 to save all trees, 1 to save intermediate trees */
     int save_all_trees;
@@ -2107,9 +2258,33 @@ protected:
     /** maximum number of partial_lh_slots */
     int64_t max_lh_slots;
 
+    /** number of 32-bit slots for evicted partial_lh (-lh32) */
+    int64_t max_lh32_slots;
+
     /** mapping from */
     MemSlotVector mem_slots;
 
+    /** TRUE to look up partial likelihoods in PartialLhCache at the next likelihood evaluation */
+    bool partial_lh_cache_armed;
+
+    /** TRUE while the current traversal looks up partial likelihoods in PartialLhCache */
+    bool partial_lh_cache_active;
+
+    /** hash of the model parameters for the current traversal */
+    PartialLhKey partial_lh_model_key;
+
+    /** hashes of the subtrees below the branches of the current traversal */
+    unordered_map<PhyloNeighbor*, PartialLhKey> partial_lh_cache_keys;
+
+    /** branches computed by the current traversal, to be stored in PartialLhCache */
+    vector<PhyloNeighbor*> partial_lh_cache_pending;
+
+    /** content hashes of the sequences, indexed by taxon ID */
+    vector<PartialLhKey> leaf_hashes;
+
+    /** alignment of leaf_hashes */
+    Alignment *leaf_hashes_aln;
+
     /**
             TRUE to discard saturated for Meyer & von Haeseler (2003) model
      */
@@ -2166,6 +2341,14 @@ protected:
     /** current best parsimony score */
     UINT best_pars_score;
 
+private:
+
+    /**
+            common part of readTreeString() and readTreeCode() after the tree is built:
+            set the root, map the partition trees, reset the likelihood
+     */
+    void finishReadTree();
+
 };
 
 #endif
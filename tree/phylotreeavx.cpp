@@ -27,6 +27,7 @@
 void PhyloTree::setParsimonyKernelAVX() {
 	computeParsimonyBranchPointer = &PhyloTree::computeParsimonyBranchFastSIMD<Vec8ui>;
     computePartialParsimonyPointer = &PhyloTree::computePartialParsimonyFastSIMD<Vec8ui>;
+    computeParsimonyInsertPointer = &PhyloTree::computeParsimonyInsertFastSIMD<Vec8ui>;
 }
 
 void PhyloTree::setDotProductAVX() {
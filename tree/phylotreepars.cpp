@@ -298,6 +298,102 @@ int PhyloTree::computeParsimonyBranchFast(PhyloNeighbor *dad_branch, PhyloNode *
     return score;
 }
 
+int PhyloTree::computeParsimonyInsert(PhyloNeighbor *leaf_branch, PhyloNeighbor *dad_branch, PhyloNeighbor *node_branch, int lower_bound) {
+    return (this->*computeParsimonyInsertPointer)(leaf_branch, dad_branch, node_branch, lower_bound);
+}
+
+int PhyloTree::computeParsimonyInsertFast(PhyloNeighbor *leaf_branch, PhyloNeighbor *dad_branch, PhyloNeighbor *node_branch, int lower_bound) {
+    int site;
+    int nsites = (aln->num_parsimony_sites + UINT_BITS-1) / UINT_BITS;
+    int nstates = aln->getMaxNumStates();
+
+    int scoreid = nsites*nstates;
+    UINT score = leaf_branch->partial_pars[scoreid] + dad_branch->partial_pars[scoreid] + node_branch->partial_pars[scoreid];
+    UINT *x = dad_branch->partial_pars;
+    UINT *y = node_branch->partial_pars;
+    UINT *l = leaf_branch->partial_pars;
+
+    switch (nstates) {
+    case 4:
+        for (site = 0; site < nsites; site++, x += 4, y += 4, l += 4) {
+            // Fitch step at the new internal node, then on the branch to the leaf
+            UINT z0 = x[0] & y[0], z1 = x[1] & y[1], z2 = x[2] & y[2], z3 = x[3] & y[3];
+            UINT w = ~(z0 | z1 | z2 | z3);
+            z0 |= w & (x[0] | y[0]);
+            z1 |= w & (x[1] | y[1]);
+            z2 |= w & (x[2] | y[2]);
+            z3 |= w & (x[3] | y[3]);
+            UINT v = ~((z0 & l[0]) | (z1 & l[1]) | (z2 & l[2]) | (z3 & l[3]));
+            score += vml_popcnt(w) + vml_popcnt(v);
+            if (score >= (UINT)lower_bound)
+                break;
+        }
+        break;
+    default:
+        for (site = 0; site < nsites; site++, x += nstates, y += nstates, l += nstates) {
+            int i;
+            UINT w = 0, v = 0;
+            for (i = 0; i < nstates; i++)
+                w |= x[i] & y[i];
+            w = ~w;
+            for (i = 0; i < nstates; i++)
+                v |= ((x[i] & y[i]) | (w & (x[i] | y[i]))) & l[i];
+            v = ~v;
+            score += vml_popcnt(w) + vml_popcnt(v);
+            if (score >= (UINT)lower_bound)
+                break;
+        }
+        break;
+    }
+    return score;
+}
+
+int PhyloTree::findBestInsertionMPFast(PhyloNeighbor *leaf_branch, NodeVector &nodes1, NodeVector &nodes2, int &best_score) {
+    int num_branches = nodes1.size();
+    vector<PhyloNeighbor*> dad_branches(num_branches), node_branches(num_branches);
+    // partial parsimony of both directions of every branch, computed only where the last
+    // insertion invalidated them
+    for (int i = 0; i < num_branches; i++) {
+        dad_branches[i] = (PhyloNeighbor*)nodes2[i]->findNeighbor(nodes1[i]);
+        node_branches[i] = (PhyloNeighbor*)nodes1[i]->findNeighbor(nodes2[i]);
+        computePartialParsimony(dad_branches[i], (PhyloNode*)nodes2[i]);
+        computePartialParsimony(node_branches[i], (PhyloNode*)nodes1[i]);
+    }
+
+    int best_id = -1;
+    best_score = INT_MAX;
+    int nthreads = max(num_threads, 1);
+    if (nthreads > 1 && num_branches < nthreads*8)
+        nthreads = 1;
+
+    // static schedule: every thread scans its branches in increasing order, so ties are
+    // resolved towards the first branch as in the sequential scan
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads) if(nthreads > 1)
+#endif
+    {
+        int thread_score = INT_MAX, thread_id = -1;
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+        for (int i = 0; i < num_branches; i++) {
+            int score = computeParsimonyInsert(leaf_branch, dad_branches[i], node_branches[i], thread_score);
+            if (score < thread_score) {
+                thread_score = score;
+                thread_id = i;
+            }
+        }
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+        if (thread_id >= 0 && (thread_score < best_score || (thread_score == best_score && thread_id < best_id))) {
+            best_score = thread_score;
+            best_id = thread_id;
+        }
+    }
+    return best_id;
+}
+
 void PhyloTree::computeAllPartialPars(PhyloNode *node, PhyloNode *dad) {
 	if (!node) node = (PhyloNode*)root;
 	FOR_NEIGHBOR_IT(node, dad, it) {
@@ -426,6 +522,18 @@ int PhyloTree::computeParsimonyTree(const char *out_prefix, Alignment *alignment
         added_node->addNeighbor((Node*) 1, -1.0);
         added_node->addNeighbor((Node*) 2, -1.0);
 
+        // the constraint check needs the taxon inserted into the tree
+        bool insert_fast = (leafNum >= constraintTree.leafNum && !isParsimonyTree());
+
+        if (insert_fast) {
+            PhyloNeighbor *leaf_branch = (PhyloNeighbor*) added_node->findNeighbor(new_taxon);
+            computePartialParsimony(leaf_branch, added_node);
+            int best_score;
+            int best_id = findBestInsertionMPFast(leaf_branch, nodes1, nodes2, best_score);
+            best_pars_score = best_score;
+            target_node = (PhyloNode*)nodes1[best_id];
+            target_dad = (PhyloNode*)nodes2[best_id];
+        } else
         for (int nodeid = 0; nodeid < nodes1.size(); nodeid++) {
         
             int score = addTaxonMPFast(new_taxon, added_node, nodes1[nodeid], nodes2[nodeid]);
@@ -454,7 +562,11 @@ int PhyloTree::computeParsimonyTree(const char *out_prefix, Alignment *alignment
         ((PhyloNeighbor*) added_node->findNeighbor(target_dad))->partial_lh_computed = 
             ((PhyloNeighbor*) target_node->findNeighbor(added_node))->partial_lh_computed;
         
-        ((PhyloNeighbor*) new_taxon->findNeighbor(added_node))->partial_lh_computed |= 2;
+        if (insert_fast)
+            // computed on demand
+            ((PhyloNeighbor*) new_taxon->findNeighbor(added_node))->clearPartialLh();
+        else
+            ((PhyloNeighbor*) new_taxon->findNeighbor(added_node))->partial_lh_computed |= 2;
         ((PhyloNeighbor*) new_taxon->findNeighbor(added_node))->partial_pars = new_taxon_partial_pars;
 
         ((PhyloNeighbor*)target_dad->findNeighbor(added_node))->clearPartialLh();
@@ -54,8 +54,15 @@ void PhyloTree::setParsimonyKernel(LikelihoodKernel lk) {
     if (lk < LK_SSE2) {
         computeParsimonyBranchPointer = &PhyloTree::computeParsimonyBranchFast;
         computePartialParsimonyPointer = &PhyloTree::computePartialParsimonyFast;
+        computeParsimonyInsertPointer = &PhyloTree::computeParsimonyInsertFast;
     	return;
     }
+#ifdef __AVX512KNL
+    if (lk >= LK_AVX512) {
+        setParsimonyKernelAVX512();
+        return;
+    }
+#endif
     if (lk >= LK_AVX) {
         setParsimonyKernelAVX();
         return;
@@ -189,16 +196,41 @@ void PhyloTree::changeLikelihoodKernel(LikelihoodKernel lk) {
  ******************************************************/
 
 void PhyloTree::computePartialLikelihood(TraversalInfo &info, size_t ptn_left, size_t ptn_right, int thread_id) {
+    if (info.lh32_save >= 0 || info.lh32_restore >= 0) {
+        // -lh32: keep the evicted partial_lh of this slot, or restore partial_lh from its 32-bit copy
+        size_t ncat_mix = (model_factory->fused_mix_rate) ? site_rate->getNRate() : site_rate->getNRate()*model->getNMixtures();
+        size_t block = aln->num_states * ncat_mix;
+        size_t scale_unit = (safe_numeric) ? ncat_mix : 1;
+        if (info.lh32_save >= 0)
+            mem_slots.saveLh32(info.lh32_save, info.lh32_save_lh, info.lh32_save_scale, ptn_left*block, ptn_right*block,
+                ptn_left*scale_unit, ptn_right*scale_unit);
+        if (info.lh32_restore >= 0) {
+            mem_slots.restoreLh32(info.lh32_restore, info.dad_branch->partial_lh, info.dad_branch->scale_num,
+                ptn_left*block, ptn_right*block, ptn_left*scale_unit, ptn_right*scale_unit);
+            return;
+        }
+    }
 	(this->*computePartialLikelihoodPointer)(info, ptn_left, ptn_right, thread_id);
 }
 
 double PhyloTree::computeLikelihoodBranch(PhyloNeighbor *dad_branch, PhyloNode *dad) {
-	return (this->*computeLikelihoodBranchPointer)(dad_branch, dad);
-
+    if (!partial_lh_cache_armed)
+        return (this->*computeLikelihoodBranchPointer)(dad_branch, dad);
+    // first traversal after the topology was replaced
+    beginPartialLhCache(dad_branch, dad);
+    double tree_lh = (this->*computeLikelihoodBranchPointer)(dad_branch, dad);
+    endPartialLhCache();
+    return tree_lh;
 }
 
 void PhyloTree::computeLikelihoodDerv(PhyloNeighbor *dad_branch, PhyloNode *dad, double *df, double *ddf) {
+    if (!partial_lh_cache_armed) {
+        (this->*computeLikelihoodDervPointer)(dad_branch, dad, df, ddf);
+        return;
+    }
+    beginPartialLhCache(dad_branch, dad);
 	(this->*computeLikelihoodDervPointer)(dad_branch, dad, df, ddf);
+    endPartialLhCache();
 }
 
 
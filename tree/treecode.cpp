@@ -0,0 +1,299 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2016 by                                            *
+ *   BUI Quang Minh <minh.bui@univie.ac.at>                                *
+ *                                                                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include "treecode.h"
+#include <algorithm>
+#include <climits>
+#include <string.h>
+
+/** bytes of the topology header: number of taxa and flags */
+#define TREECODE_HEADER 5
+
+/** header flag of rooted trees, the remaining bits are the bytes per entry */
+#define TREECODE_ROOTED 1
+
+/** alphabet of packed codes, chosen to never start a Newick string */
+static const char TREECODE_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+static void putEntry(string &code, size_t pos, int width, uint32_t value) {
+    for (int i = 0; i < width; i++, value >>= 8)
+        code[pos + i] = (char)(value & 0xFF);
+}
+
+static uint32_t getEntry(const string &code, size_t pos, int width) {
+    uint32_t value = 0;
+    for (int i = width - 1; i >= 0; i--)
+        value = (value << 8) | (uint8_t)code[pos + i];
+    return value;
+}
+
+/** 6 bits per character */
+static void packBytes(const string &bytes, string &str) {
+    size_t i;
+    for (i = 0; i + 2 < bytes.size(); i += 3) {
+        uint32_t v = getEntry(bytes, i, 3);
+        for (int j = 0; j < 4; j++, v >>= 6)
+            str += TREECODE_ALPHABET[v & 63];
+    }
+    if (i < bytes.size()) {
+        uint32_t v = getEntry(bytes, i, bytes.size() - i);
+        for (size_t j = 0; j <= bytes.size() - i; j++, v >>= 6)
+            str += TREECODE_ALPHABET[v & 63];
+    }
+}
+
+/** @return 1 + value of every character of the alphabet, 0 for other characters */
+static vector<int> makeAlphabetValues() {
+    vector<int> value(256, 0);
+    for (int i = 0; i < 64; i++)
+        value[(uint8_t)TREECODE_ALPHABET[i]] = i + 1;
+    return value;
+}
+
+static bool unpackBytes(const char *str, size_t len, string &bytes) {
+    static const vector<int> value = makeAlphabetValues();
+    if (len % 4 == 1)
+        return false;
+    bytes.resize(len / 4 * 3 + (len % 4 ? len % 4 - 1 : 0));
+    for (size_t i = 0, pos = 0; i < len; i += 4, pos += 3) {
+        size_t n = min(len - i, (size_t)4);
+        uint32_t v = 0;
+        for (int j = n - 1; j >= 0; j--) {
+            int c = value[(uint8_t)str[i + j]];
+            if (!c)
+                return false;
+            v = (v << 6) | (c - 1);
+        }
+        putEntry(bytes, pos, n - 1, v);
+    }
+    return true;
+}
+
+/** branch lengths of a neighbor, a single length unless the tree is heterotachous */
+static void getNeighborLength(Neighbor *nei, DoubleVector &len) {
+    nei->getLength(len);
+    if (len.empty())
+        len.push_back(nei->length);
+}
+
+void TreeCode::encode(MTree *tree, bool with_length) {
+    Node *root = tree->root;
+    ASSERT(root && root->isLeaf());
+    // a rooted tree has a virtual root leaf, which is not printed in Newick
+    bool rooted = (root->name == ROOT_NAME);
+    Node *top = root->neighbors[0]->node;
+    ASSERT(!top->isLeaf());
+    int ntaxa = rooted ? tree->leafNum - 1 : tree->leafNum;
+
+    // top-down order of the nodes, then the smallest taxon ID below every node bottom-up
+    vector<pair<Node*, Node*> > order; // (node, dad)
+    order.reserve(tree->nodeNum);
+    order.push_back(make_pair(top, (Node*)NULL));
+    for (size_t i = 0; i < order.size(); i++) {
+        Node *node = order[i].first, *dad = order[i].second;
+        FOR_NEIGHBOR_IT(node, dad, it)
+            if (!rooted || (*it)->node != root)
+                order.push_back(make_pair((*it)->node, node));
+    }
+    int nnode = order.size();
+    vector<int> min_taxon(tree->nodeNum, INT_MAX);
+    for (int i = nnode - 1; i >= 0; i--) {
+        Node *node = order[i].first, *dad = order[i].second;
+        if (node->isLeaf()) {
+            ASSERT(node->id < ntaxa);
+            min_taxon[node->id] = node->id;
+        }
+        if (dad)
+            min_taxon[dad->id] = min(min_taxon[dad->id], min_taxon[node->id]);
+    }
+
+    int width = (nnode <= 0xFF) ? 1 : ((nnode <= 0xFFFF) ? 2 : 4);
+    topology.assign(TREECODE_HEADER + (size_t)(nnode - 1) * width, 0);
+    putEntry(topology, 0, 4, ntaxa);
+    topology[4] = (char)((width << 1) | (rooted ? TREECODE_ROOTED : 0));
+
+    lengths.clear();
+    DoubleVector len;
+    int nlen = 0;
+    if (with_length) {
+        getNeighborLength(root->neighbors[0], len);
+        nlen = len.size();
+        lengths.resize((size_t)(nnode - 1 + rooted) * nlen);
+        if (rooted)
+            copy(len.begin(), len.end(), lengths.end() - nlen);
+    }
+
+    // pre-order traversal, pushing children with smaller taxa last onto the stack
+    vector<int> index(tree->nodeNum);
+    int rank = 0;
+    order.clear();
+    order.push_back(make_pair(top, (Node*)NULL));
+    while (!order.empty()) {
+        Node *node = order.back().first, *dad = order.back().second;
+        order.pop_back();
+        int id = node->isLeaf() ? node->id : ntaxa + (rank++);
+        index[node->id] = id;
+        if (dad) {
+            int pos = (id < ntaxa) ? id : id - 1;
+            putEntry(topology, TREECODE_HEADER + (size_t)pos * width, width, index[dad->id]);
+            if (with_length) {
+                getNeighborLength(node->findNeighbor(dad), len);
+                ASSERT(len.size() == nlen);
+                copy(len.begin(), len.end(), lengths.begin() + (size_t)pos * nlen);
+            }
+        }
+        if (node->isLeaf())
+            continue;
+        size_t first = order.size();
+        FOR_NEIGHBOR_IT(node, dad, it)
+            if (!rooted || (*it)->node != root)
+                order.push_back(make_pair((*it)->node, node));
+        sort(order.begin() + first, order.end(),
+            [&min_taxon](const pair<Node*, Node*> &a, const pair<Node*, Node*> &b) {
+                return min_taxon[a.first->id] > min_taxon[b.first->id];
+            });
+    }
+}
+
+void TreeCode::decode(MTree *tree, StrVector *leaf_names) const {
+    ASSERT(!empty());
+    int ntaxa = getEntry(topology, 0, 4);
+    bool rooted = topology[4] & TREECODE_ROOTED;
+    int width = topology[4] >> 1;
+    int nnode = (topology.size() - TREECODE_HEADER) / width + 1;
+    int nlen = lengths.size() / (nnode - 1 + rooted);
+    int id;
+
+    vector<int> parent(nnode, -1);
+    for (id = 0; id < nnode; id++)
+        if (id != ntaxa)
+            parent[id] = getEntry(topology, TREECODE_HEADER + (size_t)(id < ntaxa ? id : id - 1) * width, width);
+
+    // smallest taxon ID below every node, internal nodes come after their parents
+    vector<int> min_taxon(nnode, INT_MAX);
+    for (id = 0; id < ntaxa; id++) {
+        min_taxon[id] = id;
+        min_taxon[parent[id]] = min(min_taxon[parent[id]], id);
+    }
+    for (id = nnode - 1; id > ntaxa; id--)
+        min_taxon[parent[id]] = min(min_taxon[parent[id]], min_taxon[id]);
+
+    // children of every internal node, sorted as by WT_SORT_TAXA
+    vector<int> child_start(nnode - ntaxa + 1, 0), children(nnode - 1);
+    for (id = 0; id < nnode; id++)
+        if (id != ntaxa)
+            child_start[parent[id] - ntaxa + 1]++;
+    for (id = 1; id < child_start.size(); id++)
+        child_start[id] += child_start[id - 1];
+    vector<int> child_pos(child_start.begin(), child_start.end() - 1);
+    for (id = 0; id < nnode; id++)
+        if (id != ntaxa)
+            children[child_pos[parent[id] - ntaxa]++] = id;
+
+    vector<Node*> nodes(nnode);
+    for (id = 0; id < ntaxa; id++) {
+        if (leaf_names)
+            nodes[id] = tree->newNode(id, (*leaf_names)[id].c_str());
+        else
+            nodes[id] = tree->newNode(id, id);
+    }
+    for (id = ntaxa; id < nnode; id++)
+        nodes[id] = tree->newNode();
+
+    // link children before parents, giving the neighbor order of the Newick parser
+    DoubleVector len;
+    for (id = nnode - 1; id >= ntaxa; id--) {
+        Node *node = nodes[id];
+        vector<int>::iterator first = children.begin() + child_start[id - ntaxa];
+        vector<int>::iterator last = children.begin() + child_start[id - ntaxa + 1];
+        sort(first, last, [&min_taxon](int a, int b) { return min_taxon[a] < min_taxon[b]; });
+        node->neighbors.reserve((last - first) + 1);
+        for (vector<int>::iterator it = first; it != last; it++) {
+            int pos = (*it < ntaxa) ? *it : *it - 1;
+            len.assign(lengths.begin() + (size_t)pos * nlen, lengths.begin() + (size_t)(pos + 1) * nlen);
+            node->addNeighbor(nodes[*it], len);
+            nodes[*it]->addNeighbor(node, len);
+        }
+    }
+
+    Node *top = nodes[ntaxa];
+    if (rooted) {
+        len.assign(lengths.end() - nlen, lengths.end());
+        if (len.empty())
+            len.push_back(0.0);
+        tree->root = tree->newNode(ntaxa, ROOT_NAME);
+        tree->root->addNeighbor(top, len);
+        top->addNeighbor(tree->root, len);
+        tree->leafNum = ntaxa + 1;
+    } else {
+        tree->root = NULL;
+        FOR_NEIGHBOR_IT(top, NULL, it)
+            if ((*it)->node->isLeaf()) {
+                tree->root = (*it)->node;
+                break;
+            }
+        ASSERT(tree->root);
+        tree->leafNum = ntaxa;
+    }
+    tree->rooted = rooted;
+    tree->nodeNum = tree->leafNum;
+    tree->initializeTree();
+}
+
+string TreeCode::pack() const {
+    string str;
+    packBytes(topology, str);
+    if (!lengths.empty()) {
+        // lengths as little-endian IEEE floats
+        string bytes(lengths.size() * 4, 0);
+        for (size_t i = 0; i < lengths.size(); i++) {
+            uint32_t bits;
+            memcpy(&bits, &lengths[i], 4);
+            putEntry(bytes, i * 4, 4, bits);
+        }
+        str += '.';
+        packBytes(bytes, str);
+    }
+    return str;
+}
+
+bool TreeCode::unpack(const string &str) {
+    size_t dot = str.find('.');
+    size_t len = min(dot, str.length());
+    if (!unpackBytes(str.c_str(), len, topology) || topology.size() <= TREECODE_HEADER) {
+        topology.clear();
+        return false;
+    }
+    lengths.clear();
+    if (dot == string::npos)
+        return true;
+    string bytes;
+    if (!unpackBytes(str.c_str() + dot + 1, str.length() - dot - 1, bytes) || bytes.size() % 4 != 0) {
+        topology.clear();
+        return false;
+    }
+    lengths.resize(bytes.size() / 4);
+    for (size_t i = 0; i < lengths.size(); i++) {
+        uint32_t bits = getEntry(bytes, i * 4, 4);
+        memcpy(&lengths[i], &bits, 4);
+    }
+    return true;
+}
@@ -0,0 +1,97 @@
+/***************************************************************************
+ *   Copyright (C) 2009-2016 by                                            *
+ *   BUI Quang Minh <minh.bui@univie.ac.at>                                *
+ *                                                                         *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef TREECODE_H
+#define TREECODE_H
+
+#include "mtree.h"
+
+/**
+    canonical compact encoding of a tree rooted at a leaf, replacing Newick strings for
+    trees kept in memory (UFBoot trees, candidate topologies).
+    The tree is seen from the neighbor of the root leaf (the outermost bracket of the Newick string),
+    and its nodes are numbered as follows: taxa by their IDs, then internal nodes in pre-order,
+    visiting children in increasing order of their smallest taxon ID (the order of WT_SORT_TAXA).
+    The topology is the parent of every node except the outermost one, stored in 1, 2 or 4 bytes
+    depending on the number of nodes. Two trees rooted at the same leaf thus have the same
+    topology code if and only if they have the same topology.
+    Newick strings are only produced when writing output, by decoding into an MTree.
+*/
+class TreeCode {
+public:
+
+    /**
+        encode a tree
+        @param tree a tree rooted at a leaf, whose leaves are numbered by taxon IDs
+        @param with_length TRUE to also store branch lengths (in single precision)
+    */
+    void encode(MTree *tree, bool with_length = false);
+
+    /**
+        build a tree from the code, the same as reading the Newick string printed with
+        WT_TAXON_ID | WT_SORT_TAXA (and WT_BR_LEN if the code has branch lengths)
+        @param tree an empty tree
+        @param leaf_names names of the taxa, NULL to name leaves by taxon IDs
+    */
+    void decode(MTree *tree, StrVector *leaf_names = NULL) const;
+
+    /** @return TRUE if no tree was encoded */
+    bool empty() const { return topology.empty(); }
+
+    /** @return TRUE if the code has branch lengths */
+    bool hasLength() const { return !lengths.empty(); }
+
+    bool operator==(const TreeCode &code) const {
+        return topology == code.topology && lengths == code.lengths;
+    }
+
+    bool operator!=(const TreeCode &code) const {
+        return !(*this == code);
+    }
+
+    /**
+        @return the code as a printable string without white spaces, for checkpointing
+    */
+    string pack() const;
+
+    /**
+        restore the code from a string produced by pack()
+        @param str the packed code
+        @return FALSE if str is not a packed code (e.g., a Newick string)
+    */
+    bool unpack(const string &str);
+
+    /**
+        topology code: number of taxa (4 bytes), flags (1 byte: rooted tree and bytes per entry),
+        then the parent of every node but the outermost one.
+        As a string it directly serves as hash key of the topology
+    */
+    string topology;
+
+    /**
+        branch lengths above every node in the order of topology, followed by the length of the
+        root branch for rooted trees. Heterotachy trees have several lengths per branch
+    */
+    vector<float> lengths;
+
+};
+
+#endif // TREECODE_H
@@ -14,6 +14,13 @@
 const char* CKP_HEADER =     "--- # IQ-TREE Checkpoint ver >= 1.6";
 const char* CKP_HEADER_OLD = "--- # IQ-TREE Checkpoint";
 
+/* the log file starts with CKP_LOG_MAGIC, followed by records of
+   sequence number (uint64), key length (uint32), value length (uint32, CKP_LOG_ERASED for
+   an erased key), key, value and CRC32 of all previous fields of the record */
+const char CKP_LOG_MAGIC[8] = {'I', 'Q', 'C', 'K', 'P', 'L', 'O', 'G'};
+const uint32_t CKP_LOG_ERASED = 0xffffffff;
+const size_t CKP_LOG_RECORD_HEAD = sizeof(uint64_t) + 2*sizeof(uint32_t);
+
 Checkpoint::Checkpoint() {
 	filename = "";
     prev_dump_time = 0;
@@ -21,6 +28,12 @@ Checkpoint::Checkpoint() {
     struct_name = "";
     compression = true;
     header = CKP_HEADER;
+    log_seq = 0;
+    dump_size = 0;
+    log_size = 0;
+    log_valid = false;
+    num_dumps = 0;
+    snapshot_time = 0.0;
 }
 
 
@@ -29,7 +42,10 @@ Checkpoint::~Checkpoint() {
 
 
 void Checkpoint::setFileName(string filename) {
+    writer.wait();
 	this->filename = filename;
+    log_valid = false;
+    dirty_keys.clear();
 }
 
 
@@ -74,6 +90,7 @@ void Checkpoint::load(istream &in) {
 
 bool Checkpoint::load() {
 	ASSERT(filename != "");
+    writer.wait();
     if (!fileExists(filename)) return false;
     try {
         igzstream in;
@@ -97,6 +114,7 @@ bool Checkpoint::load() {
         // set the failbit again
         in.exceptions(ios::failbit | ios::badbit);
         in.close();
+        loadLog();
         return true;
     } catch (ios::failure &) {
         outError(ERR_READ_INPUT);
@@ -149,38 +167,144 @@ void Checkpoint::dump(bool force) {
     if (!force && getRealTime() < prev_dump_time + dump_interval) {
         return;
     }
+    // never let the search wait for the disk, try again at the next call
+    if (!force && writer.busy())
+        return;
     prev_dump_time = getRealTime();
-    string filename_tmp = filename + ".tmp";
-    if (fileExists(filename_tmp)) {
-        outWarning("IQ-TREE was killed while writing temporary checkpoint file " + filename_tmp);
-        outWarning("You should increase checkpoint interval from the default 60 seconds");
-        outWarning("via -cptime option to avoid too frequent checkpoint for large datasets");
+    if (!log_valid) {
+        dumpFull();
+    } else {
+        dumpLog();
+        // compaction, the log has already received all changes at this point so that
+        // replaying it on top of the new file is harmless if we get killed in between
+        if (log_size > dump_size)
+            dumpFull();
     }
-    try {
-        ostream *out;
-        if (compression) 
-            out = new ogzstream(filename_tmp.c_str());
-        else
-            out = new ofstream(filename_tmp.c_str());
-        out->exceptions(ios::failbit | ios::badbit);
-        *out << header << endl;
-        // call dump stream
-        dump(*out);
-        if (compression)
-            ((ogzstream*)out)->close();
-        else
-            ((ofstream*)out)->close();
-        delete out;
-//        cout << "Checkpoint dumped" << endl;
-        if (fileExists(filename)) {
-            if (std::remove(filename.c_str()) != 0)
-                outError("Cannot remove file ", filename);
+    num_dumps++;
+    snapshot_time += getRealTime() - prev_dump_time;
+    if (force)
+        writer.wait();
+}
+
+void Checkpoint::printDumpStats(ostream &out) {
+    writer.wait();
+    out << "Checkpoint dumps: " << num_dumps << ", snapshot time: " << snapshot_time
+        << " sec, background writing time: " << writer.write_time << " sec" << endl;
+}
+
+void Checkpoint::initDumpSize() {
+    dirty_keys.clear();
+    dump_size = 0;
+    for (iterator i = begin(); i != end(); i++)
+        dump_size += i->first.length() + i->second.length();
+}
+
+void Checkpoint::dumpFull() {
+    CkpWriteJob job;
+    job.filename = filename;
+    job.compression = compression;
+    job.full = true;
+    // a log from another run must never be replayed on top of the new file
+    job.remove_log = !log_valid;
+    ostringstream out;
+    out << header << endl;
+    // call dump stream
+    dump(out);
+    job.data = out.str();
+    writer.submit(job);
+    initDumpSize();
+    log_size = 0;
+    log_valid = true;
+}
+
+/**
+    append a log record to a buffer
+    @param[in,out] buf buffer
+    @param seq sequence number
+    @param key key
+    @param value value, NULL if the key was erased
+*/
+static void appendLogRecord(string &buf, uint64_t seq, const string &key, const string *value) {
+    size_t start = buf.size();
+    uint32_t key_len = key.length();
+    uint32_t value_len = value ? value->length() : CKP_LOG_ERASED;
+    buf.append((char*)&seq, sizeof(seq));
+    buf.append((char*)&key_len, sizeof(key_len));
+    buf.append((char*)&value_len, sizeof(value_len));
+    buf.append(key);
+    if (value)
+        buf.append(*value);
+    uint32_t crc = crc32(0L, (const Bytef*)buf.data() + start, buf.size() - start);
+    buf.append((char*)&crc, sizeof(crc));
+}
+
+void Checkpoint::dumpLog() {
+    string buf;
+    for (set<string>::iterator key = dirty_keys.begin(); key != dirty_keys.end(); key++) {
+        iterator i = find(*key);
+        appendLogRecord(buf, ++log_seq, *key, (i != end()) ? &i->second : NULL);
+    }
+    dirty_keys.clear();
+    if (buf.empty())
+        return;
+    log_size += buf.size();
+    CkpWriteJob job;
+    job.filename = filename;
+    job.compression = compression;
+    job.full = false;
+    job.remove_log = false;
+    job.data.swap(buf);
+    writer.submit(job);
+}
+
+void Checkpoint::loadLog() {
+    string filename_log = filename + ".log";
+    log_valid = false;
+    log_size = 0;
+    ifstream in(filename_log.c_str(), ios::in | ios::binary);
+    if (in.is_open()) {
+        in.seekg(0, ios::end);
+        size_t file_size = in.tellg();
+        in.seekg(0, ios::beg);
+        char magic[sizeof(CKP_LOG_MAGIC)];
+        if (in.read(magic, sizeof(magic)) && memcmp(magic, CKP_LOG_MAGIC, sizeof(magic)) == 0) {
+            size_t pos = sizeof(magic);
+            string rec;
+            while (true) {
+                if (pos == file_size) {
+                    log_valid = true;
+                    break;
+                }
+                uint64_t seq;
+                uint32_t key_len, value_len, crc;
+                rec.resize(CKP_LOG_RECORD_HEAD);
+                if (!in.read(&rec[0], CKP_LOG_RECORD_HEAD))
+                    break;
+                memcpy(&seq, &rec[0], sizeof(seq));
+                memcpy(&key_len, &rec[sizeof(seq)], sizeof(key_len));
+                memcpy(&value_len, &rec[sizeof(seq)+sizeof(key_len)], sizeof(value_len));
+                size_t data_len = (size_t)key_len + (value_len == CKP_LOG_ERASED ? 0 : value_len);
+                if (seq <= log_seq || pos + CKP_LOG_RECORD_HEAD + data_len + sizeof(crc) > file_size)
+                    break;
+                rec.resize(CKP_LOG_RECORD_HEAD + data_len);
+                if (!in.read(&rec[CKP_LOG_RECORD_HEAD], data_len) || !in.read((char*)&crc, sizeof(crc)) ||
+                    crc != crc32(0L, (const Bytef*)rec.data(), rec.size()))
+                    break;
+                string key = rec.substr(CKP_LOG_RECORD_HEAD, key_len);
+                if (value_len == CKP_LOG_ERASED)
+                    erase(key);
+                else
+                    (*this)[key] = rec.substr(CKP_LOG_RECORD_HEAD + key_len);
+                log_seq = seq;
+                pos += rec.size() + sizeof(crc);
+            }
+            log_size = pos - sizeof(magic);
         }
-        if (std::rename(filename_tmp.c_str(), filename.c_str()) != 0)
-            outError("Cannot rename file ", filename_tmp);
-    } catch (ios::failure &) {
-        outError(ERR_WRITE_OUTPUT, filename.c_str());
+        in.close();
+        if (!log_valid)
+            outWarning("Ignore incomplete records of checkpoint log " + filename_log);
     }
+    initDumpSize();
 }
 
 bool Checkpoint::hasKey(string key) {
@@ -210,6 +334,8 @@ int Checkpoint::eraseKeyPrefix(string key_prefix) {
             break;
 
     }
+    for (iterator it = first_it; it != i; it++)
+        markDirty(it->first);
     if (count)
         erase(first_it, i);
     return count;
@@ -218,12 +344,17 @@ int Checkpoint::eraseKeyPrefix(string key_prefix) {
 int Checkpoint::keepKeyPrefix(string key_prefix) {
     map<string,string> newckp;
     int count = 0;
-    erase(begin(), lower_bound(key_prefix));
+    iterator first_it = lower_bound(key_prefix);
+    for (iterator it = begin(); it != first_it; it++)
+        markDirty(it->first);
+    erase(begin(), first_it);
     
     for (iterator i = begin(); i != end(); i++) {
         if (i->first.compare(0, key_prefix.size(), key_prefix) == 0)
             count++;
         else {
+            for (iterator it = i; it != end(); it++)
+                markDirty(it->first);
             erase(i, end());
             break;
         }
@@ -232,6 +363,23 @@ int Checkpoint::keepKeyPrefix(string key_prefix) {
     return count;
 }
 
+void Checkpoint::clear() {
+    for (iterator it = begin(); it != end(); it++)
+        markDirty(it->first);
+    map<string, string>::clear();
+}
+
+void Checkpoint::setValue(const string &key, const string &value) {
+    iterator it = find(key);
+    if (it == end()) {
+        insert(it, make_pair(key, value));
+        markDirty(key);
+    } else if (it->second != value) {
+        it->second = value;
+        markDirty(key);
+    }
+}
+
 /*-------------------------------------------------------------
  * series of get function to get value of a key
  *-------------------------------------------------------------*/
@@ -336,6 +484,183 @@ void Checkpoint::getSubCheckpoint(Checkpoint *target, string partial_key) {
 }
 */
 
+/*-------------------------------------------------------------
+ * CheckpointWriter
+ *-------------------------------------------------------------*/
+
+CheckpointWriter::CheckpointWriter() {
+    write_time = 0.0;
+#ifdef _USE_PTHREADS
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&cond, NULL);
+    started = false;
+    stopping = false;
+#endif
+}
+
+CheckpointWriter::CheckpointWriter(const CheckpointWriter &writer) : CheckpointWriter() {
+}
+
+CheckpointWriter &CheckpointWriter::operator=(const CheckpointWriter &writer) {
+    return *this;
+}
+
+CheckpointWriter::~CheckpointWriter() {
+#ifdef _USE_PTHREADS
+    if (started) {
+        pthread_mutex_lock(&mutex);
+        stopping = true;
+        pthread_cond_broadcast(&cond);
+        pthread_mutex_unlock(&mutex);
+        pthread_join(thread, NULL);
+    }
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&mutex);
+#endif
+}
+
+void CheckpointWriter::submit(CkpWriteJob &job) {
+    checkError();
+#ifdef _USE_PTHREADS
+    pthread_mutex_lock(&mutex);
+    jobs.push_back(CkpWriteJob());
+    jobs.back().filename = job.filename;
+    jobs.back().compression = job.compression;
+    jobs.back().full = job.full;
+    jobs.back().remove_log = job.remove_log;
+    jobs.back().data.swap(job.data);
+    if (!started) {
+        if (pthread_create(&thread, NULL, run, this) != 0)
+            outError("Cannot start checkpoint writer thread");
+        started = true;
+    }
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&mutex);
+#else
+    error = write(job);
+    checkError();
+#endif
+}
+
+bool CheckpointWriter::busy() {
+#ifdef _USE_PTHREADS
+    pthread_mutex_lock(&mutex);
+    bool ret = !jobs.empty();
+    pthread_mutex_unlock(&mutex);
+    return ret;
+#else
+    return false;
+#endif
+}
+
+void CheckpointWriter::wait() {
+#ifdef _USE_PTHREADS
+    pthread_mutex_lock(&mutex);
+    while (!jobs.empty())
+        pthread_cond_wait(&cond, &mutex);
+    pthread_mutex_unlock(&mutex);
+#endif
+    checkError();
+}
+
+void CheckpointWriter::checkError() {
+    // errors of the writer thread are raised here, on the main thread, not to exit while it prints
+#ifdef _USE_PTHREADS
+    pthread_mutex_lock(&mutex);
+    string msg = error;
+    pthread_mutex_unlock(&mutex);
+#else
+    string msg = error;
+#endif
+    if (!msg.empty())
+        outError(msg);
+}
+
+#ifdef _USE_PTHREADS
+void *CheckpointWriter::run(void *arg) {
+    CheckpointWriter *writer = (CheckpointWriter*)arg;
+    pthread_mutex_lock(&writer->mutex);
+    while (true) {
+        if (writer->jobs.empty()) {
+            if (writer->stopping)
+                break;
+            pthread_cond_wait(&writer->cond, &writer->mutex);
+            continue;
+        }
+        // the front job stays in the queue while being written so that busy() and wait() see it
+        CkpWriteJob &job = writer->jobs.front();
+        bool failed = !writer->error.empty();
+        pthread_mutex_unlock(&writer->mutex);
+        // after an error the files are left as they are, the jobs queued behind it would build on it
+        string msg = failed ? "" : writer->write(job);
+        pthread_mutex_lock(&writer->mutex);
+        if (!msg.empty())
+            writer->error = msg;
+        writer->jobs.pop_front();
+        pthread_cond_broadcast(&writer->cond);
+    }
+    pthread_mutex_unlock(&writer->mutex);
+    return NULL;
+}
+#endif
+
+string CheckpointWriter::write(CkpWriteJob &job) {
+    double start_time = getRealTime();
+    string filename_tmp = job.filename + ".tmp";
+    string filename_log = job.filename + ".log";
+    ostream *tmp_out = NULL;
+    try {
+        if (!job.full) {
+            ofstream out;
+            out.exceptions(ios::failbit | ios::badbit);
+            out.open(filename_log.c_str(), ios::out | ios::app | ios::binary);
+            out.write(job.data.data(), job.data.size());
+            out.close();
+            write_time += getRealTime() - start_time;
+            return "";
+        }
+        if (fileExists(filename_tmp)) {
+            outWarning("IQ-TREE was killed while writing temporary checkpoint file " + filename_tmp);
+            outWarning("You should increase checkpoint interval from the default 60 seconds");
+            outWarning("via -cptime option to avoid too frequent checkpoint for large datasets");
+        }
+        if (job.remove_log && fileExists(filename_log))
+            std::remove(filename_log.c_str());
+        if (job.compression)
+            tmp_out = new ogzstream(filename_tmp.c_str());
+        else
+            tmp_out = new ofstream(filename_tmp.c_str());
+        tmp_out->exceptions(ios::failbit | ios::badbit);
+        tmp_out->write(job.data.data(), job.data.size());
+        if (job.compression)
+            ((ogzstream*)tmp_out)->close();
+        else
+            ((ofstream*)tmp_out)->close();
+        delete tmp_out;
+        tmp_out = NULL;
+//        cout << "Checkpoint dumped" << endl;
+        if (fileExists(job.filename)) {
+            if (std::remove(job.filename.c_str()) != 0)
+                return "Cannot remove file " + job.filename;
+        }
+        if (std::rename(filename_tmp.c_str(), job.filename.c_str()) != 0)
+            return "Cannot rename file " + filename_tmp;
+
+        // start an empty log
+        ofstream log_out;
+        log_out.exceptions(ios::failbit | ios::badbit);
+        log_out.open(filename_log.c_str(), ios::out | ios::trunc | ios::binary);
+        log_out.write(CKP_LOG_MAGIC, sizeof(CKP_LOG_MAGIC));
+        log_out.close();
+    } catch (ios::failure &) {
+        if (tmp_out)
+            delete tmp_out;
+        return ERR_WRITE_OUTPUT + job.filename;
+    }
+    write_time += getRealTime() - start_time;
+    return "";
+}
+
 /*-------------------------------------------------------------
  * CheckpointFactory
  *-------------------------------------------------------------*/
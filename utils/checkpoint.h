@@ -10,12 +10,17 @@
 
 #include <stdio.h>
 #include <map>
+#include <set>
 #include <string>
 #include <sstream>
 #include <cassert>
 #include <vector>
 #include <typeinfo>
+#include <deque>
 #include "tools.h"
+#ifdef _USE_PTHREADS
+#include <pthread.h>
+#endif
 
 using namespace std;
 
@@ -59,6 +64,75 @@ public:
 //    return is;
 //}
 
+/** a serialised checkpoint or log chunk waiting to be written to disk */
+struct CkpWriteJob {
+    /** checkpoint file name */
+    string filename;
+    /** true to compress the checkpoint file */
+    bool compression;
+    /** true if data is the whole checkpoint, false if data is appended to the log */
+    bool full;
+    /** true to remove a log of another run before writing the whole checkpoint */
+    bool remove_log;
+    /** checkpoint text or log records */
+    string data;
+};
+
+/**
+    background thread writing checkpoint files in submission order.
+    Copying does not share the thread, each copy starts its own on demand
+*/
+class CheckpointWriter {
+public:
+    CheckpointWriter();
+    CheckpointWriter(const CheckpointWriter &writer);
+    CheckpointWriter &operator=(const CheckpointWriter &writer);
+
+    /** wait for pending jobs and stop the thread */
+    ~CheckpointWriter();
+
+    /**
+        queue a job, the data is taken over, written immediately without thread support
+        @param job write job
+    */
+    void submit(CkpWriteJob &job);
+
+    /** @return true if a job is pending */
+    bool busy();
+
+    /** block until all jobs are written */
+    void wait();
+
+    /** stop the program if a previous job could not be written */
+    void checkError();
+
+    /** wall-clock time spent writing files */
+    double write_time;
+
+protected:
+    /**
+        write one job to disk
+        @return error message, empty if the job was written
+    */
+    string write(CkpWriteJob &job);
+
+    /** error of the first job that could not be written, later jobs are dropped */
+    string error;
+
+#ifdef _USE_PTHREADS
+    /** thread main loop */
+    static void *run(void *writer);
+
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool started;
+    bool stopping;
+    /** jobs not finished yet, front is being written */
+    deque<CkpWriteJob> jobs;
+#endif
+};
+
 /**
  * Checkpoint as map from key strings to value strings
  */
@@ -109,11 +183,22 @@ public:
 	void dump(ostream &out);
 
 	/**
-	 * dump checkpoint information into file
-	 * @param force TRUE to dump no matter if time interval exceeded or not
+	 * dump checkpoint information into file. Only keys changed since the previous dump
+	 * are appended to the log file filename.log, the full file is rewritten
+	 * (compaction) once the log grows larger than the checkpoint itself.
+	 * The caller only takes a snapshot, files are written by a background thread.
+	 * A regular dump is skipped while the previous one is still being written
+	 * @param force TRUE to dump no matter if time interval exceeded or not,
+	 * and to return only after the files are written
 	 */
 	void dump(bool force = false);
 
+    /**
+        print number of dumps and time spent for snapshots and writing
+        @param out output stream
+    */
+    void printDumpStats(ostream &out);
+
     /**
         set dumping interval in seconds
         @param interval dumping interval
@@ -146,6 +231,11 @@ public:
      */
     int keepKeyPrefix(string key_prefix);
 
+    /**
+        erase all entries
+    */
+    void clear();
+
     /*-------------------------------------------------------------
      * series of get function to get value of a key
      *-------------------------------------------------------------*/
@@ -286,7 +376,7 @@ public:
         CkpStream ss;
         ss.precision(10);
         ss << value;
-        (*this)[key] = ss.str();
+        setValue(key, ss.str());
     }
     
     /** 
@@ -313,7 +403,7 @@ public:
             if (i > 0) ss << ", ";
             ss << value[i];
         }
-        (*this)[key] = ss.str();
+        setValue(key, ss.str());
     }
 
     /**
@@ -334,7 +424,7 @@ public:
             if (i > 0) ss << ", ";
             ss << value[i];
         }
-        (*this)[key] = ss.str();
+        setValue(key, ss.str());
     }
     
     /*-------------------------------------------------------------
@@ -396,6 +486,70 @@ protected:
     
     /** header line of checkpoint file */
     string header;
+
+    /**
+        keys put or erased since the previous dump, only tracked for checkpoints with a file name.
+        Keys loaded from the file or its log are not dirty
+    */
+    set<string> dirty_keys;
+
+    /** sequence number of the last log record */
+    uint64_t log_seq;
+
+    /** number of key and value bytes in the last full dump */
+    size_t dump_size;
+
+    /** number of bytes appended to the log since the last full dump */
+    size_t log_size;
+
+    /** true if the log file belongs to the current checkpoint file and can be appended */
+    bool log_valid;
+
+    /** number of dumps */
+    int num_dumps;
+
+    /** wall-clock time spent by the dumping thread taking snapshots */
+    double snapshot_time;
+
+    /** background writer */
+    CheckpointWriter writer;
+
+    /**
+        set the value of a key (including the struct name), marking it dirty if it changed
+        @param key full key
+        @param value new value
+    */
+    void setValue(const string &key, const string &value);
+
+    /**
+        set dump_size from the current content, which is then the content of the files
+    */
+    void initDumpSize();
+
+    /**
+        mark a key as put or erased since the previous dump
+        @param key full key
+    */
+    void markDirty(const string &key) {
+        if (!filename.empty())
+            dirty_keys.insert(key);
+    }
+
+    /**
+        write the whole checkpoint into file and start an empty log
+    */
+    void dumpFull();
+
+    /**
+        append records for the dirty keys to the log
+    */
+    void dumpLog();
+
+    /**
+        replay the log file on top of the loaded checkpoint,
+        stopping at the first incomplete or corrupted record
+    */
+    void loadLog();
     
 private:
 
@@ -774,6 +774,7 @@ void parseArg(int argc, char *argv[], Params &params) {
 
     params.aln_file = NULL;
     params.phylip_sequential_format = false;
+    params.aln_cache = false;
     params.treeset_file = NULL;
     params.topotest_replicates = 0;
     params.do_weighted_test = false;
@@ -804,6 +805,9 @@ void parseArg(int argc, char *argv[], Params &params) {
     params.numSmoothTree = 1;
     params.nni5 = true;
     params.nni5_num_eval = 1;
+    params.nni_parallel = false;
+    params.tree_parallel = false;
+    params.partial_lh_cache_size = 0;
     params.brlen_num_traversal = 2;
     params.leastSquareBranch = false;
     params.pars_branch_length = false;
@@ -828,11 +832,14 @@ void parseArg(int argc, char *argv[], Params &params) {
     params.ratehet_set = NULL;
     params.model_def_file = NULL;
     params.model_test_again = false;
+    params.model_test_prune = false;
+    params.model_test_parallel = false;
     params.model_test_and_tree = 0;
     params.model_test_separate_rate = false;
     params.optimize_mixmodel_weight = false;
     params.optimize_rate_matrix = false;
     params.store_trans_matrix = false;
+    params.eigen_cache_size = 64;
     //params.freq_type = FREQ_EMPIRICAL;
     params.freq_type = FREQ_UNKNOWN;
     params.keep_zero_freq = true;
@@ -877,6 +884,7 @@ void parseArg(int argc, char *argv[], Params &params) {
     params.lk_safe_scaling = false;
     params.numseq_safe_scaling = 2000;
     params.kernel_nonrev = false;
+    params.lh_tile_cache = 256;
     params.print_site_lh = WSL_NONE;
     params.print_partition_lh = false;
     params.print_site_prob = WSL_NONE;
@@ -994,6 +1002,7 @@ void parseArg(int argc, char *argv[], Params &params) {
 	params.pomo_pop_size = 9;
 	params.print_branch_lengths = false;
 	params.lh_mem_save = LM_PER_NODE; // auto detect
+    params.lh32 = false;
 	params.start_tree = STT_PLL_PARSIMONY;
 	params.print_splits_file = false;
     params.ignore_identical_seqs = true;
@@ -1640,6 +1649,10 @@ void parseArg(int argc, char *argv[], Params &params) {
 			if (strcmp(argv[cnt], "--sequential") == 0) {
                 params.phylip_sequential_format = true;
                 continue;
+            }
+			if (strcmp(argv[cnt], "--aln-cache") == 0) {
+                params.aln_cache = true;
+                continue;
             }
 			if (strcmp(argv[cnt], "-z") == 0) {
 				cnt++;
@@ -1971,6 +1984,18 @@ void parseArg(int argc, char *argv[], Params &params) {
 				params.model_test_again = true;
 				continue;
 			}
+			if (strcmp(argv[cnt], "-mprune") == 0) {
+				params.model_test_prune = true;
+				continue;
+			}
+			if (strcmp(argv[cnt], "-mnoprune") == 0) {
+				params.model_test_prune = false;
+				continue;
+			}
+			if (strcmp(argv[cnt], "-mpar") == 0) {
+				params.model_test_parallel = true;
+				continue;
+			}
 			if (strcmp(argv[cnt], "-mtree") == 0) {
 				params.model_test_and_tree = 1;
 				continue;
@@ -2020,6 +2045,15 @@ void parseArg(int argc, char *argv[], Params &params) {
 				params.store_trans_matrix = true;
 				continue;
 			}
+			if (strcmp(argv[cnt], "-mcache") == 0) {
+				cnt++;
+				if (cnt >= argc)
+					throw "Use -mcache <memory_in_MB>";
+				params.eigen_cache_size = convert_int(argv[cnt]);
+				if (params.eigen_cache_size < 0)
+					throw "Memory for -mcache must not be negative";
+				continue;
+			}
 			if (strcmp(argv[cnt], "-nni_lh") == 0) {
 				params.nni_lh = true;
 				continue;
@@ -2073,6 +2107,16 @@ void parseArg(int argc, char *argv[], Params &params) {
                 continue;
             }
 
+            if (strcmp(argv[cnt], "--tile-cache") == 0) {
+                cnt++;
+                if (cnt >= argc)
+                    throw "Use --tile-cache <cache_size_in_KB>";
+                params.lh_tile_cache = convert_int(argv[cnt]);
+                if (params.lh_tile_cache < 0)
+                    throw "--tile-cache must be non-negative";
+                continue;
+            }
+
 			if (strcmp(argv[cnt], "-f") == 0) {
 				cnt++;
 				if (cnt >= argc)
@@ -2861,6 +2905,11 @@ void parseArg(int argc, char *argv[], Params &params) {
                 }
 				continue;
 			}
+			if (strcmp(argv[cnt], "-lh32") == 0) {
+				params.lh32 = true;
+				params.lh_mem_save = LM_MEM_SAVE;
+				continue;
+			}
 //			if (strcmp(argv[cnt], "-storetrees") == 0) {
 //				params.store_candidate_trees = true;
 //				continue;
@@ -3151,6 +3200,26 @@ void parseArg(int argc, char *argv[], Params &params) {
                 continue;
             }
 
+            if (strcmp(argv[cnt], "-nni-par") == 0) {
+                params.nni_parallel = true;
+                continue;
+            }
+
+            if (strcmp(argv[cnt], "-tree-par") == 0) {
+                params.tree_parallel = true;
+                continue;
+            }
+
+            if (strcmp(argv[cnt], "-lhcache") == 0) {
+                cnt++;
+                if (cnt >= argc)
+                    throw "Use -lhcache <memory_in_MB>";
+                params.partial_lh_cache_size = convert_int(argv[cnt]);
+                if (params.partial_lh_cache_size < 0)
+                    throw "Memory for -lhcache must not be negative";
+                continue;
+            }
+
             if (strcmp(argv[cnt], "-bl-eval") == 0) {
 				cnt++;
 				if (cnt >= argc)
@@ -3647,6 +3716,7 @@ void usage_iqtree(char* argv[], bool full_command) {
             << "  -version             Display version number" << endl
             << "  -s <alignment>       Input alignment in PHYLIP/FASTA/NEXUS/CLUSTAL/MSF format" << endl
             << "  -st <data_type>      BIN, DNA, AA, NT2AA, CODON, MORPH (default: auto-detect)" << endl
+            << "  --aln-cache          Load/save the parsed alignment from/to binary <alignment>.alnbin" << endl
             << "  -q <partition_file>  Edge-linked partition model (file in NEXUS/RAxML format)" << endl
             << " -spp <partition_file> Like -q option but allowing partition-specific rates" << endl
             << "  -sp <partition_file> Edge-unlinked partition model (like -M option of RAxML)" << endl
@@ -3665,6 +3735,8 @@ void usage_iqtree(char* argv[], bool full_command) {
             << "  -keep-ident          Keep identical sequences (default: remove & finally add)" << endl
             << "  -safe                Safe likelihood kernel to avoid numerical underflow" << endl
             << "  -mem RAM             Maximal RAM usage for memory saving mode" << endl
+            << "  -lh32                Keep evicted partial likelihoods in 32 bits in memory saving mode" << endl
+            << "  --tile-cache KB      Cache per thread for likelihood pattern tiles (default: 256, 0: off)" << endl
             << "  --runs NUMBER        Number of indepedent runs (default: 1)" << endl
             << endl << "CHECKPOINTING TO RESUME STOPPED RUN:" << endl
             << "  -redo                Redo analysis even for successful runs (default: resume)" << endl
@@ -3683,6 +3755,14 @@ void usage_iqtree(char* argv[], bool full_command) {
             << "  -pers <proportion>   Perturbation strength for randomized NNI (default: 0.5)" << endl
             << "  -sprrad <number>     Radius for parsimony SPR search (default: 6)" << endl
             << "  -allnni              Perform more thorough NNI search (default: off)" << endl
+#ifdef _OPENMP
+            << "  -nni-par             Evaluate NNIs of different branches in parallel, also" << endl
+            << "                       for -alrt/-abayes (many taxa but few patterns)" << endl
+            << "  -tree-par            Evaluate initial and user trees in parallel (for" << endl
+            << "                       alignments with few patterns)" << endl
+#endif
+            << "  -lhcache <MB>        Memory to reuse partial likelihoods of subtrees shared" << endl
+            << "                       by candidate trees (default: 0 = off)" << endl
             << "  -g <constraint_tree> (Multifurcating) topological constraint tree file" << endl
             << "  -fast                Fast search to resemble FastTree" << endl
 //            << "  -iqp                 Use the IQP tree perturbation (default: randomized NNI)" << endl
@@ -3709,6 +3789,8 @@ void usage_iqtree(char* argv[], bool full_command) {
             << "  -alrt 0              Parametric aLRT test (Anisimova and Gascuel 2006)" << endl
             << "  -abayes              approximate Bayes test (Anisimova et al. 2011)" << endl
             << "  -lbp <#replicates>   Fast local bootstrap probabilities" << endl
+            << "                       Replicates are shared by all branches if they take at most" << endl
+            << "                       1/10 of the RAM, otherwise every branch draws its own in turn" << endl
             << endl << "MODEL-FINDER:" << endl
             << "  -m TESTONLY          Standard model selection (like jModelTest, ProtTest)" << endl
             << "  -m TEST              Standard model selection followed by tree inference" << endl
@@ -3740,6 +3822,15 @@ void usage_iqtree(char* argv[], bool full_command) {
 //            << "  -msep                Perform model selection and then rate selection" << endl
             << "  -mtree               Perform full tree search for each model considered" << endl
             << "  -mredo               Ignore model results computed earlier (default: reuse)" << endl
+            << "  -mprune              Stop optimizing models not expected to beat the best model" << endl
+            << "                       (faster, but results may differ from full optimization)" << endl
+            << "  -mnoprune            Fully optimize all models (default)" << endl
+#ifdef _OPENMP
+            << "  -mpar                Test several models at once with -nt > 1; results do not" << endl
+            << "                       depend on -nt but may differ from the default" << endl
+#endif
+            << "  -mcache <MB>         Memory to share eigen decompositions among models" << endl
+            << "                       (default: 64, 0 to disable)" << endl
             << "  -madd mx1,...,mxk    List of mixture models to also consider" << endl
             << "  -mdef <nexus_file>   A model definition NEXUS file (see Manual)" << endl
 
@@ -690,6 +690,23 @@ public:
 	 */
 	int nni5_num_eval;
 
+	/**
+	 *  TRUE to evaluate NNIs of different branches concurrently instead of
+	 *  parallelizing each likelihood computation over patterns, also for SH-aLRT and aBayes
+	 */
+	bool nni_parallel;
+
+	/**
+	 *  TRUE to evaluate initial and user trees concurrently instead of
+	 *  parallelizing each likelihood computation over patterns
+	 */
+	bool tree_parallel;
+
+	/**
+	 *  memory in MB for partial likelihoods of subtrees shared by candidate trees, 0 to disable (default)
+	 */
+	int partial_lh_cache_size;
+
 	/**
 	 *  Number of traversal for all branch lengths optimization of the initial tree 
 	 */
@@ -805,6 +822,9 @@ public:
     /** true if sequential phylip format is used, default: false (interleaved format) */
     bool phylip_sequential_format;
 
+    /** true to load/save the built alignment from/to a binary cache file aln_file.alnbin */
+    bool aln_cache;
+
     /**
             file containing multiple trees to evaluate at the end
      */
@@ -1315,6 +1335,13 @@ public:
     /** true to redo model testing even if .model file exists */
     bool model_test_again;
 
+    /** TRUE to stop optimizing a model once it is not expected to beat the best model found so far (default: false) */
+    bool model_test_prune;
+
+    /** TRUE to test several models concurrently with -nt > 1, every chain of models starting from
+        the results at the start of its stage (default: false) */
+    bool model_test_parallel;
+
     /** 0: use the same tree for model testing 
         1: estimate tree for each model, but initialize the tree for next model 
            by the tree reconstructed from the previous model
@@ -1338,6 +1365,11 @@ public:
      */
     bool store_trans_matrix;
 
+    /**
+            memory in MB for the eigen decompositions and transition matrices shared among models, 0 to disable
+     */
+    int eigen_cache_size;
+
     /**
             state frequency type
      */
@@ -1542,6 +1574,12 @@ public:
     /** TRUE to force using non-reversible likelihood kernel */
     bool kernel_nonrev;
 
+    /**
+        cache size (KB) per thread that a pattern tile of the likelihood kernels should fit in,
+        0 to disable cache tiling
+    */
+    int lh_tile_cache;
+
     /**
      	 	WSL_NONE: do not print anything
             WSL_SITE: print site log-likelihood
@@ -1932,6 +1970,9 @@ public:
     /** maximum size of memory allowed to use */
     double max_mem_size;
 
+    /** TRUE to keep evicted partial likelihoods in 32 bits in memory saving mode (-lh32) */
+    bool lh32;
+
 	/* TRUE to print .splits file in star-dot format */
 	bool print_splits_file;
     